@@ -72,10 +72,7 @@ void OnRecvVideoData(void *observer, h264_decode_struct *data) {
 extern "C" void
 audio_process(void *cls, void *opaque, pcm_data_struct *data)
 {
-    auto *session = (audio_session_t *)opaque;
-    for (int i = 0; i < data->data_len; i++) {
-        data->data[i] = data->data[i] * session->volume;
-    }
+    // Volume is already applied to the samples inside the library, opaque is unused
     OnRecvAudioData(cls, data);
 }
 
@@ -33,12 +33,14 @@
 struct aac_decoder_s {
     logger_t *logger;
     HANDLE_AACDECODER phandle;
+    /* 下一次解码时清除之前的历史 */
+    int clear_history;
 };
 
 static int fdk_flags = 0;
 
 HANDLE_AACDECODER
-create_fdk_aac_decoder(logger_t *logger)
+create_fdk_aac_decoder(logger_t *logger, const unsigned char *asc, unsigned int asc_len)
 {
     int ret = 0;
     UINT nrOfLayers = 1;
@@ -48,14 +50,18 @@ create_fdk_aac_decoder(logger_t *logger)
         return NULL;
     }
     /* ASC config binary data */
-    UCHAR eld_conf[] = { 0xF8, 0xE8, 0x50, 0x00 };
-    UCHAR *conf[] = { eld_conf };
-    static UINT conf_len = sizeof(eld_conf);
+    UCHAR *conf[] = { (UCHAR *) asc };
+    UINT conf_len = asc_len;
     ret = aacDecoder_ConfigRaw(phandle, conf, &conf_len);
     if (ret != AAC_DEC_OK) {
         logger_log(logger, LOGGER_DEBUG, "Unable to set configRaw\n");
         return NULL;
     }
+    /* 库内部的处理和回调格式的转换都按双声道进行,单声道的流由解码器复制成两个声道 */
+    if (aacDecoder_SetParam(phandle, AAC_PCM_MIN_OUTPUT_CHANNELS, 2) != AAC_DEC_OK ||
+        aacDecoder_SetParam(phandle, AAC_PCM_MAX_OUTPUT_CHANNELS, 2) != AAC_DEC_OK) {
+        logger_log(logger, LOGGER_WARNING, "aacDecoder_SetParam output channels failed\n");
+    }
     CStreamInfo *aac_stream_info = aacDecoder_GetStreamInfo(phandle);
     if (aac_stream_info == NULL) {
         logger_log(logger, LOGGER_DEBUG, "aacDecoder_GetStreamInfo failed!\n");
@@ -68,14 +74,23 @@ create_fdk_aac_decoder(logger_t *logger)
 }
 
 aac_decoder_t *
-aac_create(logger_t *logger)
+aac_create_with_config(logger_t *logger, const unsigned char *asc, int asc_len)
 {
     aac_decoder_t *aac_decoder = malloc(sizeof(aac_decoder_t));
     aac_decoder->logger = logger;
-    aac_decoder->phandle = create_fdk_aac_decoder(logger);
+    aac_decoder->clear_history = 0;
+    aac_decoder->phandle = create_fdk_aac_decoder(logger, asc, asc_len);
     return aac_decoder;
 }
 
+/* 实时音频:AAC-ELD 44100 双声道,每帧480个采样 */
+aac_decoder_t *
+aac_create(logger_t *logger)
+{
+    static const unsigned char eld_conf[] = { 0xF8, 0xE8, 0x50, 0x00 };
+    return aac_create_with_config(logger, eld_conf, sizeof(eld_conf));
+}
+
 int
 aac_decode_frame(aac_decoder_t *aac_decoder, unsigned char *input, int payloadsize, void *output, int pcm_pkt_size)
 {
@@ -88,13 +103,44 @@ aac_decode_frame(aac_decoder_t *aac_decoder, unsigned char *input, int payloadsi
         logger_log(aac_decoder->logger, LOGGER_ERR, "aacDecoder_Fill error : %x", ret);
         return ret;
     }
-    ret = aacDecoder_DecodeFrame(aac_decoder->phandle, output, pcm_pkt_size, fdk_flags);
+    ret = aacDecoder_DecodeFrame(aac_decoder->phandle, output, pcm_pkt_size,
+                                 aac_decoder->clear_history ? fdk_flags | AACDEC_CLRHIST : fdk_flags);
+    aac_decoder->clear_history = 0;
     if (ret != AAC_DEC_OK) {
         logger_log(aac_decoder->logger, LOGGER_ERR, "aacDecoder_DecodeFrame error : 0x%x", ret);
     }
     return ret;
 }
 
+int
+aac_set_conceal_method(aac_decoder_t *aac_decoder, int method)
+{
+    int ret = aacDecoder_SetParam(aac_decoder->phandle, AAC_CONCEAL_METHOD, method);
+    if (ret != AAC_DEC_OK) {
+        logger_log(aac_decoder->logger, LOGGER_WARNING, "aacDecoder_SetParam conceal method %d error : 0x%x", method, ret);
+    }
+    return ret;
+}
+
+/* 丢包时由解码器根据之前的帧生成替代数据,不读取新的输入 */
+int
+aac_conceal_frame(aac_decoder_t *aac_decoder, void *output, int pcm_pkt_size)
+{
+    int ret = aacDecoder_DecodeFrame(aac_decoder->phandle, output, pcm_pkt_size, fdk_flags | AACDEC_CONCEAL);
+    if (ret != AAC_DEC_OK) {
+        logger_log(aac_decoder->logger, LOGGER_ERR, "aacDecoder_DecodeFrame conceal error : 0x%x", ret);
+    }
+    return ret;
+}
+
+/* 复用解码器时代替close/open:丢弃缓存的输入,下一帧解码时清除历史 */
+void
+aac_reset(aac_decoder_t *aac_decoder)
+{
+    aacDecoder_SetParam(aac_decoder->phandle, AAC_TPDEC_CLEAR_BUFFER, 1);
+    aac_decoder->clear_history = 1;
+}
+
 void
 aac_free(aac_decoder_t *aac_decoder)
 {
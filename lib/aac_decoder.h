@@ -33,7 +33,14 @@ extern "C" {
 typedef struct aac_decoder_s aac_decoder_t;
 
 aac_decoder_t *aac_create(logger_t *logger);
+/* asc是AudioSpecificConfig,用于ELD以外的格式,比如缓冲音频的AAC-LC */
+aac_decoder_t *aac_create_with_config(logger_t *logger, const unsigned char *asc, int asc_len);
 int aac_decode_frame(aac_decoder_t *aac_decoder, unsigned char *input, int payloadsize, void *output, int pcm_pkt_size);
+/* 0: spectral muting, 1: noise substitution, 2: energy interpolation(多一帧延迟) */
+int aac_set_conceal_method(aac_decoder_t *aac_decoder, int method);
+int aac_conceal_frame(aac_decoder_t *aac_decoder, void *output, int pcm_pkt_size);
+/* 回到刚创建时的状态,配置不变 */
+void aac_reset(aac_decoder_t *aac_decoder);
 void aac_free(aac_decoder_t *alac);
 #ifdef __cplusplus
 }
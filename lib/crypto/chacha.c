@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * ChaCha20-Poly1305 AEAD (RFC 8439), decrypt only.
+ * Poly1305 uses 26-bit limbs so it needs nothing wider than 32x32->64
+ * multiplies and runs the same on 32-bit ARM.
+ */
+
+#include <string.h>
+#include "os_port.h"
+#include "crypto.h"
+
+#define U8TO32(p) \
+    (((uint32_t)(p)[0]) | ((uint32_t)(p)[1] << 8) | \
+     ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+
+#define U32TO8(p, v) do { \
+    (p)[0] = (uint8_t)(v); (p)[1] = (uint8_t)((v) >> 8); \
+    (p)[2] = (uint8_t)((v) >> 16); (p)[3] = (uint8_t)((v) >> 24); \
+} while (0)
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d) \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8);  \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+typedef struct
+{
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+} POLY1305_CTX;
+
+/**
+ * Generate one 64 byte keystream block
+ */
+static void chacha20_block(const uint32_t input[16], uint8_t out[64])
+{
+    uint32_t x[16];
+    int i;
+
+    memcpy(x, input, sizeof(x));
+    for (i = 0; i < 10; i++)
+    {
+        QUARTERROUND(x[0], x[4], x[8], x[12]);
+        QUARTERROUND(x[1], x[5], x[9], x[13]);
+        QUARTERROUND(x[2], x[6], x[10], x[14]);
+        QUARTERROUND(x[3], x[7], x[11], x[15]);
+        QUARTERROUND(x[0], x[5], x[10], x[15]);
+        QUARTERROUND(x[1], x[6], x[11], x[12]);
+        QUARTERROUND(x[2], x[7], x[8], x[13]);
+        QUARTERROUND(x[3], x[4], x[9], x[14]);
+    }
+
+    for (i = 0; i < 16; i++)
+        U32TO8(out + 4 * i, x[i] + input[i]);
+}
+
+static void chacha20_setup(uint32_t state[16], const uint8_t *key,
+        const uint8_t *nonce, uint32_t counter)
+{
+    int i;
+
+    /* "expand 32-byte k" */
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+
+    for (i = 0; i < 8; i++)
+        state[4 + i] = U8TO32(key + 4 * i);
+
+    state[12] = counter;
+    state[13] = U8TO32(nonce);
+    state[14] = U8TO32(nonce + 4);
+    state[15] = U8TO32(nonce + 8);
+}
+
+static void chacha20_xor(uint32_t state[16], const uint8_t *in,
+        uint8_t *out, int length)
+{
+    uint8_t block[64];
+    int i, n;
+
+    while (length > 0)
+    {
+        chacha20_block(state, block);
+        state[12]++;
+        n = length < 64 ? length : 64;
+
+        for (i = 0; i < n; i++)
+            out[i] = in[i] ^ block[i];
+
+        in += n;
+        out += n;
+        length -= n;
+    }
+}
+
+static void poly1305_init(POLY1305_CTX *ctx, const uint8_t key[32])
+{
+    /* clamp r */
+    ctx->r[0] = (U8TO32(key + 0)) & 0x3ffffff;
+    ctx->r[1] = (U8TO32(key + 3) >> 2) & 0x3ffff03;
+    ctx->r[2] = (U8TO32(key + 6) >> 4) & 0x3ffc0ff;
+    ctx->r[3] = (U8TO32(key + 9) >> 6) & 0x3f03fff;
+    ctx->r[4] = (U8TO32(key + 12) >> 8) & 0x00fffff;
+
+    memset(ctx->h, 0, sizeof(ctx->h));
+
+    ctx->pad[0] = U8TO32(key + 16);
+    ctx->pad[1] = U8TO32(key + 20);
+    ctx->pad[2] = U8TO32(key + 24);
+    ctx->pad[3] = U8TO32(key + 28);
+}
+
+/**
+ * Absorb full 16 byte blocks, h = (h + m) * r mod 2^130-5
+ */
+static void poly1305_blocks(POLY1305_CTX *ctx, const uint8_t *m, int length)
+{
+    const uint32_t r0 = ctx->r[0], r1 = ctx->r[1], r2 = ctx->r[2],
+          r3 = ctx->r[3], r4 = ctx->r[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2],
+             h3 = ctx->h[3], h4 = ctx->h[4];
+    uint64_t d0, d1, d2, d3, d4;
+    uint32_t c;
+
+    while (length >= 16)
+    {
+        h0 += (U8TO32(m + 0)) & 0x3ffffff;
+        h1 += (U8TO32(m + 3) >> 2) & 0x3ffffff;
+        h2 += (U8TO32(m + 6) >> 4) & 0x3ffffff;
+        h3 += (U8TO32(m + 9) >> 6) & 0x3ffffff;
+        h4 += (U8TO32(m + 12) >> 8) | (1 << 24);
+
+        d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 +
+             (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+        d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 +
+             (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+        d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 +
+             (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+        d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 +
+             (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+        d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 +
+             (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+        c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & 0x3ffffff;
+        d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & 0x3ffffff;
+        d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & 0x3ffffff;
+        d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & 0x3ffffff;
+        d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & 0x3ffffff;
+        h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+        h1 += c;
+
+        m += 16;
+        length -= 16;
+    }
+
+    ctx->h[0] = h0; ctx->h[1] = h1; ctx->h[2] = h2;
+    ctx->h[3] = h3; ctx->h[4] = h4;
+}
+
+/**
+ * AEAD pads aad and ciphertext with zeros to a block boundary
+ */
+static void poly1305_update_padded(POLY1305_CTX *ctx,
+        const uint8_t *m, int length)
+{
+    uint8_t block[16];
+    int full = length & ~15;
+
+    poly1305_blocks(ctx, m, full);
+
+    if (length > full)
+    {
+        memset(block, 0, sizeof(block));
+        memcpy(block, m + full, length - full);
+        poly1305_blocks(ctx, block, 16);
+    }
+}
+
+static void poly1305_finish(POLY1305_CTX *ctx, uint8_t mac[16])
+{
+    uint32_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2],
+             h3 = ctx->h[3], h4 = ctx->h[4];
+    uint32_t g0, g1, g2, g3, g4, c, mask;
+    uint64_t f;
+
+    /* fully carry h */
+    c = h1 >> 26; h1 &= 0x3ffffff;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    /* g = h - p, select g if h >= p */
+    g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    g4 = h4 + c - (1 << 26);
+
+    mask = (g4 >> 31) - 1;
+    g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask; g4 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+    h3 = (h3 & mask) | g3;
+    h4 = (h4 & mask) | g4;
+
+    /* h = h % 2^128 + pad */
+    h0 = h0 | (h1 << 26);
+    h1 = (h1 >> 6) | (h2 << 20);
+    h2 = (h2 >> 12) | (h3 << 14);
+    h3 = (h3 >> 18) | (h4 << 8);
+
+    f = (uint64_t)h0 + ctx->pad[0]; h0 = (uint32_t)f;
+    f = (uint64_t)h1 + ctx->pad[1] + (f >> 32); h1 = (uint32_t)f;
+    f = (uint64_t)h2 + ctx->pad[2] + (f >> 32); h2 = (uint32_t)f;
+    f = (uint64_t)h3 + ctx->pad[3] + (f >> 32); h3 = (uint32_t)f;
+
+    U32TO8(mac + 0, h0);
+    U32TO8(mac + 4, h1);
+    U32TO8(mac + 8, h2);
+    U32TO8(mac + 12, h3);
+}
+
+/**
+ * Verify the tag and decrypt. Returns 0 on success, -1 if the tag does
+ * not match, in which case out is left untouched. in and out may overlap.
+ */
+int chacha20_poly1305_decrypt(const uint8_t *key, const uint8_t *nonce,
+        const uint8_t *aad, int aad_len, const uint8_t *in, int length,
+        const uint8_t *tag, uint8_t *out)
+{
+    uint32_t state[16];
+    uint8_t block[64];
+    uint8_t mac[CHACHA20_POLY1305_TAG_SIZE];
+    uint8_t lengths[16];
+    POLY1305_CTX poly;
+    uint8_t diff = 0;
+    int i;
+
+    /* one time key is the first half of block 0 */
+    chacha20_setup(state, key, nonce, 0);
+    chacha20_block(state, block);
+    poly1305_init(&poly, block);
+
+    poly1305_update_padded(&poly, aad, aad_len);
+    poly1305_update_padded(&poly, in, length);
+    memset(lengths, 0, sizeof(lengths));
+    U32TO8(lengths, (uint32_t)aad_len);
+    U32TO8(lengths + 8, (uint32_t)length);
+    poly1305_blocks(&poly, lengths, 16);
+    poly1305_finish(&poly, mac);
+
+    /* constant time compare */
+    for (i = 0; i < CHACHA20_POLY1305_TAG_SIZE; i++)
+        diff |= mac[i] ^ tag[i];
+
+    if (diff)
+        return -1;
+
+    state[12] = 1;
+    chacha20_xor(state, in, out, length);
+    return 0;
+}
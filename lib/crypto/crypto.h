@@ -139,6 +139,18 @@ void hmac_md5(const uint8_t *msg, int length, const uint8_t *key,
 void hmac_sha1(const uint8_t *msg, int length, const uint8_t *key, 
         int key_len, uint8_t *digest);
 
+/**************************************************************************
+ * ChaCha20-Poly1305 declarations
+ **************************************************************************/
+
+#define CHACHA20_POLY1305_KEY_SIZE      32
+#define CHACHA20_POLY1305_NONCE_SIZE    12
+#define CHACHA20_POLY1305_TAG_SIZE      16
+
+int chacha20_poly1305_decrypt(const uint8_t *key, const uint8_t *nonce,
+        const uint8_t *aad, int aad_len, const uint8_t *in, int length,
+        const uint8_t *tag, uint8_t *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,7 +15,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
+#include "netutils.h"
 #include "compat.h"
 
 int
@@ -200,3 +202,83 @@ netutils_parse_address(int family, const char *src, void *dst, int dstlen)
 	freeaddrinfo(result);
 	return length;
 }
+
+int
+netutils_enable_rx_timestamp(int sock)
+{
+#if defined(WIN32)
+	return -1;
+#elif defined(SO_TIMESTAMPNS)
+	int on = 1;
+	return setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+#elif defined(SO_TIMESTAMP)
+	int on = 1;
+	return setsockopt(sock, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+#else
+	return -1;
+#endif
+}
+
+uint64_t
+netutils_get_rx_timestamp(void *msghdr)
+{
+#if !defined(WIN32)
+	struct msghdr *msg = msghdr;
+	struct cmsghdr *cmsg;
+
+	if (!msg->msg_control || msg->msg_controllen == 0) {
+		return 0;
+	}
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET) {
+			continue;
+		}
+#if defined(SCM_TIMESTAMPNS)
+		if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+			struct timespec ts;
+			memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+			return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+		}
+#endif
+#if defined(SCM_TIMESTAMP)
+		if (cmsg->cmsg_type == SCM_TIMESTAMP) {
+			struct timeval tv;
+			memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+			return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+		}
+#endif
+	}
+#endif
+	return 0;
+}
+
+int
+netutils_recvfrom_timestamp(int sock, void *buf, int len, int flags, void *saddr, int *saddrlen, uint64_t *timestamp)
+{
+#if defined(WIN32)
+	socklen_t addrlen = *saddrlen;
+	int ret = recvfrom(sock, buf, len, flags, (struct sockaddr *)saddr, &addrlen);
+	*saddrlen = addrlen;
+	*timestamp = 0;
+	return ret;
+#else
+	char control[NETUTILS_RX_CONTROL_LEN];
+	struct msghdr msg;
+	struct iovec iov;
+	int ret;
+
+	iov.iov_base = buf;
+	iov.iov_len = len;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = saddr;
+	msg.msg_namelen = *saddrlen;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	ret = recvmsg(sock, &msg, flags);
+	*saddrlen = msg.msg_namelen;
+	*timestamp = ret >= 0 ? netutils_get_rx_timestamp(&msg) : 0;
+	return ret;
+#endif
+}
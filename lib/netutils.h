@@ -15,6 +15,11 @@
 #ifndef NETUTILS_H
 #define NETUTILS_H
 
+#include <stdint.h>
+
+/* recvmsg接收内核时间戳需要的控制缓存大小 */
+#define NETUTILS_RX_CONTROL_LEN 64
+
 int netutils_init();
 void netutils_cleanup();
 
@@ -22,4 +27,11 @@ int netutils_init_socket(unsigned short *port, int use_ipv6, int use_udp);
 unsigned char *netutils_get_address(void *sockaddr, int *length);
 int netutils_parse_address(int family, const char *src, void *dst, int dstlen);
 
+/* 开启内核接收时间戳,不支持时返回-1 */
+int netutils_enable_rx_timestamp(int sock);
+/* 从recvmsg的msghdr中取出内核接收时间戳,真实时钟 us(from 1970),没有时返回0 */
+uint64_t netutils_get_rx_timestamp(void *msghdr);
+/* 同recvfrom,timestamp返回内核接收时间戳,没有时为0 */
+int netutils_recvfrom_timestamp(int sock, void *buf, int len, int flags, void *saddr, int *saddrlen, uint64_t *timestamp);
+
 #endif
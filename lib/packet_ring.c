@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "packet_ring.h"
+#include "threads.h"
+
+struct packet_ring_s {
+    int count;
+    int slot_size;
+    packet_ring_entry_t *entries;
+    unsigned char *buffer;
+
+    /* head只由生产者写,tail只由消费者写,都只增不减,取模得到下标 */
+    unsigned int head;
+    unsigned int tail;
+};
+
+packet_ring_t *
+packet_ring_init(int count, int slot_size)
+{
+    packet_ring_t *ring;
+
+    assert(count > 0 && (count & (count - 1)) == 0);
+    ring = calloc(1, sizeof(packet_ring_t));
+    if (!ring) {
+        return NULL;
+    }
+    ring->entries = calloc(count, sizeof(packet_ring_entry_t));
+    ring->buffer = malloc((size_t) count * slot_size);
+    if (!ring->entries || !ring->buffer) {
+        free(ring->entries);
+        free(ring->buffer);
+        free(ring);
+        return NULL;
+    }
+    for (int i = 0; i < count; i++) {
+        ring->entries[i].data = ring->buffer + (size_t) i * slot_size;
+    }
+    ring->count = count;
+    ring->slot_size = slot_size;
+    return ring;
+}
+
+int
+packet_ring_slot_size(packet_ring_t *ring)
+{
+    return ring->slot_size;
+}
+
+int
+packet_ring_depth(packet_ring_t *ring)
+{
+    unsigned int head = ATOMIC_LOAD_ACQUIRE(&ring->head);
+    unsigned int tail = ATOMIC_LOAD_ACQUIRE(&ring->tail);
+    return (int) (head - tail);
+}
+
+packet_ring_entry_t *
+packet_ring_write_begin(packet_ring_t *ring)
+{
+    unsigned int tail = ATOMIC_LOAD_ACQUIRE(&ring->tail);
+    if (ring->head - tail >= (unsigned int) ring->count) {
+        return NULL;
+    }
+    return &ring->entries[ring->head & (ring->count - 1)];
+}
+
+void
+packet_ring_write_commit(packet_ring_t *ring)
+{
+    ATOMIC_STORE_RELEASE(&ring->head, ring->head + 1);
+}
+
+packet_ring_entry_t *
+packet_ring_read_begin(packet_ring_t *ring)
+{
+    unsigned int head = ATOMIC_LOAD_ACQUIRE(&ring->head);
+    if (head == ring->tail) {
+        return NULL;
+    }
+    return &ring->entries[ring->tail & (ring->count - 1)];
+}
+
+void
+packet_ring_read_commit(packet_ring_t *ring)
+{
+    ATOMIC_STORE_RELEASE(&ring->tail, ring->tail + 1);
+}
+
+void
+packet_ring_destroy(packet_ring_t *ring)
+{
+    if (ring) {
+        free(ring->entries);
+        free(ring->buffer);
+        free(ring);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * 单生产者单消费者的无锁环形队列,用于在线程之间传递网络包
+ * 写入和读取都分为begin和commit两步,数据直接写入/读取队列内的slot,不需要额外拷贝
+ */
+
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+#include <stdint.h>
+
+typedef struct packet_ring_s packet_ring_t;
+
+typedef struct {
+    /* 由使用者定义的包类型 */
+    int type;
+    /* 附加参数,比如flush的序号 */
+    int value;
+    /* 入队时间 us */
+    uint64_t time_us;
+    int len;
+    unsigned char *data;
+} packet_ring_entry_t;
+
+/* count必须是2的幂 */
+packet_ring_t *packet_ring_init(int count, int slot_size);
+int packet_ring_slot_size(packet_ring_t *ring);
+int packet_ring_depth(packet_ring_t *ring);
+
+/* 生产者调用,队列满时返回NULL */
+packet_ring_entry_t *packet_ring_write_begin(packet_ring_t *ring);
+void packet_ring_write_commit(packet_ring_t *ring);
+
+/* 消费者调用,队列空时返回NULL */
+packet_ring_entry_t *packet_ring_read_begin(packet_ring_t *ring);
+void packet_ring_read_commit(packet_ring_t *ring);
+
+void packet_ring_destroy(packet_ring_t *ring);
+
+#endif //PACKET_RING_H
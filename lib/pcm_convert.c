@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "pcm_convert.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PCM_CONVERT_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCM_CONVERT_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+/* 声道的排列 */
+#define PCM_CONVERT_INTERLEAVED 0
+#define PCM_CONVERT_MONO 1
+#define PCM_CONVERT_PLANAR 2
+
+/* 16位整数到float的比例,单声道是两个声道的和所以再小一半 */
+#define PCM_CONVERT_F32_SCALE (1.0f / 32768.0f)
+#define PCM_CONVERT_F32_MONO_SCALE (1.0f / 65536.0f)
+
+/* out0是交错或第一个声道的输出,out1是分声道时第二个声道的输出,返回处理的帧数 */
+typedef int (*pcm_convert_kernel_t)(pcm_convert_t *convert, const short *in, int frames, void *out0, void *out1);
+
+struct pcm_convert_s {
+    int format;
+    int layout;
+    int sample_bytes;
+    int channels;
+    pcm_convert_kernel_t kernel;
+};
+
+/* 标量实现,也用来处理simd剩下的帧 */
+static void
+pcm_convert_scalar(pcm_convert_t *convert, const short *in, int start, int frames, void *out0, void *out1)
+{
+    int i;
+
+    switch (convert->format) {
+        case PCM_FORMAT_S16: {
+            short *o0 = out0, *o1 = out1;
+            for (i = start; i < frames; i++) {
+                if (convert->layout == PCM_CONVERT_MONO) {
+                    o0[i] = (short) ((in[2 * i] + in[2 * i + 1]) >> 1);
+                } else if (convert->layout == PCM_CONVERT_PLANAR) {
+                    o0[i] = in[2 * i];
+                    o1[i] = in[2 * i + 1];
+                } else {
+                    o0[2 * i] = in[2 * i];
+                    o0[2 * i + 1] = in[2 * i + 1];
+                }
+            }
+            break;
+        }
+        case PCM_FORMAT_S32: {
+            int32_t *o0 = out0, *o1 = out1;
+            for (i = start; i < frames; i++) {
+                if (convert->layout == PCM_CONVERT_MONO) {
+                    o0[i] = (in[2 * i] + in[2 * i + 1]) * 32768;
+                } else if (convert->layout == PCM_CONVERT_PLANAR) {
+                    o0[i] = in[2 * i] * 65536;
+                    o1[i] = in[2 * i + 1] * 65536;
+                } else {
+                    o0[2 * i] = in[2 * i] * 65536;
+                    o0[2 * i + 1] = in[2 * i + 1] * 65536;
+                }
+            }
+            break;
+        }
+        case PCM_FORMAT_F32: {
+            float *o0 = out0, *o1 = out1;
+            for (i = start; i < frames; i++) {
+                if (convert->layout == PCM_CONVERT_MONO) {
+                    o0[i] = (in[2 * i] + in[2 * i + 1]) * PCM_CONVERT_F32_MONO_SCALE;
+                } else if (convert->layout == PCM_CONVERT_PLANAR) {
+                    o0[i] = in[2 * i] * PCM_CONVERT_F32_SCALE;
+                    o1[i] = in[2 * i + 1] * PCM_CONVERT_F32_SCALE;
+                } else {
+                    o0[2 * i] = in[2 * i] * PCM_CONVERT_F32_SCALE;
+                    o0[2 * i + 1] = in[2 * i + 1] * PCM_CONVERT_F32_SCALE;
+                }
+            }
+            break;
+        }
+    }
+}
+
+#ifdef PCM_CONVERT_HAVE_SSE2
+/**
+ * 每次8帧,a和b是4个左右声道对组成的32位整数,
+ * 低16位是左声道,高16位是右声道,madd得到两个声道的和
+ */
+static int
+pcm_convert_sse2(pcm_convert_t *convert, const short *in, int frames, void *out0, void *out1)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i high = _mm_set1_epi32((int) 0xffff0000);
+    const __m128 scale = _mm_set1_ps(convert->layout == PCM_CONVERT_MONO ? PCM_CONVERT_F32_MONO_SCALE : PCM_CONVERT_F32_SCALE);
+    int count = frames & ~7;
+
+    for (int i = 0; i < count; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *) (in + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *) (in + 2 * i + 8));
+        if (convert->layout == PCM_CONVERT_MONO) {
+            __m128i sa = _mm_madd_epi16(a, ones);
+            __m128i sb = _mm_madd_epi16(b, ones);
+            if (convert->format == PCM_FORMAT_S16) {
+                _mm_storeu_si128((__m128i *) ((short *) out0 + i),
+                                 _mm_packs_epi32(_mm_srai_epi32(sa, 1), _mm_srai_epi32(sb, 1)));
+            } else if (convert->format == PCM_FORMAT_S32) {
+                _mm_storeu_si128((__m128i *) ((int32_t *) out0 + i), _mm_slli_epi32(sa, 15));
+                _mm_storeu_si128((__m128i *) ((int32_t *) out0 + i + 4), _mm_slli_epi32(sb, 15));
+            } else {
+                _mm_storeu_ps((float *) out0 + i, _mm_mul_ps(_mm_cvtepi32_ps(sa), scale));
+                _mm_storeu_ps((float *) out0 + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(sb), scale));
+            }
+        } else if (convert->layout == PCM_CONVERT_PLANAR) {
+            /* 左声道左移到高16位,右声道保留高16位 */
+            __m128i la = _mm_slli_epi32(a, 16), lb = _mm_slli_epi32(b, 16);
+            __m128i ra = _mm_and_si128(a, high), rb = _mm_and_si128(b, high);
+            if (convert->format == PCM_FORMAT_S16) {
+                _mm_storeu_si128((__m128i *) ((short *) out0 + i),
+                                 _mm_packs_epi32(_mm_srai_epi32(la, 16), _mm_srai_epi32(lb, 16)));
+                _mm_storeu_si128((__m128i *) ((short *) out1 + i),
+                                 _mm_packs_epi32(_mm_srai_epi32(ra, 16), _mm_srai_epi32(rb, 16)));
+            } else if (convert->format == PCM_FORMAT_S32) {
+                _mm_storeu_si128((__m128i *) ((int32_t *) out0 + i), la);
+                _mm_storeu_si128((__m128i *) ((int32_t *) out0 + i + 4), lb);
+                _mm_storeu_si128((__m128i *) ((int32_t *) out1 + i), ra);
+                _mm_storeu_si128((__m128i *) ((int32_t *) out1 + i + 4), rb);
+            } else {
+                const __m128 s = _mm_set1_ps(PCM_CONVERT_F32_SCALE / 65536.0f);
+                _mm_storeu_ps((float *) out0 + i, _mm_mul_ps(_mm_cvtepi32_ps(la), s));
+                _mm_storeu_ps((float *) out0 + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(lb), s));
+                _mm_storeu_ps((float *) out1 + i, _mm_mul_ps(_mm_cvtepi32_ps(ra), s));
+                _mm_storeu_ps((float *) out1 + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(rb), s));
+            }
+        } else {
+            /* 交错的32位:每个采样放到高16位 */
+            const __m128i zero = _mm_setzero_si128();
+            __m128i v[4];
+            v[0] = _mm_unpacklo_epi16(zero, a);
+            v[1] = _mm_unpackhi_epi16(zero, a);
+            v[2] = _mm_unpacklo_epi16(zero, b);
+            v[3] = _mm_unpackhi_epi16(zero, b);
+            for (int j = 0; j < 4; j++) {
+                if (convert->format == PCM_FORMAT_S32) {
+                    _mm_storeu_si128((__m128i *) ((int32_t *) out0 + 2 * i + 4 * j), v[j]);
+                } else {
+                    _mm_storeu_ps((float *) out0 + 2 * i + 4 * j,
+                                  _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(v[j], 16)), scale));
+                }
+            }
+        }
+    }
+    return count;
+}
+#endif
+
+#ifdef PCM_CONVERT_HAVE_NEON
+/* 每次8帧,vld2把左右声道分开 */
+static int
+pcm_convert_neon(pcm_convert_t *convert, const short *in, int frames, void *out0, void *out1)
+{
+    int count = frames & ~7;
+
+    for (int i = 0; i < count; i += 8) {
+        int16x8x2_t lr = vld2q_s16(in + 2 * i);
+        if (convert->layout == PCM_CONVERT_MONO) {
+            int32x4_t s0 = vaddl_s16(vget_low_s16(lr.val[0]), vget_low_s16(lr.val[1]));
+            int32x4_t s1 = vaddl_s16(vget_high_s16(lr.val[0]), vget_high_s16(lr.val[1]));
+            if (convert->format == PCM_FORMAT_S16) {
+                vst1q_s16((short *) out0 + i, vhaddq_s16(lr.val[0], lr.val[1]));
+            } else if (convert->format == PCM_FORMAT_S32) {
+                vst1q_s32((int32_t *) out0 + i, vshlq_n_s32(s0, 15));
+                vst1q_s32((int32_t *) out0 + i + 4, vshlq_n_s32(s1, 15));
+            } else {
+                vst1q_f32((float *) out0 + i, vcvtq_n_f32_s32(s0, 16));
+                vst1q_f32((float *) out0 + i + 4, vcvtq_n_f32_s32(s1, 16));
+            }
+        } else if (convert->layout == PCM_CONVERT_PLANAR) {
+            void *outs[2] = { out0, out1 };
+            for (int c = 0; c < 2; c++) {
+                int16x8_t x = lr.val[c];
+                if (convert->format == PCM_FORMAT_S16) {
+                    vst1q_s16((short *) outs[c] + i, x);
+                } else if (convert->format == PCM_FORMAT_S32) {
+                    vst1q_s32((int32_t *) outs[c] + i, vshll_n_s16(vget_low_s16(x), 16));
+                    vst1q_s32((int32_t *) outs[c] + i + 4, vshll_n_s16(vget_high_s16(x), 16));
+                } else {
+                    vst1q_f32((float *) outs[c] + i, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(x)), 15));
+                    vst1q_f32((float *) outs[c] + i + 4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(x)), 15));
+                }
+            }
+        } else {
+            /* 交错时不需要分开声道,按顺序扩展 */
+            int16x8_t x[2] = { vld1q_s16(in + 2 * i), vld1q_s16(in + 2 * i + 8) };
+            for (int j = 0; j < 2; j++) {
+                if (convert->format == PCM_FORMAT_S32) {
+                    vst1q_s32((int32_t *) out0 + 2 * i + 8 * j, vshll_n_s16(vget_low_s16(x[j]), 16));
+                    vst1q_s32((int32_t *) out0 + 2 * i + 8 * j + 4, vshll_n_s16(vget_high_s16(x[j]), 16));
+                } else {
+                    vst1q_f32((float *) out0 + 2 * i + 8 * j, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(x[j])), 15));
+                    vst1q_f32((float *) out0 + 2 * i + 8 * j + 4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(x[j])), 15));
+                }
+            }
+        }
+    }
+    return count;
+}
+#endif
+
+static pcm_convert_kernel_t
+pcm_convert_select_kernel(void)
+{
+#if defined(PCM_CONVERT_HAVE_SSE2)
+    return pcm_convert_sse2;
+#elif defined(PCM_CONVERT_HAVE_NEON)
+    return pcm_convert_neon;
+#else
+    return NULL;
+#endif
+}
+
+pcm_convert_t *
+pcm_convert_init(int format, int channels, int planar)
+{
+    pcm_convert_t *convert;
+
+    if (format != PCM_FORMAT_S16 && format != PCM_FORMAT_S32 && format != PCM_FORMAT_F32) {
+        return NULL;
+    }
+    if (channels != 1 && channels != 2) {
+        return NULL;
+    }
+    convert = calloc(1, sizeof(pcm_convert_t));
+    if (!convert) {
+        return NULL;
+    }
+    convert->format = format;
+    convert->channels = channels;
+    convert->sample_bytes = format == PCM_FORMAT_S16 ? sizeof(short) : 4;
+    if (channels == 1) {
+        convert->layout = PCM_CONVERT_MONO;
+    } else {
+        convert->layout = planar ? PCM_CONVERT_PLANAR : PCM_CONVERT_INTERLEAVED;
+    }
+    convert->kernel = pcm_convert_select_kernel();
+    return convert;
+}
+
+int
+pcm_convert_is_identity(pcm_convert_t *convert)
+{
+    assert(convert);
+    return convert->format == PCM_FORMAT_S16 && convert->layout == PCM_CONVERT_INTERLEAVED;
+}
+
+int
+pcm_convert_frame_bytes(pcm_convert_t *convert)
+{
+    assert(convert);
+    return convert->sample_bytes * convert->channels;
+}
+
+void
+pcm_convert_process(pcm_convert_t *convert, const short *in, int frames, void *out, int offset, int out_frames)
+{
+    unsigned char *out0, *out1 = NULL;
+    int done = 0;
+
+    assert(convert);
+
+    if (frames <= 0) {
+        return;
+    }
+    if (convert->layout == PCM_CONVERT_PLANAR) {
+        out0 = (unsigned char *) out + offset * convert->sample_bytes;
+        out1 = out0 + out_frames * convert->sample_bytes;
+    } else {
+        out0 = (unsigned char *) out + offset * convert->sample_bytes * convert->channels;
+    }
+    if (pcm_convert_is_identity(convert)) {
+        if (out0 != (const unsigned char *) in) {
+            memcpy(out0, in, frames * 2 * sizeof(short));
+        }
+        return;
+    }
+    if (convert->kernel) {
+        done = convert->kernel(convert, in, frames, out0, out1);
+    }
+    pcm_convert_scalar(convert, in, done, frames, out0, out1);
+}
+
+void
+pcm_convert_silence(pcm_convert_t *convert, void *out, int offset, int frames, int out_frames)
+{
+    unsigned char *p = out;
+
+    assert(convert);
+
+    if (frames <= 0) {
+        return;
+    }
+    /* 三种格式的静音都是全0 */
+    if (convert->layout == PCM_CONVERT_PLANAR) {
+        memset(p + offset * convert->sample_bytes, 0, frames * convert->sample_bytes);
+        memset(p + (out_frames + offset) * convert->sample_bytes, 0, frames * convert->sample_bytes);
+    } else {
+        memset(p + offset * convert->sample_bytes * convert->channels, 0, frames * convert->sample_bytes * convert->channels);
+    }
+}
+
+void
+pcm_convert_destroy(pcm_convert_t *convert)
+{
+    free(convert);
+}
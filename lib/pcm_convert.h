@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * 回调pcm的格式转换
+ * 库内部处理的都是交错的16位双声道,回调之前一次转换成应用要求的格式,
+ * 直接写到回调的缓存中:16/32位整数或float,交错或分声道存放,或者混成单声道
+ * x86使用SSE2,ARM使用NEON,其他平台用标量实现
+ */
+
+#ifndef PCM_CONVERT_H
+#define PCM_CONVERT_H
+
+#include "stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pcm_convert_s pcm_convert_t;
+
+/* format为PCM_FORMAT_*,channels为1或2,planar只对双声道有意义,不支持的组合返回NULL */
+pcm_convert_t *pcm_convert_init(int format, int channels, int planar);
+/* 输出就是交错的16位双声道,不需要转换 */
+int pcm_convert_is_identity(pcm_convert_t *convert);
+/* 每帧输出的字节数,包括所有声道 */
+int pcm_convert_frame_bytes(pcm_convert_t *convert);
+/**
+ * 把frames帧交错的16位双声道转换后写到out的第offset帧,
+ * out共有out_frames帧,分声道存放时第c个声道从out + c * out_frames个采样开始
+ */
+void pcm_convert_process(pcm_convert_t *convert, const short *in, int frames, void *out, int offset, int out_frames);
+/* 把out从第offset帧开始的frames帧写成静音 */
+void pcm_convert_silence(pcm_convert_t *convert, void *out, int offset, int frames, int out_frames);
+void pcm_convert_destroy(pcm_convert_t *convert);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //PCM_CONVERT_H
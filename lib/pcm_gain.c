@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "pcm_gain.h"
+#include "threads.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PCM_GAIN_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+/* gcc和clang可以单独为AVX2编译一个函数,运行时检测cpu;msvc只在编译选项打开AVX2时使用 */
+#if defined(PCM_GAIN_HAVE_SSE2) && (defined(__GNUC__) || defined(__clang__)) && !defined(_WIN32)
+#define PCM_GAIN_HAVE_AVX2
+#define PCM_GAIN_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(PCM_GAIN_HAVE_SSE2) && defined(__AVX2__)
+#define PCM_GAIN_HAVE_AVX2
+#define PCM_GAIN_AVX2_TARGET
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCM_GAIN_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+/* 增益是Q15定点数,1.0是32768,ramp时的累加器再多15位小数 */
+#define PCM_GAIN_UNITY 32768
+#define PCM_GAIN_FRAC_BITS 15
+/* 低于这个音量 dB当作静音 */
+#define PCM_GAIN_MUTE_VOLUME -144.0f
+/* 每个simd通道独立的随机数状态 */
+#define PCM_GAIN_RNG_LANES 8
+
+/* g是第一帧的增益,每帧增加step,都带PCM_GAIN_FRAC_BITS位小数,返回处理的帧数 */
+typedef int (*pcm_gain_kernel_t)(pcm_gain_t *gain, short *pcm, int frames, int32_t g, int32_t step);
+
+struct pcm_gain_s {
+    int dither;
+    /* 上一帧结束时的增益,只由apply的线程访问,小于0表示还没有处理过 */
+    int current;
+    uint32_t rng[PCM_GAIN_RNG_LANES];
+    pcm_gain_kernel_t kernel;
+
+    /* MUTEX LOCKED VARIABLES START */
+    int target;
+    mutex_handle_t mutex;
+    /* MUTEX LOCKED VARIABLES END */
+};
+
+static uint32_t
+pcm_gain_xorshift(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/**
+ * 标量实现,也用来处理simd剩下的帧
+ * 抖动是两个15位均匀分布的差,范围正负一个输出的最低位
+ */
+static void
+pcm_gain_scalar(pcm_gain_t *gain, short *pcm, int frames, int32_t g, int32_t step)
+{
+    uint32_t rng = gain->rng[0];
+
+    for (int i = 0; i < frames; i++) {
+        int32_t gv = g >> PCM_GAIN_FRAC_BITS;
+        if (gv > PCM_GAIN_UNITY - 1) {
+            gv = PCM_GAIN_UNITY - 1;
+        }
+        for (int c = 0; c < 2; c++) {
+            int32_t v = pcm[c] * gv + (1 << 14);
+            if (gain->dither) {
+                rng = pcm_gain_xorshift(rng);
+                v += (int32_t) (rng >> 17) - (int32_t) (rng & 0x7fff);
+            }
+            v >>= 15;
+            pcm[c] = (short) (v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+        }
+        pcm += 2;
+        g += step;
+    }
+    gain->rng[0] = rng;
+}
+
+#ifdef PCM_GAIN_HAVE_SSE2
+static __m128i
+pcm_gain_sse2_xorshift(__m128i x)
+{
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+static __m128i
+pcm_gain_sse2_tpdf(__m128i x)
+{
+    return _mm_sub_epi32(_mm_srli_epi32(x, 17), _mm_and_si128(x, _mm_set1_epi32(0x7fff)));
+}
+
+/**
+ * 每次4帧8个采样,16位乘16位用mullo和mulhi拼成32位的乘积
+ * 增益到1.0时packs饱和成32767,和标量实现一致
+ */
+static int
+pcm_gain_sse2(pcm_gain_t *gain, short *pcm, int frames, int32_t g, int32_t step)
+{
+    __m128i ga = _mm_setr_epi32(g, g, g + step, g + step);
+    __m128i gb = _mm_add_epi32(ga, _mm_set1_epi32(2 * step));
+    __m128i inc = _mm_set1_epi32(4 * step);
+    __m128i round = _mm_set1_epi32(1 << 14);
+    __m128i rng = _mm_loadu_si128((const __m128i *) gain->rng);
+    int count = frames & ~3;
+
+    for (int i = 0; i < count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *) (pcm + 2 * i));
+        __m128i gv = _mm_packs_epi32(_mm_srai_epi32(ga, PCM_GAIN_FRAC_BITS), _mm_srai_epi32(gb, PCM_GAIN_FRAC_BITS));
+        __m128i lo = _mm_mullo_epi16(s, gv);
+        __m128i hi = _mm_mulhi_epi16(s, gv);
+        __m128i p0 = _mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round);
+        __m128i p1 = _mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round);
+        if (gain->dither) {
+            rng = pcm_gain_sse2_xorshift(rng);
+            p0 = _mm_add_epi32(p0, pcm_gain_sse2_tpdf(rng));
+            rng = pcm_gain_sse2_xorshift(rng);
+            p1 = _mm_add_epi32(p1, pcm_gain_sse2_tpdf(rng));
+        }
+        p0 = _mm_srai_epi32(p0, 15);
+        p1 = _mm_srai_epi32(p1, 15);
+        _mm_storeu_si128((__m128i *) (pcm + 2 * i), _mm_packs_epi32(p0, p1));
+        ga = _mm_add_epi32(ga, inc);
+        gb = _mm_add_epi32(gb, inc);
+    }
+    _mm_storeu_si128((__m128i *) gain->rng, rng);
+    return count;
+}
+#endif
+
+#ifdef PCM_GAIN_HAVE_AVX2
+PCM_GAIN_AVX2_TARGET static __m256i
+pcm_gain_avx2_xorshift(__m256i x)
+{
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+    return _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+}
+
+PCM_GAIN_AVX2_TARGET static __m256i
+pcm_gain_avx2_tpdf(__m256i x)
+{
+    return _mm256_sub_epi32(_mm256_srli_epi32(x, 17), _mm256_and_si256(x, _mm256_set1_epi32(0x7fff)));
+}
+
+/**
+ * 每次8帧16个采样
+ * unpack和packs都在128位的两半内部进行,所以ga放第0,1,4,5帧的增益,gb放第2,3,6,7帧的
+ */
+PCM_GAIN_AVX2_TARGET static int
+pcm_gain_avx2(pcm_gain_t *gain, short *pcm, int frames, int32_t g, int32_t step)
+{
+    __m256i ga = _mm256_setr_epi32(g, g, g + step, g + step,
+                                   g + 4 * step, g + 4 * step, g + 5 * step, g + 5 * step);
+    __m256i gb = _mm256_add_epi32(ga, _mm256_set1_epi32(2 * step));
+    __m256i inc = _mm256_set1_epi32(8 * step);
+    __m256i round = _mm256_set1_epi32(1 << 14);
+    __m256i rng = _mm256_loadu_si256((const __m256i *) gain->rng);
+    int count = frames & ~7;
+
+    for (int i = 0; i < count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i *) (pcm + 2 * i));
+        __m256i gv = _mm256_packs_epi32(_mm256_srai_epi32(ga, PCM_GAIN_FRAC_BITS), _mm256_srai_epi32(gb, PCM_GAIN_FRAC_BITS));
+        __m256i lo = _mm256_mullo_epi16(s, gv);
+        __m256i hi = _mm256_mulhi_epi16(s, gv);
+        __m256i p0 = _mm256_add_epi32(_mm256_unpacklo_epi16(lo, hi), round);
+        __m256i p1 = _mm256_add_epi32(_mm256_unpackhi_epi16(lo, hi), round);
+        if (gain->dither) {
+            rng = pcm_gain_avx2_xorshift(rng);
+            p0 = _mm256_add_epi32(p0, pcm_gain_avx2_tpdf(rng));
+            rng = pcm_gain_avx2_xorshift(rng);
+            p1 = _mm256_add_epi32(p1, pcm_gain_avx2_tpdf(rng));
+        }
+        p0 = _mm256_srai_epi32(p0, 15);
+        p1 = _mm256_srai_epi32(p1, 15);
+        _mm256_storeu_si256((__m256i *) (pcm + 2 * i), _mm256_packs_epi32(p0, p1));
+        ga = _mm256_add_epi32(ga, inc);
+        gb = _mm256_add_epi32(gb, inc);
+    }
+    _mm256_storeu_si256((__m256i *) gain->rng, rng);
+    return count;
+}
+#endif
+
+#ifdef PCM_GAIN_HAVE_NEON
+static uint32x4_t
+pcm_gain_neon_xorshift(uint32x4_t x)
+{
+    x = veorq_u32(x, vshlq_n_u32(x, 13));
+    x = veorq_u32(x, vshrq_n_u32(x, 17));
+    return veorq_u32(x, vshlq_n_u32(x, 5));
+}
+
+static int32x4_t
+pcm_gain_neon_tpdf(uint32x4_t x)
+{
+    return vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(x, 17)),
+                     vreinterpretq_s32_u32(vandq_u32(x, vdupq_n_u32(0x7fff))));
+}
+
+/* 每次4帧8个采样,vmull_s16直接得到32位的乘积 */
+static int
+pcm_gain_neon(pcm_gain_t *gain, short *pcm, int frames, int32_t g, int32_t step)
+{
+    int32_t init[4] = { g, g, g + step, g + step };
+    int32x4_t ga = vld1q_s32(init);
+    int32x4_t gb = vaddq_s32(ga, vdupq_n_s32(2 * step));
+    int32x4_t inc = vdupq_n_s32(4 * step);
+    int32x4_t round = vdupq_n_s32(1 << 14);
+    uint32x4_t rng = vld1q_u32(gain->rng);
+    int count = frames & ~3;
+
+    for (int i = 0; i < count; i += 4) {
+        int16x8_t s = vld1q_s16(pcm + 2 * i);
+        int32x4_t p0 = vmlal_s16(round, vget_low_s16(s), vqmovn_s32(vshrq_n_s32(ga, PCM_GAIN_FRAC_BITS)));
+        int32x4_t p1 = vmlal_s16(round, vget_high_s16(s), vqmovn_s32(vshrq_n_s32(gb, PCM_GAIN_FRAC_BITS)));
+        if (gain->dither) {
+            rng = pcm_gain_neon_xorshift(rng);
+            p0 = vaddq_s32(p0, pcm_gain_neon_tpdf(rng));
+            rng = pcm_gain_neon_xorshift(rng);
+            p1 = vaddq_s32(p1, pcm_gain_neon_tpdf(rng));
+        }
+        vst1q_s16(pcm + 2 * i, vcombine_s16(vqshrn_n_s32(p0, 15), vqshrn_n_s32(p1, 15)));
+        ga = vaddq_s32(ga, inc);
+        gb = vaddq_s32(gb, inc);
+    }
+    vst1q_u32(gain->rng, rng);
+    return count;
+}
+#endif
+
+static pcm_gain_kernel_t
+pcm_gain_select_kernel(void)
+{
+#if defined(PCM_GAIN_HAVE_AVX2) && defined(__AVX2__)
+    return pcm_gain_avx2;
+#elif defined(PCM_GAIN_HAVE_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        return pcm_gain_avx2;
+    }
+    return pcm_gain_sse2;
+#elif defined(PCM_GAIN_HAVE_SSE2)
+    return pcm_gain_sse2;
+#elif defined(PCM_GAIN_HAVE_NEON)
+    return pcm_gain_neon;
+#else
+    return NULL;
+#endif
+}
+
+pcm_gain_t *
+pcm_gain_init(int dither)
+{
+    pcm_gain_t *gain;
+
+    gain = calloc(1, sizeof(pcm_gain_t));
+    if (!gain) {
+        return NULL;
+    }
+    gain->dither = dither;
+    gain->current = -1;
+    gain->target = PCM_GAIN_UNITY;
+    for (int i = 0; i < PCM_GAIN_RNG_LANES; i++) {
+        gain->rng[i] = 0x9e3779b9u * (i + 1);
+    }
+    gain->kernel = pcm_gain_select_kernel();
+    MUTEX_CREATE(gain->mutex);
+    return gain;
+}
+
+void
+pcm_gain_set_dither(pcm_gain_t *gain, int dither)
+{
+    assert(gain);
+    gain->dither = dither;
+}
+
+void
+pcm_gain_set_volume(pcm_gain_t *gain, float volume)
+{
+    int target;
+
+    assert(gain);
+
+    if (volume <= PCM_GAIN_MUTE_VOLUME) {
+        target = 0;
+    } else if (volume >= 0.0f) {
+        target = PCM_GAIN_UNITY;
+    } else {
+        target = (int) (PCM_GAIN_UNITY * powf(10.0f, 0.05f * volume) + 0.5f);
+    }
+    MUTEX_LOCK(gain->mutex);
+    gain->target = target;
+    MUTEX_UNLOCK(gain->mutex);
+}
+
+void
+pcm_gain_apply(pcm_gain_t *gain, short *pcm, int samples)
+{
+    int target;
+    int frames = samples / 2;
+    int done = 0;
+    int32_t g;
+    int32_t step;
+
+    assert(gain);
+
+    MUTEX_LOCK(gain->mutex);
+    target = gain->target;
+    MUTEX_UNLOCK(gain->mutex);
+
+    if (frames <= 0) {
+        return;
+    }
+    if (gain->current < 0) {
+        gain->current = target;
+    }
+    if (gain->current == target) {
+        if (target == PCM_GAIN_UNITY) {
+            return;
+        } else if (target == 0) {
+            memset(pcm, 0, frames * 2 * sizeof(short));
+            return;
+        }
+    }
+    /* 在这一帧内从current线性过渡到target */
+    g = gain->current << PCM_GAIN_FRAC_BITS;
+    step = (int32_t) (((int64_t) (target - gain->current) << PCM_GAIN_FRAC_BITS) / frames);
+    if (gain->kernel) {
+        done = gain->kernel(gain, pcm, frames, g, step);
+    }
+    pcm_gain_scalar(gain, pcm + 2 * done, frames - done, g + done * step, step);
+    gain->current = target;
+}
+
+void
+pcm_gain_destroy(pcm_gain_t *gain)
+{
+    if (gain) {
+        MUTEX_DESTROY(gain->mutex);
+        free(gain);
+    }
+}
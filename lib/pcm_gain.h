@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * 解码后的音量处理
+ * 在解码得到的双声道pcm上原地乘以增益,增益是Q15定点数,
+ * 音量变化时在一帧之内从旧增益线性过渡到新增益,避免突变产生的咔哒声,
+ * 衰减时可以加TPDF抖动,掩盖截断到16位的量化失真
+ * 增益为1时直接跳过,x86使用SSE2/AVX2,ARM使用NEON,其他平台用标量实现
+ * set_volume可以在任意线程调用,apply只能在一个线程调用
+ */
+
+#ifndef PCM_GAIN_H
+#define PCM_GAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pcm_gain_s pcm_gain_t;
+
+pcm_gain_t *pcm_gain_init(int dither);
+/* 和apply在同一个线程调用 */
+void pcm_gain_set_dither(pcm_gain_t *gain, int dither);
+/* volume是AirPlay的音量 dB,0为原始音量,-144为静音 */
+void pcm_gain_set_volume(pcm_gain_t *gain, float volume);
+/* 对samples个交错的双声道采样原地处理,samples是short的个数,第一次调用时直接使用设置的音量 */
+void pcm_gain_apply(pcm_gain_t *gain, short *pcm, int samples);
+void pcm_gain_destroy(pcm_gain_t *gain);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //PCM_GAIN_H
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "pcm_pool.h"
+#include "threads.h"
+
+struct pcm_frame_s {
+    pcm_pool_t *pool;
+    int refcount;
+    pcm_frame_t *next;
+    /* 数据紧跟在结构体后面 */
+    short *data;
+};
+
+struct pcm_pool_s {
+    mutex_handle_t mutex;
+    int frame_len;
+    int max_frames;
+
+    int allocated;
+    int in_use;
+    int max_in_use;
+    /* pcm_pool_destroy之后还有帧被引用 */
+    int destroyed;
+    pcm_frame_t *free_list;
+};
+
+pcm_pool_t *
+pcm_pool_init(int frame_len, int max_frames)
+{
+    pcm_pool_t *pool;
+
+    assert(frame_len > 0);
+    assert(max_frames > 0);
+    pool = calloc(1, sizeof(pcm_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+    pool->frame_len = frame_len;
+    pool->max_frames = max_frames;
+    MUTEX_CREATE(pool->mutex);
+    return pool;
+}
+
+static void
+pcm_pool_free(pcm_pool_t *pool)
+{
+    pcm_frame_t *frame = pool->free_list;
+    while (frame) {
+        pcm_frame_t *next = frame->next;
+        free(frame);
+        frame = next;
+    }
+    MUTEX_DESTROY(pool->mutex);
+    free(pool);
+}
+
+pcm_frame_t *
+pcm_pool_get(pcm_pool_t *pool)
+{
+    pcm_frame_t *frame = NULL;
+
+    assert(pool);
+    MUTEX_LOCK(pool->mutex);
+    if (pool->free_list) {
+        frame = pool->free_list;
+        pool->free_list = frame->next;
+    } else if (pool->allocated < pool->max_frames) {
+        /* 按需分配,不超过上限 */
+        frame = malloc(sizeof(pcm_frame_t) + pool->frame_len * sizeof(short));
+        if (frame) {
+            frame->pool = pool;
+            frame->data = (short *) (frame + 1);
+            pool->allocated++;
+        }
+    }
+    if (frame) {
+        frame->refcount = 1;
+        frame->next = NULL;
+        pool->in_use++;
+        if (pool->in_use > pool->max_in_use) {
+            pool->max_in_use = pool->in_use;
+        }
+    }
+    MUTEX_UNLOCK(pool->mutex);
+    return frame;
+}
+
+short *
+pcm_frame_data(pcm_frame_t *frame)
+{
+    return frame->data;
+}
+
+void
+pcm_pool_get_stats(pcm_pool_t *pool, int *allocated, int *in_use, int *max_in_use)
+{
+    assert(pool);
+    MUTEX_LOCK(pool->mutex);
+    *allocated = pool->allocated;
+    *in_use = pool->in_use;
+    *max_in_use = pool->max_in_use;
+    MUTEX_UNLOCK(pool->mutex);
+}
+
+void
+pcm_pool_destroy(pcm_pool_t *pool)
+{
+    int in_use;
+
+    if (!pool) {
+        return;
+    }
+    MUTEX_LOCK(pool->mutex);
+    pool->destroyed = 1;
+    in_use = pool->in_use;
+    MUTEX_UNLOCK(pool->mutex);
+    if (in_use == 0) {
+        pcm_pool_free(pool);
+    }
+}
+
+void
+pcm_frame_retain(pcm_frame_t *frame)
+{
+    pcm_pool_t *pool;
+
+    assert(frame);
+    pool = frame->pool;
+    MUTEX_LOCK(pool->mutex);
+    assert(frame->refcount > 0);
+    frame->refcount++;
+    MUTEX_UNLOCK(pool->mutex);
+}
+
+void
+pcm_frame_release(pcm_frame_t *frame)
+{
+    pcm_pool_t *pool;
+    int free_pool = 0;
+
+    assert(frame);
+    pool = frame->pool;
+    MUTEX_LOCK(pool->mutex);
+    assert(frame->refcount > 0);
+    if (--frame->refcount == 0) {
+        frame->next = pool->free_list;
+        pool->free_list = frame;
+        pool->in_use--;
+        free_pool = pool->destroyed && pool->in_use == 0;
+    }
+    MUTEX_UNLOCK(pool->mutex);
+    if (free_pool) {
+        pcm_pool_free(pool);
+    }
+}
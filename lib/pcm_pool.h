@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * 带引用计数的pcm帧缓存池,解码直接输出到池中的帧
+ * 应用在回调中retain之后可以把帧交给别的线程使用,用完release回到池中,不需要拷贝
+ * 池的帧数有上限,池销毁时还被引用的帧在最后一次release时释放
+ */
+
+#ifndef PCM_POOL_H
+#define PCM_POOL_H
+
+#include "stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pcm_pool_s pcm_pool_t;
+
+/* frame_len是每帧short的个数 */
+pcm_pool_t *pcm_pool_init(int frame_len, int max_frames);
+/* 返回引用计数为1的帧,帧数达到上限时返回NULL */
+pcm_frame_t *pcm_pool_get(pcm_pool_t *pool);
+short *pcm_frame_data(pcm_frame_t *frame);
+/* 已分配的帧数,正在使用的帧数,使用帧数的最大值 */
+void pcm_pool_get_stats(pcm_pool_t *pool, int *allocated, int *in_use, int *max_in_use);
+void pcm_pool_destroy(pcm_pool_t *pool);
+
+/* 应用使用,可以在任意线程调用 */
+void pcm_frame_retain(pcm_frame_t *frame);
+void pcm_frame_release(pcm_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //PCM_POOL_H
@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "pcm_resampler.h"
+#include "memalign.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PCM_RESAMPLER_HAVE_SSE
+#include <xmmintrin.h>
+#endif
+
+/* 和pcm_gain一样,gcc和clang运行时检测AVX2和FMA,msvc只在编译选项打开AVX2时使用 */
+#if defined(PCM_RESAMPLER_HAVE_SSE) && (defined(__GNUC__) || defined(__clang__)) && !defined(_WIN32)
+#define PCM_RESAMPLER_HAVE_AVX2
+#define PCM_RESAMPLER_AVX2_TARGET __attribute__((target("avx2,fma")))
+#include <immintrin.h>
+#elif defined(PCM_RESAMPLER_HAVE_SSE) && defined(__AVX2__)
+#define PCM_RESAMPLER_HAVE_AVX2
+#define PCM_RESAMPLER_AVX2_TARGET
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCM_RESAMPLER_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* 每个输出采样的卷积长度,是simd宽度的倍数 */
+#define PCM_RESAMPLER_TAPS 64
+/* 相位数,2的幂,相位之间线性插值 */
+#define PCM_RESAMPLER_PHASE_BITS 7
+#define PCM_RESAMPLER_PHASES (1 << PCM_RESAMPLER_PHASE_BITS)
+/* 截止频率相对于输入和输出中较低的奈奎斯特频率 */
+#define PCM_RESAMPLER_CUTOFF 0.91
+/* Kaiser窗的beta,阻带衰减大约70dB */
+#define PCM_RESAMPLER_BETA 7.0
+/* 历史数据的容量,卷积长度加上一次的输入 */
+#define PCM_RESAMPLER_HISTORY (PCM_RESAMPLER_TAPS + PCM_RESAMPLER_MAX_INPUT)
+
+/* l和r从第一个参与卷积的输入开始,系数是c + t * d,out返回左右声道 */
+typedef void (*pcm_resampler_kernel_t)(const float *l, const float *r, const float *c, const float *d, float t, float *out);
+
+struct pcm_resampler_s {
+    unsigned int in_rate;
+    unsigned int out_rate;
+    double drift;
+    /* 每个输出采样前进的输入采样数,32.32定点 */
+    uint64_t step;
+    /* 下一个输出采样在历史数据中的位置,32.32定点 */
+    uint64_t pos;
+    int count;
+
+    /* (PHASES + 1) * TAPS个系数,后面是PHASES * TAPS个相邻相位的差 */
+    float *coef;
+    float *delta;
+    float left[PCM_RESAMPLER_HISTORY];
+    float right[PCM_RESAMPLER_HISTORY];
+    pcm_resampler_kernel_t kernel;
+};
+
+#if !defined(PCM_RESAMPLER_HAVE_SSE) && !defined(PCM_RESAMPLER_HAVE_NEON)
+/* 没有SIMD时使用 */
+static void
+pcm_resampler_scalar(const float *l, const float *r, const float *c, const float *d, float t, float *out)
+{
+    float sl = 0.0f, sr = 0.0f;
+    for (int j = 0; j < PCM_RESAMPLER_TAPS; j++) {
+        float k = c[j] + t * d[j];
+        sl += l[j] * k;
+        sr += r[j] * k;
+    }
+    out[0] = sl;
+    out[1] = sr;
+}
+#endif
+
+#ifdef PCM_RESAMPLER_HAVE_SSE
+static float
+pcm_resampler_sse_sum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+static void
+pcm_resampler_sse(const float *l, const float *r, const float *c, const float *d, float t, float *out)
+{
+    __m128 vt = _mm_set1_ps(t);
+    __m128 sl = _mm_setzero_ps();
+    __m128 sr = _mm_setzero_ps();
+    for (int j = 0; j < PCM_RESAMPLER_TAPS; j += 4) {
+        __m128 k = _mm_add_ps(_mm_load_ps(c + j), _mm_mul_ps(_mm_load_ps(d + j), vt));
+        sl = _mm_add_ps(sl, _mm_mul_ps(_mm_loadu_ps(l + j), k));
+        sr = _mm_add_ps(sr, _mm_mul_ps(_mm_loadu_ps(r + j), k));
+    }
+    out[0] = pcm_resampler_sse_sum(sl);
+    out[1] = pcm_resampler_sse_sum(sr);
+}
+#endif
+
+#ifdef PCM_RESAMPLER_HAVE_AVX2
+PCM_RESAMPLER_AVX2_TARGET static float
+pcm_resampler_avx2_sum(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+PCM_RESAMPLER_AVX2_TARGET static void
+pcm_resampler_avx2(const float *l, const float *r, const float *c, const float *d, float t, float *out)
+{
+    __m256 vt = _mm256_set1_ps(t);
+    __m256 sl = _mm256_setzero_ps();
+    __m256 sr = _mm256_setzero_ps();
+    for (int j = 0; j < PCM_RESAMPLER_TAPS; j += 8) {
+        __m256 k = _mm256_fmadd_ps(_mm256_load_ps(d + j), vt, _mm256_load_ps(c + j));
+        sl = _mm256_fmadd_ps(_mm256_loadu_ps(l + j), k, sl);
+        sr = _mm256_fmadd_ps(_mm256_loadu_ps(r + j), k, sr);
+    }
+    out[0] = pcm_resampler_avx2_sum(sl);
+    out[1] = pcm_resampler_avx2_sum(sr);
+}
+#endif
+
+#ifdef PCM_RESAMPLER_HAVE_NEON
+static float
+pcm_resampler_neon_sum(float32x4_t v)
+{
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+static void
+pcm_resampler_neon(const float *l, const float *r, const float *c, const float *d, float t, float *out)
+{
+    float32x4_t sl = vdupq_n_f32(0.0f);
+    float32x4_t sr = vdupq_n_f32(0.0f);
+    for (int j = 0; j < PCM_RESAMPLER_TAPS; j += 4) {
+        float32x4_t k = vmlaq_n_f32(vld1q_f32(c + j), vld1q_f32(d + j), t);
+        sl = vmlaq_f32(sl, vld1q_f32(l + j), k);
+        sr = vmlaq_f32(sr, vld1q_f32(r + j), k);
+    }
+    out[0] = pcm_resampler_neon_sum(sl);
+    out[1] = pcm_resampler_neon_sum(sr);
+}
+#endif
+
+static pcm_resampler_kernel_t
+pcm_resampler_select_kernel(void)
+{
+#if defined(PCM_RESAMPLER_HAVE_AVX2) && defined(__AVX2__)
+    return pcm_resampler_avx2;
+#elif defined(PCM_RESAMPLER_HAVE_AVX2)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return pcm_resampler_avx2;
+    }
+    return pcm_resampler_sse;
+#elif defined(PCM_RESAMPLER_HAVE_SSE)
+    return pcm_resampler_sse;
+#elif defined(PCM_RESAMPLER_HAVE_NEON)
+    return pcm_resampler_neon;
+#else
+    return pcm_resampler_scalar;
+#endif
+}
+
+static double
+pcm_resampler_bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64; k++) {
+        double h = x / (2 * k);
+        term *= h * h;
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+/**
+ * 相位k对应输出位置在输入采样之间的k/PHASES处,第j个系数乘以第j个输入,
+ * 它到输出位置的距离是k/PHASES + TAPS/2 - 1 - j,每个相位归一化使直流增益为1
+ */
+static void
+pcm_resampler_design(pcm_resampler_t *resampler)
+{
+    double fc = PCM_RESAMPLER_CUTOFF;
+    double i0_beta = pcm_resampler_bessel_i0(PCM_RESAMPLER_BETA);
+    double half = PCM_RESAMPLER_TAPS / 2;
+
+    if (resampler->out_rate < resampler->in_rate) {
+        fc *= (double) resampler->out_rate / resampler->in_rate;
+    }
+    for (int k = 0; k <= PCM_RESAMPLER_PHASES; k++) {
+        float *c = resampler->coef + k * PCM_RESAMPLER_TAPS;
+        double sum = 0.0;
+        for (int j = 0; j < PCM_RESAMPLER_TAPS; j++) {
+            double t = (double) k / PCM_RESAMPLER_PHASES + half - 1 - j;
+            double u = t / half;
+            double x = M_PI * fc * t;
+            double h = (fabs(x) < 1e-9) ? fc : fc * sin(x) / x;
+            double w = (u * u < 1.0) ? pcm_resampler_bessel_i0(PCM_RESAMPLER_BETA * sqrt(1.0 - u * u)) / i0_beta : 0.0;
+            c[j] = (float) (h * w);
+            sum += c[j];
+        }
+        for (int j = 0; j < PCM_RESAMPLER_TAPS; j++) {
+            c[j] = (float) (c[j] / sum);
+        }
+    }
+    for (int k = 0; k < PCM_RESAMPLER_PHASES; k++) {
+        for (int j = 0; j < PCM_RESAMPLER_TAPS; j++) {
+            resampler->delta[k * PCM_RESAMPLER_TAPS + j] =
+                resampler->coef[(k + 1) * PCM_RESAMPLER_TAPS + j] - resampler->coef[k * PCM_RESAMPLER_TAPS + j];
+        }
+    }
+}
+
+pcm_resampler_t *
+pcm_resampler_init(unsigned int in_rate, unsigned int out_rate)
+{
+    pcm_resampler_t *resampler;
+    size_t table_size = (2 * PCM_RESAMPLER_PHASES + 1) * PCM_RESAMPLER_TAPS * sizeof(float);
+
+    if (in_rate < PCM_RESAMPLER_MIN_RATE || in_rate > PCM_RESAMPLER_MAX_RATE ||
+        out_rate < PCM_RESAMPLER_MIN_RATE || out_rate > PCM_RESAMPLER_MAX_RATE) {
+        return NULL;
+    }
+    resampler = calloc(1, sizeof(pcm_resampler_t));
+    if (!resampler) {
+        return NULL;
+    }
+    ALIGNED_MALLOC(resampler->coef, 32, table_size);
+    if (!resampler->coef) {
+        free(resampler);
+        return NULL;
+    }
+    resampler->delta = resampler->coef + (PCM_RESAMPLER_PHASES + 1) * PCM_RESAMPLER_TAPS;
+    resampler->in_rate = in_rate;
+    resampler->out_rate = out_rate;
+    resampler->kernel = pcm_resampler_select_kernel();
+    pcm_resampler_design(resampler);
+    pcm_resampler_set_drift(resampler, 0.0);
+    pcm_resampler_reset(resampler);
+    return resampler;
+}
+
+/* 历史数据前面补TAPS/2 - 1个0,第一个输出采样正好对应第一个输入采样 */
+void
+pcm_resampler_reset(pcm_resampler_t *resampler)
+{
+    assert(resampler);
+
+    resampler->count = PCM_RESAMPLER_TAPS / 2 - 1;
+    memset(resampler->left, 0, resampler->count * sizeof(float));
+    memset(resampler->right, 0, resampler->count * sizeof(float));
+    resampler->pos = (uint64_t) resampler->count << 32;
+}
+
+void
+pcm_resampler_set_drift(pcm_resampler_t *resampler, double ppm)
+{
+    double ratio;
+
+    assert(resampler);
+
+    if (ppm > PCM_RESAMPLER_MAX_DRIFT) {
+        ppm = PCM_RESAMPLER_MAX_DRIFT;
+    } else if (ppm < -PCM_RESAMPLER_MAX_DRIFT) {
+        ppm = -PCM_RESAMPLER_MAX_DRIFT;
+    }
+    resampler->drift = ppm;
+    ratio = (double) resampler->in_rate / resampler->out_rate * (1.0 + ppm / 1000000.0);
+    resampler->step = (uint64_t) (ratio * 4294967296.0 + 0.5);
+}
+
+double
+pcm_resampler_get_drift(pcm_resampler_t *resampler)
+{
+    assert(resampler);
+    return resampler->drift;
+}
+
+int
+pcm_resampler_max_output(pcm_resampler_t *resampler, int in_frames)
+{
+    double ratio;
+
+    assert(resampler);
+
+    /* 历史中还没有输出的输入最多TAPS/2 + 1个 */
+    ratio = (double) resampler->out_rate / resampler->in_rate / (1.0 - PCM_RESAMPLER_MAX_DRIFT / 1000000.0);
+    return (int) ((in_frames + PCM_RESAMPLER_TAPS / 2 + 1) * ratio) + 1;
+}
+
+int
+pcm_resampler_get_delay(pcm_resampler_t *resampler)
+{
+    assert(resampler);
+    return resampler->count - (int) (resampler->pos >> 32);
+}
+
+static short
+pcm_resampler_to_short(float v)
+{
+    v *= 32768.0f;
+    if (v >= 32767.0f) {
+        return 32767;
+    } else if (v <= -32768.0f) {
+        return -32768;
+    }
+    return (short) (v < 0.0f ? v - 0.5f : v + 0.5f);
+}
+
+int
+pcm_resampler_process(pcm_resampler_t *resampler, const short *in, int in_frames, short *out, int out_frames)
+{
+    int produced = 0;
+    int keep;
+
+    assert(resampler);
+
+    /* 输入先全部转换到历史数据中,所以输出可以覆盖输入 */
+    if (in_frames > PCM_RESAMPLER_HISTORY - resampler->count) {
+        in_frames = PCM_RESAMPLER_HISTORY - resampler->count;
+    }
+    for (int i = 0; i < in_frames; i++) {
+        resampler->left[resampler->count + i] = in[2 * i] * (1.0f / 32768.0f);
+        resampler->right[resampler->count + i] = in[2 * i + 1] * (1.0f / 32768.0f);
+    }
+    resampler->count += in_frames;
+
+    while (produced < out_frames) {
+        int index = (int) (resampler->pos >> 32);
+        uint32_t frac = (uint32_t) resampler->pos;
+        int phase = frac >> (32 - PCM_RESAMPLER_PHASE_BITS);
+        float t = (float) (uint32_t) (frac << PCM_RESAMPLER_PHASE_BITS) * (1.0f / 4294967296.0f);
+        int base = index - PCM_RESAMPLER_TAPS / 2 + 1;
+        float y[2];
+
+        if (base + PCM_RESAMPLER_TAPS > resampler->count) {
+            break;
+        }
+        resampler->kernel(resampler->left + base, resampler->right + base,
+                          resampler->coef + phase * PCM_RESAMPLER_TAPS,
+                          resampler->delta + phase * PCM_RESAMPLER_TAPS, t, y);
+        out[2 * produced] = pcm_resampler_to_short(y[0]);
+        out[2 * produced + 1] = pcm_resampler_to_short(y[1]);
+        produced++;
+        resampler->pos += resampler->step;
+    }
+
+    /* 丢弃以后不会再用到的输入 */
+    keep = (int) (resampler->pos >> 32) - PCM_RESAMPLER_TAPS / 2 + 1;
+    if (keep > resampler->count) {
+        keep = resampler->count;
+    }
+    if (keep > 0) {
+        resampler->count -= keep;
+        memmove(resampler->left, resampler->left + keep, resampler->count * sizeof(float));
+        memmove(resampler->right, resampler->right + keep, resampler->count * sizeof(float));
+        resampler->pos -= (uint64_t) keep << 32;
+    }
+    return produced;
+}
+
+void
+pcm_resampler_destroy(pcm_resampler_t *resampler)
+{
+    if (resampler) {
+        ALIGNED_FREE(resampler->coef);
+        free(resampler);
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * 双声道pcm的采样率转换
+ * 多相的Kaiser窗sinc滤波器,相位之间线性插值,所以转换比例可以是任意值,
+ * 比例用32.32定点数表示,可以按ppm微调,用来补偿发送端和输出设备的时钟漂移
+ * 卷积使用SSE/AVX2/NEON,其他平台用标量实现
+ * 非线程安全,由调用者加锁
+ */
+
+#ifndef PCM_RESAMPLER_H
+#define PCM_RESAMPLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 支持的采样率范围 */
+#define PCM_RESAMPLER_MIN_RATE 8000
+#define PCM_RESAMPLER_MAX_RATE 192000
+/* 每次process最多输入的帧数 */
+#define PCM_RESAMPLER_MAX_INPUT 4096
+/* 漂移补偿的上限 ppm */
+#define PCM_RESAMPLER_MAX_DRIFT 1000
+
+typedef struct pcm_resampler_s pcm_resampler_t;
+
+pcm_resampler_t *pcm_resampler_init(unsigned int in_rate, unsigned int out_rate);
+/* 清空历史数据,flush之后调用 */
+void pcm_resampler_reset(pcm_resampler_t *resampler);
+/* 输入相对标称采样率偏快的ppm,正数时每个输出帧消耗更多的输入 */
+void pcm_resampler_set_drift(pcm_resampler_t *resampler, double ppm);
+double pcm_resampler_get_drift(pcm_resampler_t *resampler);
+/* 输入in_frames帧时最多输出的帧数 */
+int pcm_resampler_max_output(pcm_resampler_t *resampler, int in_frames);
+/* 已经输入还没有输出的采样数,下次process的第一个输出采样比输入的第一个采样早这么多 */
+int pcm_resampler_get_delay(pcm_resampler_t *resampler);
+/* 输入in_frames帧交错的双声道pcm,输出最多out_frames帧,返回输出的帧数,in和out可以是同一块内存 */
+int pcm_resampler_process(pcm_resampler_t *resampler, const short *in, int in_frames, short *out, int out_frames);
+void pcm_resampler_destroy(pcm_resampler_t *resampler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //PCM_RESAMPLER_H
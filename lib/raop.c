@@ -29,6 +29,12 @@
 #include "logger.h"
 #include "compat.h"
 #include "raop_rtp_mirror.h"
+#include "raop_ntp.h"
+#include "raop_buffered.h"
+#include "raop_pool.h"
+
+/* 默认预先准备的会话数 */
+#define RAOP_DEFAULT_POOL_SESSIONS 1
 
 struct raop_s {
 	/* Callbacks for audio */
@@ -41,13 +47,42 @@ struct raop_s {
 	pairing_t *pairing;
 	httpd_t *httpd;
 
+    /* 预先准备的会话资源 */
+    raop_pool_t *pool;
+
     unsigned short port;
+
+    /* 音频接收和解码是否分线程 */
+    int audio_pipeline;
+    /* 音频播放的目标延迟 ms */
+    unsigned int audio_latency;
+    /* 音频丢包补偿方法 */
+    int audio_conceal_method;
+    /* 音频由应用主动读取 */
+    int audio_pull;
+    /* audio_process_batch每次回调的帧数 */
+    unsigned int audio_batch_frames;
+    /* 静音帧的处理方式和阈值 */
+    int audio_silence_mode;
+    int audio_silence_threshold;
+    /* 音量的处理方式 */
+    int audio_gain_mode;
+    /* 回调的采样率,0表示不转换 */
+    unsigned int audio_output_rate;
+    /* 回调的pcm格式 */
+    int audio_format;
+    int audio_channels;
+    int audio_planar;
+    /* 应用输出设备的延迟 ms */
+    unsigned int audio_sink_latency;
 };
 
 struct raop_conn_s {
 	raop_t *raop;
 	raop_rtp_t *raop_rtp;
 	raop_rtp_mirror_t *raop_rtp_mirror;
+	raop_ntp_t *raop_ntp;
+	raop_buffered_t *raop_buffered;
 	fairplay_t *fairplay;
 	pairing_session_t *pairing;
 	unsigned char *local;
@@ -185,6 +220,10 @@ conn_request(void *ptr, http_request_t *request, http_response_t **response)
 		} else {
 			logger_log(conn->raop->logger, LOGGER_WARNING, "RAOP not initialized at FLUSH");
 		}
+	} else if (!strcmp(method, "SETRATEANCHORTIME")) {
+		handler = &raop_handler_setrateanchortime;
+	} else if (!strcmp(method, "FLUSHBUFFERED")) {
+		handler = &raop_handler_flushbuffered;
 	} else if (!strcmp(method, "TEARDOWN")) {
 		http_response_add_header(*response, "Connection", "close");
         handler = &raop_handler_teardown;
@@ -212,6 +251,12 @@ conn_destroy(void *ptr)
     if (conn->raop_rtp_mirror) {
         /* This is done in case TEARDOWN was not called */
         raop_rtp_mirror_destroy(conn->raop_rtp_mirror);
+    }
+    if (conn->raop_buffered) {
+        raop_buffered_destroy(conn->raop_buffered);
+    }
+    if (conn->raop_ntp) {
+        raop_ntp_destroy(conn->raop_ntp);
     }
 	free(conn->local);
 	free(conn->remote);
@@ -252,8 +297,16 @@ raop_init(int max_clients, raop_callbacks_t *callbacks)
 
 	/* Initialize the logger */
 	raop->logger = logger_init();
+	raop->pool = raop_pool_init(raop->logger, RAOP_DEFAULT_POOL_SESSIONS);
+	if (!raop->pool) {
+		logger_destroy(raop->logger);
+		free(raop);
+		return NULL;
+	}
 	pairing = pairing_init_generate();
 	if (!pairing) {
+		raop_pool_destroy(raop->pool);
+		logger_destroy(raop->logger);
 		free(raop);
 		return NULL;
 	}
@@ -269,6 +322,8 @@ raop_init(int max_clients, raop_callbacks_t *callbacks)
 	httpd = httpd_init(raop->logger, &httpd_cbs, max_clients);
 	if (!httpd) {
 		pairing_destroy(pairing);
+		raop_pool_destroy(raop->pool);
+		logger_destroy(raop->logger);
 		free(raop);
 		return NULL;
 	}
@@ -276,6 +331,10 @@ raop_init(int max_clients, raop_callbacks_t *callbacks)
 	memcpy(&raop->callbacks, callbacks, sizeof(raop_callbacks_t));
 	raop->pairing = pairing;
 	raop->httpd = httpd;
+	raop->audio_conceal_method = -1;
+	raop->audio_gain_mode = RAOP_AUDIO_GAIN_DITHER;
+	raop->audio_format = PCM_FORMAT_S16;
+	raop->audio_channels = 2;
 	return raop;
 }
 
@@ -287,6 +346,7 @@ raop_destroy(raop_t *raop)
 
 		pairing_destroy(raop->pairing);
 		httpd_destroy(raop->httpd);
+		raop_pool_destroy(raop->pool);
 		logger_destroy(raop->logger);
 		free(raop);
 
@@ -318,6 +378,98 @@ raop_set_port(raop_t *raop, unsigned short port)
     raop->port = port;
 }
 
+void
+raop_set_audio_pipeline(raop_t *raop, int enabled)
+{
+    assert(raop);
+    raop->audio_pipeline = enabled;
+}
+
+void
+raop_set_audio_latency(raop_t *raop, unsigned int latency_ms)
+{
+    assert(raop);
+    raop->audio_latency = latency_ms;
+}
+
+void
+raop_set_audio_conceal_method(raop_t *raop, int method)
+{
+    assert(raop);
+    raop->audio_conceal_method = method;
+}
+
+void
+raop_set_audio_pull(raop_t *raop, int enabled)
+{
+    assert(raop);
+    raop->audio_pull = enabled;
+}
+
+void
+raop_set_audio_batch_frames(raop_t *raop, unsigned int frames)
+{
+    assert(raop);
+    raop->audio_batch_frames = frames;
+}
+
+void
+raop_set_audio_silence(raop_t *raop, int mode, int threshold)
+{
+    assert(raop);
+    raop->audio_silence_mode = mode;
+    raop->audio_silence_threshold = threshold;
+}
+
+void
+raop_set_audio_sink_latency(raop_t *raop, unsigned int latency_ms)
+{
+    assert(raop);
+    raop->audio_sink_latency = latency_ms;
+}
+
+void
+raop_set_audio_gain(raop_t *raop, int mode)
+{
+    assert(raop);
+    raop->audio_gain_mode = mode;
+}
+
+void
+raop_set_audio_output_rate(raop_t *raop, unsigned int rate)
+{
+    assert(raop);
+    raop->audio_output_rate = rate;
+}
+
+void
+raop_set_audio_format(raop_t *raop, int format, int channels, int planar)
+{
+    assert(raop);
+    raop->audio_format = format;
+    raop->audio_channels = channels;
+    raop->audio_planar = planar;
+}
+
+void
+raop_set_session_pool(raop_t *raop, int sessions)
+{
+    assert(raop);
+    raop_pool_set_size(raop->pool, sessions);
+}
+
+int
+raop_audio_read(raop_audio_t *audio, void *pcm, int frames, uint64_t *pts)
+{
+    return raop_rtp_read(audio, pcm, frames, pts);
+}
+
+void
+raop_audio_set_latency(raop_audio_t *audio, unsigned int latency_ms)
+{
+    raop_rtp_set_latency(audio, latency_ms);
+}
+
 unsigned short
 raop_get_port(raop_t *raop)
 {
@@ -19,7 +19,19 @@ extern "C" {
 #define RAOP_LOG_DEBUG       7       /* debug-level messages */
 
 
+/* 静音帧的处理方式 */
+#define RAOP_AUDIO_SILENCE_OFF    0       /* 不检测 */
+#define RAOP_AUDIO_SILENCE_SKIP   1       /* 静音帧不回调 */
+#define RAOP_AUDIO_SILENCE_EVENT  2       /* 静音帧不回调,一段静音结束时回调一次audio_silence */
+
+/* 音量的处理方式 */
+#define RAOP_AUDIO_GAIN_OFF       0       /* 库内不处理,由应用按audio_set_volume处理 */
+#define RAOP_AUDIO_GAIN_ON        1       /* 解码后在库内处理,音量变化时在一帧内平滑过渡 */
+#define RAOP_AUDIO_GAIN_DITHER    2       /* 同ON,衰减时加TPDF抖动 */
+
 typedef struct raop_s raop_t;
+/* pull模式下读取音频使用的句柄 */
+typedef struct raop_rtp_s raop_audio_t;
 
 typedef void (*raop_log_callback_t)(void *cls, int level, const char *msg);
 
@@ -39,6 +51,16 @@ struct raop_callbacks_s {
 	void  (*audio_set_coverart)(void *cls, void *session, const void *buffer, int buflen);
 	void  (*audio_remote_control_id)(void *cls, const char *dacp_id, const char *active_remote_header);
 	void  (*audio_set_progress)(void *cls, void *session, unsigned int start, unsigned int curr, unsigned int end);
+	/* 大约每秒回调一次音频链路统计 */
+	void  (*audio_stats)(void *cls, void *session, audio_stats_struct *stats);
+	/* pull模式下在audio_init之后回调,audio在audio_destroy返回之前有效 */
+	void  (*audio_pull_init)(void *cls, void *session, raop_audio_t *audio);
+	/* 设置后代替audio_process,一次回调多帧 */
+	void  (*audio_process_batch)(void *cls, void *session, pcm_batch_struct *batch);
+	/* RAOP_AUDIO_SILENCE_EVENT模式下一段静音结束时回调,pts是第一个静音采样的时间,samples是静音的采样数 */
+	void  (*audio_silence)(void *cls, void *session, uint64_t pts, unsigned int samples);
+	/* 每个音频会话开始时回调,audio在audio_destroy返回之前有效,用于raop_audio_set_latency等按会话的设置 */
+	void  (*audio_session_init)(void *cls, void *session, raop_audio_t *audio);
 };
 typedef struct raop_callbacks_s raop_callbacks_t;
 
@@ -48,6 +70,36 @@ void raop_set_log_level(raop_t *raop, int level);
 void raop_set_log_callback(raop_t *raop, raop_log_callback_t callback, void *cls);
 void raop_set_port(raop_t *raop, unsigned short port);
 unsigned short raop_get_port(raop_t *raop);
+/* 开启后接收和解码在不同线程,audio_process,audio_flush和audio_stats在解码线程回调,需要在raop_start之前设置 */
+void raop_set_audio_pipeline(raop_t *raop, int enabled);
+/* 音频播放的目标延迟 ms,0使用默认值,对之后建立的连接生效,单个会话用raop_audio_set_latency修改 */
+void raop_set_audio_latency(raop_t *raop, unsigned int latency_ms);
+/* 修改一个会话的目标延迟 ms,0使用默认值,立即生效,已经在buffer中的帧按新的延迟播放 */
+void raop_audio_set_latency(raop_audio_t *audio, unsigned int latency_ms);
+/* 音频丢包补偿方法 0:静音 1:噪声替代 2:能量插值(多一帧延迟),小于0使用解码器默认值 */
+void raop_set_audio_conceal_method(raop_t *raop, int method);
+/* 开启后不再回调audio_process,由输出设备的回调调用raop_audio_read取数据,需要设置audio_pull_init,优先于pipeline,对之后建立的连接生效 */
+void raop_set_audio_pull(raop_t *raop, int enabled);
+/* 读取frames帧pcm,格式见raop_set_audio_format,数据不够时用丢包补偿或静音补齐,pts是第一帧的时间,返回读取的帧数,出错返回-1 */
+int raop_audio_read(raop_audio_t *audio, void *pcm, int frames, uint64_t *pts);
+/* 使用audio_process_batch时每次回调的帧数,0表示每次出队的所有帧一起回调,对之后建立的连接生效
+   最早的帧最多多等frames-1帧的时间,到时不满一批也回调 */
+void raop_set_audio_batch_frames(raop_t *raop, unsigned int frames);
+/* 所有采样的绝对值不超过threshold的帧当作静音,mode为RAOP_AUDIO_SILENCE_*,pull模式下不生效,对之后建立的连接生效 */
+void raop_set_audio_silence(raop_t *raop, int mode, int threshold);
+/* 应用输出设备的延迟 ms,加到RECORD应答的Audio-Latency中,对之后的RECORD生效 */
+void raop_set_audio_sink_latency(raop_t *raop, unsigned int latency_ms);
+/* 音量的处理方式,mode为RAOP_AUDIO_GAIN_*,默认RAOP_AUDIO_GAIN_DITHER,audio_set_volume仍然回调,对之后建立的连接生效 */
+void raop_set_audio_gain(raop_t *raop, int mode);
+/* 回调和raop_audio_read的采样率,0或44100表示不转换,按发送端和输出设备的时钟漂移微调,对之后建立的连接生效 */
+void raop_set_audio_output_rate(raop_t *raop, unsigned int rate);
+/**
+ * 回调和raop_audio_read的pcm格式,format为PCM_FORMAT_*,channels为1时两个声道混成单声道,
+ * planar为1时分声道存放,默认是交错的16位双声道,不支持的组合使用默认格式,对之后建立的连接生效
+ */
+void raop_set_audio_format(raop_t *raop, int format, int channels, int planar);
+/* 预先准备的会话资源数(jitter buffer,解码器和端口),0表示不预先创建,默认1,最多8 */
+void raop_set_session_pool(raop_t *raop, int sessions);
 void *raop_get_callback_cls(raop_t *raop);
 int raop_start(raop_t *raop, unsigned short *port);
 int raop_is_running(raop_t *raop);
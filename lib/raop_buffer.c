@@ -27,13 +27,27 @@
 #include "compat.h"
 #include "stream.h"
 #include "aac_decoder.h"
+#include "byteutils.h"
 
 #define RAOP_BUFFER_LENGTH 512
+/* 占用位图的字数,RAOP_BUFFER_LENGTH必须是64的倍数 */
+#define RAOP_BUFFER_WORDS (RAOP_BUFFER_LENGTH / 64)
+/* 每个包的音频数据最大长度,AAC-ELD每帧远小于这个值 */
+#define RAOP_BUFFER_PAYLOAD_LEN 2048
 
-typedef struct {
-	/* Packet available */
-	int available;
+/* period size 480 samples */
+#define N_SAMPLE 480
+
+/* 发现缺包后等待乱序包的时间 us */
+#define RAOP_BUFFER_REORDER_DELAY 2000
+/* 重传超时 us,没有测到往返时间时使用初始值 */
+#define RAOP_BUFFER_INITIAL_RTO 50000
+#define RAOP_BUFFER_MIN_RTO 10000
+#define RAOP_BUFFER_MAX_RTO 500000
+/* 每个包最多请求重传的次数 */
+#define RAOP_BUFFER_MAX_RESENDS 3
 
+typedef struct {
 	/* RTP header */
 	unsigned char flags;
 	unsigned char type;
@@ -41,11 +55,17 @@ typedef struct {
 	unsigned int timestamp;
 	unsigned int ssrc;
 
-	/* 内存大小 */
-	int audio_buffer_size;
-	/* 解码后长度 */
-	int audio_buffer_len;
-	void *audio_buffer;
+	/* 未解密的音频数据,出队时才解密解码 */
+	int payload_len;
+	unsigned char *payload;
+
+	/* 缺包时的重传状态,seqnum为缺失的序号,generation和buffer不同时无效 */
+	unsigned int generation;
+	int missing;
+	int resend_count;
+	/* 下次请求重传的时间和最近一次请求的时间 us,resend_time为0表示不再请求 */
+	uint64_t resend_time;
+	uint64_t request_time;
 } raop_buffer_entry_t;
 
 struct raop_buffer_s {
@@ -53,6 +73,12 @@ struct raop_buffer_s {
 	/* 解密使用的key and IV */
 	unsigned char aeskey[RAOP_AESKEY_LEN];
 	unsigned char aesiv[RAOP_AESIV_LEN];
+	/* 解密key schedule,每个session只计算一次 */
+	AES_CTX aes_ctx;
+	/* 解密输出的临时缓存 */
+	unsigned char packetbuf[RAOP_BUFFER_PAYLOAD_LEN];
+	/* 出队没有指定输出时的解码输出 */
+	short pcmbuf[2 * N_SAMPLE];
 
     aac_decoder_t *aac_decoder;
 	/* First and last seqnum */
@@ -64,6 +90,37 @@ struct raop_buffer_s {
 
 	/* RTP buffer entries */
 	raop_buffer_entry_t entries[RAOP_BUFFER_LENGTH];
+	/* 占用位图,第i位表示entries[i]中有包 */
+	uint64_t bitmap[RAOP_BUFFER_WORDS];
+	/* 每次flush加一,使所有entry的重传状态失效 */
+	unsigned int generation;
+
+	/* 播放时间基准:anchor_timestamp的包最早在anchor_time(us)到达 */
+	int has_anchor;
+	unsigned int anchor_timestamp;
+	uint64_t anchor_time;
+	/* 下一个要播放的包的timestamp,包丢失时用它计算deadline */
+	int has_timestamp;
+	unsigned int next_timestamp;
+	/* 到达时间抖动 us,计算方法同RFC 3550 */
+	unsigned int jitter;
+	uint64_t last_arrival;
+	unsigned int last_arrival_timestamp;
+	/* 目标延迟 us */
+	unsigned int target_latency;
+
+	/* 出现新的缺包,需要重新扫描 */
+	int resend_scan;
+	/* 最早的重传定时,0表示没有 */
+	uint64_t resend_deadline;
+	/* 重传往返时间 us,计算方法同RFC 6298 */
+	unsigned int srtt;
+	unsigned int rttvar;
+	unsigned int rto;
+	/* 重传统计,累计值 */
+	unsigned int resend_requested;
+	unsigned int resend_recovered;
+	unsigned int resend_abandoned;
 
 	/* Buffer of all audio buffers */
 	int buffer_size;
@@ -72,13 +129,22 @@ struct raop_buffer_s {
 
 static int fdk_flags = 0;
 
-/* period size 480 samples */
-#define N_SAMPLE 480
+//#define DUMP_AUDIO
+
+#ifdef DUMP_AUDIO
+static FILE* file_aac = NULL;
+static FILE* file_source = NULL;
+static FILE* file_keyiv = NULL;
+static FILE* file_pcm = NULL;
+#endif
 
 static int pcm_pkt_size = 4 * N_SAMPLE;
 
+/* 采样率 */
+#define SAMPLE_RATE 44100
+
 void
-raop_buffer_init_key_iv(raop_buffer_t *raop_buffer,
+raop_buffer_set_key(raop_buffer_t *raop_buffer,
                      const unsigned char *aeskey,
                      const unsigned char *aesiv,
                      const unsigned char *ecdh_secret)
@@ -94,6 +160,9 @@ raop_buffer_init_key_iv(raop_buffer_t *raop_buffer,
     sha512_final(&ctx, eaeskey);
     memcpy(raop_buffer->aeskey, eaeskey, 16);
     memcpy(raop_buffer->aesiv, aesiv, RAOP_AESIV_LEN);
+    /* 预先计算解密用的key schedule */
+    AES_set_key(&raop_buffer->aes_ctx, raop_buffer->aeskey, raop_buffer->aesiv, AES_MODE_128);
+    AES_convert_key(&raop_buffer->aes_ctx);
 #ifdef DUMP_AUDIO
     if (file_keyiv != NULL) {
         fwrite(raop_buffer->aeskey, 16, 1, file_keyiv);
@@ -104,30 +173,22 @@ raop_buffer_init_key_iv(raop_buffer_t *raop_buffer,
 }
 
 raop_buffer_t *
-raop_buffer_init(logger_t *logger,
-                 const unsigned char *aeskey,
-                 const unsigned char *aesiv,
-                 const unsigned char *ecdh_secret)
+raop_buffer_init(logger_t *logger)
 {
 	raop_buffer_t *raop_buffer;
-	int audio_buffer_size;
-	assert(aeskey);
-    assert(aesiv);
-    assert(ecdh_secret);
 	raop_buffer = calloc(1, sizeof(raop_buffer_t));
 	if (!raop_buffer) {
 		return NULL;
 	}
     raop_buffer->logger = logger;
 
-	/* Allocate the output audio buffers */
-    audio_buffer_size = 480 * 2 * 2;
+	/* Allocate the payload buffers */
     raop_buffer->aac_decoder = aac_create(logger);
     if (!raop_buffer->aac_decoder) {
         free(raop_buffer);
         return NULL;
     }
-	raop_buffer->buffer_size = audio_buffer_size * RAOP_BUFFER_LENGTH;
+	raop_buffer->buffer_size = RAOP_BUFFER_PAYLOAD_LEN * RAOP_BUFFER_LENGTH;
 	raop_buffer->buffer = malloc(raop_buffer->buffer_size);
 	if (!raop_buffer->buffer) {
         if (raop_buffer->aac_decoder) {
@@ -136,17 +197,36 @@ raop_buffer_init(logger_t *logger,
 		free(raop_buffer);
 		return NULL;
 	}
+    /* 提前写一遍,第一批包到达时不会缺页 */
+    memset(raop_buffer->buffer, 0, raop_buffer->buffer_size);
+    raop_buffer_reset(raop_buffer);
+	return raop_buffer;
+}
+
+/* 清除会话状态,保留包缓存和解码器,放回资源池之前调用 */
+void
+raop_buffer_reset(raop_buffer_t *raop_buffer)
+{
+    logger_t *logger = raop_buffer->logger;
+    aac_decoder_t *aac_decoder = raop_buffer->aac_decoder;
+    int buffer_size = raop_buffer->buffer_size;
+    void *buffer = raop_buffer->buffer;
+
+    memset(raop_buffer, 0, sizeof(raop_buffer_t));
+    raop_buffer->logger = logger;
+    raop_buffer->aac_decoder = aac_decoder;
+    raop_buffer->buffer_size = buffer_size;
+    raop_buffer->buffer = buffer;
 	for (int i=0; i<RAOP_BUFFER_LENGTH; i++) {
 		raop_buffer_entry_t *entry = &raop_buffer->entries[i];
-		entry->audio_buffer_size = audio_buffer_size;
-		entry->audio_buffer_len = 0;
-		entry->audio_buffer = (char *)raop_buffer->buffer+i*audio_buffer_size;
+		entry->payload_len = 0;
+		entry->payload = (unsigned char *)raop_buffer->buffer+i*RAOP_BUFFER_PAYLOAD_LEN;
 	}
-    raop_buffer_init_key_iv(raop_buffer, aeskey, aesiv, ecdh_secret);
+	raop_buffer->target_latency = RAOP_BUFFER_DEFAULT_LATENCY * 1000;
+	raop_buffer->rto = RAOP_BUFFER_INITIAL_RTO;
 	/* Mark buffer as empty */
 	raop_buffer->is_empty = 1;
-
-	return raop_buffer;
+    aac_reset(aac_decoder);
 }
 
 void
@@ -177,48 +257,273 @@ seqnum_cmp(unsigned short s1, unsigned short s2)
 	return (s1 - s2);
 }
 
-short dithered_vol(int sample, int v) {
-    int out = sample * v;
-/*    if (v < 65536) {
-        out = (out + rand_a) - rand_b;
-    }*/
-    return (short) (out >> 16);
+static int
+bit_ctz(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int) index;
+#else
+	int n = 0;
+	while (!(word & 1)) {
+		word >>= 1;
+		n++;
+	}
+	return n;
+#endif
 }
 
-int
-stuff_buffer(short* input, short* output, int vol) {
-    int i;
-    int i2;
-    int l;
-    int stuffsamp = 480;
-    int l2 = 0;
-    int j = 0;
-    for (i = 0; i < stuffsamp; i++) {
-        i2 = j + 1;
-        l = l2 + 1;
-        output[j] = dithered_vol(input[l2], vol);
-        j = i2 + 1;
-        l2 = l + 1;
-        output[i2] = dithered_vol(input[l], vol);
-    }
-    return 480;
+static int
+bit_popcount(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(word);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	return (int) __popcnt64(word);
+#else
+	int n = 0;
+	while (word) {
+		word &= word - 1;
+		n++;
+	}
+	return n;
+#endif
 }
 
-//#define DUMP_AUDIO
+static int
+raop_buffer_test(raop_buffer_t *raop_buffer, unsigned short seqnum)
+{
+	int slot = seqnum % RAOP_BUFFER_LENGTH;
+	return (raop_buffer->bitmap[slot >> 6] >> (slot & 63)) & 1;
+}
+
+static void
+raop_buffer_set(raop_buffer_t *raop_buffer, unsigned short seqnum)
+{
+	int slot = seqnum % RAOP_BUFFER_LENGTH;
+	raop_buffer->bitmap[slot >> 6] |= (uint64_t) 1 << (slot & 63);
+}
 
+static void
+raop_buffer_clear(raop_buffer_t *raop_buffer, unsigned short seqnum)
+{
+	int slot = seqnum % RAOP_BUFFER_LENGTH;
+	raop_buffer->bitmap[slot >> 6] &= ~((uint64_t) 1 << (slot & 63));
+}
+
+/**
+ * 从seqnum开始的count个序号中,找第一个有包(set为1)或缺包(set为0)的位置,返回相对seqnum的偏移,
+ * 没有时返回count.每次处理一个64位字,count不能超过RAOP_BUFFER_LENGTH
+ */
+static int
+raop_buffer_find(raop_buffer_t *raop_buffer, unsigned short seqnum, int count, int set)
+{
+	int slot = seqnum % RAOP_BUFFER_LENGTH;
+	int offset = 0;
+	while (offset < count) {
+		int shift = slot & 63;
+		uint64_t word = raop_buffer->bitmap[slot >> 6];
+		if (!set) {
+			word = ~word;
+		}
+		word >>= shift;
+		if (word) {
+			offset += bit_ctz(word);
+			return offset < count ? offset : count;
+		}
+		offset += 64 - shift;
+		slot = (slot + 64 - shift) % RAOP_BUFFER_LENGTH;
+	}
+	return count;
+}
+
+/* 从seqnum开始的count个序号中有包的个数 */
+static int
+raop_buffer_count(raop_buffer_t *raop_buffer, unsigned short seqnum, int count)
+{
+	int slot = seqnum % RAOP_BUFFER_LENGTH;
+	int total = 0;
+	while (count > 0) {
+		int shift = slot & 63;
+		int n = 64 - shift < count ? 64 - shift : count;
+		uint64_t word = raop_buffer->bitmap[slot >> 6] >> shift;
+		if (n < 64) {
+			word &= ((uint64_t) 1 << n) - 1;
+		}
+		total += bit_popcount(word);
+		count -= n;
+		slot = (slot + n) % RAOP_BUFFER_LENGTH;
+	}
+	return total;
+}
+
+/* entry是seqnum的缺包并且状态在本次flush之后建立 */
+static int
+raop_buffer_is_missing(raop_buffer_t *raop_buffer, raop_buffer_entry_t *entry, unsigned short seqnum)
+{
+	return entry->missing && entry->generation == raop_buffer->generation && entry->seqnum == seqnum;
+}
+
+void
+raop_buffer_set_latency(raop_buffer_t *raop_buffer, unsigned int latency_ms)
+{
+	assert(raop_buffer);
+	if (latency_ms > RAOP_BUFFER_MAX_LATENCY) {
+		latency_ms = RAOP_BUFFER_MAX_LATENCY;
+	}
+	raop_buffer->target_latency = latency_ms * 1000;
+}
+
+/* 解密并解码一个包到output,必须按序号顺序调用 */
+static void
+raop_buffer_decode(raop_buffer_t *raop_buffer, raop_buffer_entry_t *entry, short *output)
+{
+    int payloadsize = entry->payload_len;
+    int encryptedlen = payloadsize/16*16;
+    unsigned char *packetbuf = raop_buffer->packetbuf;
+    /* 每个包都从原始IV开始解密,key schedule复用 */
+    memcpy(raop_buffer->aes_ctx.iv, raop_buffer->aesiv, RAOP_AESIV_LEN);
+    AES_cbc_decrypt(&raop_buffer->aes_ctx, entry->payload, packetbuf, encryptedlen);
+    memcpy(packetbuf+encryptedlen, entry->payload+encryptedlen, payloadsize-encryptedlen);
 #ifdef DUMP_AUDIO
-static FILE* file_aac = NULL;
-static FILE* file_source = NULL;
-static FILE* file_keyiv = NULL;
-static FILE* file_pcm = NULL;
+    /* 解密的文件 */
+    if (file_aac != NULL) {
+        fwrite(packetbuf, payloadsize, 1, file_aac);
+    }
+#endif
+    /* aac解码pcm */
+    int ret = aac_decode_frame(raop_buffer->aac_decoder, packetbuf, payloadsize, output, pcm_pkt_size);
+    if (ret != AAC_DEC_OK) {
+        logger_log(raop_buffer->logger, LOGGER_ERR, "aac_decode_frame error : 0x%x", ret);
+    }
+#ifdef DUMP_AUDIO
+    if (file_pcm != NULL) {
+        fwrite(output, pcm_pkt_size, 1, file_pcm);
+    }
 #endif
+}
+
+static uint64_t
+raop_buffer_arrival_time(raop_buffer_t *raop_buffer, unsigned int timestamp)
+{
+	int diff = (int) (timestamp - raop_buffer->anchor_timestamp);
+	return raop_buffer->anchor_time + (int64_t) diff * 1000000 / SAMPLE_RATE;
+}
+
+/* 目标延迟 + 抖动余量 us */
+static uint64_t
+raop_buffer_playout_delay(raop_buffer_t *raop_buffer)
+{
+	uint64_t delay = raop_buffer->target_latency + 4 * (uint64_t) raop_buffer->jitter;
+	if (delay > RAOP_BUFFER_MAX_LATENCY * 1000) {
+		delay = RAOP_BUFFER_MAX_LATENCY * 1000;
+	}
+	return delay;
+}
+
+/* 播放时间 = 推算的到达时间 + 目标延迟 + 抖动余量 */
+static uint64_t
+raop_buffer_playout_time(raop_buffer_t *raop_buffer, unsigned int timestamp)
+{
+	return raop_buffer_arrival_time(raop_buffer, timestamp) + raop_buffer_playout_delay(raop_buffer);
+}
+
+unsigned int
+raop_buffer_get_playout_delay(raop_buffer_t *raop_buffer)
+{
+	assert(raop_buffer);
+	return (unsigned int) raop_buffer_playout_delay(raop_buffer);
+}
+
+/* 根据到达时间更新时间基准和抖动 */
+static void
+raop_buffer_update_timing(raop_buffer_t *raop_buffer, unsigned short seqnum, unsigned int timestamp, uint64_t arrival)
+{
+	if (!raop_buffer->has_anchor) {
+		raop_buffer->anchor_timestamp = timestamp;
+		raop_buffer->anchor_time = arrival;
+		raop_buffer->last_arrival_timestamp = timestamp;
+		raop_buffer->last_arrival = arrival;
+		raop_buffer->has_anchor = 1;
+		return;
+	}
+	/* 只用连续的包计算,重传和乱序的包不参与 */
+	if (seqnum_cmp(seqnum, raop_buffer->last_seqnum) != 1) {
+		return;
+	}
+	int64_t transit = (int64_t) (arrival - raop_buffer->last_arrival) -
+	        (int64_t) (int) (timestamp - raop_buffer->last_arrival_timestamp) * 1000000 / SAMPLE_RATE;
+	if (transit < 0) {
+		transit = -transit;
+	}
+	raop_buffer->jitter += (int) ((transit - (int64_t) raop_buffer->jitter) / 16);
+	raop_buffer->last_arrival_timestamp = timestamp;
+	raop_buffer->last_arrival = arrival;
+
+	/* 比推算更早到达时使用新的基准,否则缓慢后移以跟随两端时钟的漂移 */
+	uint64_t expected = raop_buffer_arrival_time(raop_buffer, timestamp);
+	raop_buffer->anchor_timestamp = timestamp;
+	if (arrival < expected) {
+		raop_buffer->anchor_time = arrival;
+	} else {
+		raop_buffer->anchor_time = expected + ((arrival - expected) >> 10);
+	}
+}
+
+/* 用重传请求到重传包到达的时间更新往返时间和重传超时 */
+static void
+raop_buffer_update_rtt(raop_buffer_t *raop_buffer, unsigned int rtt)
+{
+	if (raop_buffer->srtt == 0) {
+		raop_buffer->srtt = rtt;
+		raop_buffer->rttvar = rtt / 2;
+	} else {
+		int delta = (int) rtt - (int) raop_buffer->srtt;
+		if (delta < 0) {
+			delta = -delta;
+		}
+		raop_buffer->rttvar += (delta - (int) raop_buffer->rttvar) / 4;
+		raop_buffer->srtt += ((int) rtt - (int) raop_buffer->srtt) / 8;
+	}
+	raop_buffer->rto = raop_buffer->srtt + 4 * raop_buffer->rttvar;
+	if (raop_buffer->rto < RAOP_BUFFER_MIN_RTO) {
+		raop_buffer->rto = RAOP_BUFFER_MIN_RTO;
+	} else if (raop_buffer->rto > RAOP_BUFFER_MAX_RTO) {
+		raop_buffer->rto = RAOP_BUFFER_MAX_RTO;
+	}
+}
 
+void
+raop_buffer_set_conceal_method(raop_buffer_t *raop_buffer, int method)
+{
+	assert(raop_buffer);
+	aac_set_conceal_method(raop_buffer->aac_decoder, method);
+}
+
+uint64_t
+raop_buffer_get_deadline(raop_buffer_t *raop_buffer)
+{
+	raop_buffer_entry_t *entry;
+
+	assert(raop_buffer);
+	if (raop_buffer->is_empty || !raop_buffer->has_anchor ||
+	    seqnum_cmp(raop_buffer->last_seqnum, raop_buffer->first_seqnum) < 0) {
+		return 0;
+	}
+	entry = &raop_buffer->entries[raop_buffer->first_seqnum % RAOP_BUFFER_LENGTH];
+	if (raop_buffer_test(raop_buffer, raop_buffer->first_seqnum)) {
+		return raop_buffer_playout_time(raop_buffer, entry->timestamp);
+	}
+	return raop_buffer_playout_time(raop_buffer, raop_buffer->next_timestamp);
+}
 
 int
-raop_buffer_queue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned short datalen, raop_callbacks_t *callbacks)
+raop_buffer_queue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned short datalen, uint64_t arrival, raop_callbacks_t *callbacks)
 {
     assert(raop_buffer);
-    int encryptedlen;
     raop_buffer_entry_t *entry;
 #ifdef DUMP_AUDIO
     if (file_aac == NULL) {
@@ -238,6 +543,10 @@ raop_buffer_queue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned shor
         return 0;
     }
     int payloadsize = datalen - 12;
+    if (payloadsize > RAOP_BUFFER_PAYLOAD_LEN) {
+        logger_log(raop_buffer->logger, LOGGER_WARNING, "raop_buffer_queue payload too large: %d", payloadsize);
+        return 0;
+    }
 #ifdef DUMP_AUDIO
     /* 未解密的文件 */
     if (file_source != NULL) {
@@ -255,10 +564,18 @@ raop_buffer_queue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned shor
 		raop_buffer_flush(raop_buffer, seqnum);
 	}
 	entry = &raop_buffer->entries[seqnum % RAOP_BUFFER_LENGTH];
-	if (entry->available && seqnum_cmp(entry->seqnum, seqnum) == 0) {
+	if (raop_buffer_test(raop_buffer, seqnum) && seqnum_cmp(entry->seqnum, seqnum) == 0) {
 		/* Packet resend, we can safely ignore */
 		return 0;
 	}
+	if (raop_buffer_is_missing(raop_buffer, entry, seqnum) && entry->resend_count > 0) {
+		raop_buffer->resend_recovered++;
+		/* 只请求过一次时才能确定是哪个请求的应答 */
+		if (entry->resend_count == 1 && arrival > entry->request_time) {
+			raop_buffer_update_rtt(raop_buffer, (unsigned int) (arrival - entry->request_time));
+		}
+	}
+	entry->missing = 0;
     entry->flags = data[0];
     entry->type = data[1];
     entry->seqnum = seqnum;
@@ -267,38 +584,11 @@ raop_buffer_queue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned shor
                        (data[6] << 8) | data[7];
     entry->ssrc = (data[8] << 24) | (data[9] << 16) |
                   (data[10] << 8) | data[11];
-    entry->available = 1;
+	raop_buffer_set(raop_buffer, seqnum);
 	//logger_log(raop_buffer->logger, LOGGER_DEBUG, "rtp audio data_timestamp = %u", entry->timestamp);
-    encryptedlen = payloadsize/16*16;
-    unsigned char *packetbuf = malloc(payloadsize);
-    if (!packetbuf) {
-		logger_log(raop_buffer->logger, LOGGER_ERR, "packetbuf malloc failed");
-    	return -2;
-    }
-    memset(packetbuf, 0, payloadsize);
-	/* 需要在内部初始化 */
-    AES_CTX aes_ctx_audio;
-	AES_set_key(&aes_ctx_audio, raop_buffer->aeskey, raop_buffer->aesiv, AES_MODE_128);
-	AES_convert_key(&aes_ctx_audio);
-    AES_cbc_decrypt(&aes_ctx_audio, &data[12], packetbuf, encryptedlen);
-    memcpy(packetbuf+encryptedlen, &data[12+encryptedlen], payloadsize-encryptedlen);
-#ifdef DUMP_AUDIO
-    /* 解密的文件 */
-    if (file_aac != NULL) {
-        fwrite(packetbuf, payloadsize, 1, file_aac);
-    }
-#endif
-    /* aac解码pcm */
-    int ret = aac_decode_frame(raop_buffer->aac_decoder, packetbuf, payloadsize, entry->audio_buffer, pcm_pkt_size);
-    if (ret != AAC_DEC_OK) {
-		logger_log(raop_buffer->logger, LOGGER_ERR, "aac_decode_frame error : 0x%x", ret);
-	}
-    entry->audio_buffer_len = pcm_pkt_size;
-#ifdef DUMP_AUDIO
-    if (file_pcm != NULL) {
-        fwrite(entry->audio_buffer, entry->audio_buffer_len, 1, file_pcm);
-    }
-#endif
+    /* 先保存原始数据,到播放时再解密解码,被丢弃的包不浪费解码 */
+    memcpy(entry->payload, &data[12], payloadsize);
+    entry->payload_len = payloadsize;
 
 	/* Update the raop_buffer seqnums */
 	if (raop_buffer->is_empty) {
@@ -306,91 +596,207 @@ raop_buffer_queue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned shor
 		raop_buffer->last_seqnum = seqnum;
 		raop_buffer->is_empty = 0;
 	}
+	if (!raop_buffer->has_timestamp) {
+		/* 由第一个收到的包推算出队列头的timestamp */
+		raop_buffer->next_timestamp = entry->timestamp - seqnum_cmp(seqnum, raop_buffer->first_seqnum) * N_SAMPLE;
+		raop_buffer->has_timestamp = 1;
+	}
+	raop_buffer_update_timing(raop_buffer, seqnum, entry->timestamp, arrival);
 	if (seqnum_cmp(seqnum, raop_buffer->last_seqnum) > 0) {
+		if (seqnum_cmp(seqnum, raop_buffer->last_seqnum) > 1) {
+			raop_buffer->resend_scan = 1;
+		}
 		raop_buffer->last_seqnum = seqnum;
 	}
-	free(packetbuf);
     return 1;
 }
 
 const void *
-raop_buffer_dequeue(raop_buffer_t *raop_buffer, int *length, unsigned int* pts, int no_resend)
+raop_buffer_dequeue(raop_buffer_t *raop_buffer, uint64_t now, void *output, int *length, unsigned int* pts)
 {
+	short *pcm = output ? output : raop_buffer->pcmbuf;
 	short buflen;
 	raop_buffer_entry_t *entry;
+	unsigned int timestamp;
+	int available;
 
 	/* Calculate number of entries in the current buffer */
 	buflen = seqnum_cmp(raop_buffer->last_seqnum, raop_buffer->first_seqnum) + 1;
 
 	/* Cannot dequeue from empty buffer */
-	if (raop_buffer->is_empty || buflen <= 0) {
+	if (raop_buffer->is_empty || buflen <= 0 || !raop_buffer->has_anchor) {
 		return NULL;
 	}
 
 	/* Get the first buffer entry for inspection */
 	entry = &raop_buffer->entries[raop_buffer->first_seqnum % RAOP_BUFFER_LENGTH];
-	if (no_resend) {
-		/* If we do no resends, always return the first entry */
-	} else if (!entry->available) {
-		/* Check how much we have space left in the buffer */
-		if (buflen < RAOP_BUFFER_LENGTH) {
-			/* Return nothing and hope resend gets on time */
-			return NULL;
-		}
-		/* Risk of buffer overrun, return empty buffer */
+	available = raop_buffer_test(raop_buffer, raop_buffer->first_seqnum);
+	timestamp = available ? entry->timestamp : raop_buffer->next_timestamp;
+	if (buflen < RAOP_BUFFER_LENGTH && now < raop_buffer_playout_time(raop_buffer, timestamp)) {
+		/* 还没到播放时间,缺失的包可能还会到达 */
+		return NULL;
 	}
 
 	/* Update buffer and validate entry */
 	raop_buffer->first_seqnum += 1;
-	if (!entry->available) {
-		/* Return an empty audio buffer to skip audio */
-		*length = entry->audio_buffer_size;
-		memset(entry->audio_buffer, 0, *length);
-		return entry->audio_buffer;
-	}
-	entry->available = 0;
-
-	/* Return entry audio buffer */
-	*length = entry->audio_buffer_len;
-	*pts = entry->timestamp;
-	entry->audio_buffer_len = 0;
-	return entry->audio_buffer;
+	raop_buffer->next_timestamp = timestamp + N_SAMPLE;
+	*pts = timestamp;
+	*length = pcm_pkt_size;
+	if (!available) {
+		if (raop_buffer_is_missing(raop_buffer, entry, raop_buffer->first_seqnum - 1) && entry->resend_count > 0) {
+			raop_buffer->resend_abandoned++;
+		}
+		entry->missing = 0;
+		/* 到了播放时间包还没有到,当作丢失,由解码器做丢包补偿 */
+		if (aac_conceal_frame(raop_buffer->aac_decoder, pcm, pcm_pkt_size) != AAC_DEC_OK) {
+			memset(pcm, 0, pcm_pkt_size);
+		}
+		return pcm;
+	}
+	raop_buffer_clear(raop_buffer, raop_buffer->first_seqnum - 1);
+
+	/* 按序号顺序解密解码 */
+	raop_buffer_decode(raop_buffer, entry, pcm);
+	entry->payload_len = 0;
+	return pcm;
+}
+
+uint64_t
+raop_buffer_get_resend_deadline(raop_buffer_t *raop_buffer)
+{
+	assert(raop_buffer);
+	return raop_buffer->resend_deadline;
 }
 
+/**
+ * 给first_seqnum到last_seqnum之间的每个缺包计时,到时间的包合并成区间一次请求重传.
+ * 超过最大次数,或者重传已经赶不上播放时间的包不再请求
+ * 用占用位图直接跳到缺包区间,不逐个检查已经收到的包
+ */
 void
-raop_buffer_handle_resends(raop_buffer_t *raop_buffer, raop_resend_cb_t resend_cb, void *opaque)
+raop_buffer_handle_resends(raop_buffer_t *raop_buffer, uint64_t now, raop_resend_cb_t resend_cb, void *opaque)
 {
+	raop_resend_range_t ranges[RAOP_BUFFER_MAX_RESEND_RANGES];
 	raop_buffer_entry_t *entry;
+	unsigned short seqnum;
+	int count = 0;
+	int full = 0;
+	uint64_t deadline = 0;
+	int offset, end, length;
 
 	assert(raop_buffer);
 	assert(resend_cb);
 
-	if (seqnum_cmp(raop_buffer->first_seqnum, raop_buffer->last_seqnum) < 0) {
-		int seqnum, count;
+	if (!raop_buffer->resend_scan && (raop_buffer->resend_deadline == 0 || now < raop_buffer->resend_deadline)) {
+		return;
+	}
+	raop_buffer->resend_scan = 0;
+	if (raop_buffer->is_empty || !raop_buffer->has_anchor || !raop_buffer->has_timestamp) {
+		raop_buffer->resend_deadline = 0;
+		return;
+	}
 
-		for (seqnum=raop_buffer->first_seqnum; seqnum_cmp(seqnum, raop_buffer->last_seqnum)<0; seqnum++) {
+	length = seqnum_cmp(raop_buffer->last_seqnum, raop_buffer->first_seqnum);
+	if (length > RAOP_BUFFER_LENGTH) {
+		length = RAOP_BUFFER_LENGTH;
+	}
+	offset = 0;
+	while (offset < length) {
+		/* 跳过连续收到的包,找到下一个缺包区间[offset, end) */
+		offset += raop_buffer_find(raop_buffer, raop_buffer->first_seqnum + offset, length - offset, 0);
+		if (offset >= length) {
+			break;
+		}
+		end = offset + raop_buffer_find(raop_buffer, raop_buffer->first_seqnum + offset, length - offset, 1);
+		for (; offset < end; offset++) {
+			seqnum = raop_buffer->first_seqnum + offset;
 			entry = &raop_buffer->entries[seqnum % RAOP_BUFFER_LENGTH];
-			if (entry->available) {
-				break;
+			if (!raop_buffer_is_missing(raop_buffer, entry, seqnum)) {
+				/* 新发现的缺包,先等一下可能乱序到达的包 */
+				entry->missing = 1;
+				entry->generation = raop_buffer->generation;
+				entry->seqnum = seqnum;
+				entry->resend_count = 0;
+				entry->resend_time = now + RAOP_BUFFER_REORDER_DELAY;
+			}
+			if (entry->resend_time == 0) {
+				continue;
+			}
+			if (now >= entry->resend_time && !full) {
+				unsigned int timestamp = raop_buffer->next_timestamp +
+				        seqnum_cmp(seqnum, raop_buffer->first_seqnum) * N_SAMPLE;
+				if (entry->resend_count >= RAOP_BUFFER_MAX_RESENDS ||
+				    now + raop_buffer->srtt >= raop_buffer_playout_time(raop_buffer, timestamp)) {
+					entry->resend_time = 0;
+					continue;
+				}
+				if (count > 0 && (unsigned short) (ranges[count-1].seqnum + ranges[count-1].count) == seqnum) {
+					ranges[count-1].count++;
+				} else if (count < RAOP_BUFFER_MAX_RESEND_RANGES) {
+					ranges[count].seqnum = seqnum;
+					ranges[count].count = 1;
+					count++;
+				} else {
+					/* 区间数满了,剩下的下次再请求 */
+					full = 1;
+					deadline = now;
+					continue;
+				}
+				if (entry->resend_count == 0) {
+					raop_buffer->resend_requested++;
+				}
+				entry->resend_count++;
+				entry->request_time = now;
+				entry->resend_time = now + raop_buffer->rto;
+			}
+			if (entry->resend_time > now && (deadline == 0 || entry->resend_time < deadline)) {
+				deadline = entry->resend_time;
 			}
 		}
-		if (seqnum_cmp(seqnum, raop_buffer->first_seqnum) == 0) {
-			return;
-		}
-		count = seqnum_cmp(seqnum, raop_buffer->first_seqnum);
-		resend_cb(opaque, raop_buffer->first_seqnum, count);
+	}
+	raop_buffer->resend_deadline = deadline;
+	if (count > 0) {
+		resend_cb(opaque, ranges, count);
 	}
 }
 
 void
-raop_buffer_flush(raop_buffer_t *raop_buffer, int next_seq)
+raop_buffer_get_resend_stats(raop_buffer_t *raop_buffer, audio_stats_struct *stats)
+{
+	assert(raop_buffer);
+	stats->resend_requested = raop_buffer->resend_requested;
+	stats->resend_recovered = raop_buffer->resend_recovered;
+	stats->resend_abandoned = raop_buffer->resend_abandoned;
+	stats->resend_rtt_us = raop_buffer->srtt;
+}
+
+int
+raop_buffer_get_depth(raop_buffer_t *raop_buffer)
 {
-	int i;
+	int buflen;
 	assert(raop_buffer);
-	for (i=0; i<RAOP_BUFFER_LENGTH; i++) {
-		raop_buffer->entries[i].available = 0;
-		raop_buffer->entries[i].audio_buffer_len = 0;
+	if (raop_buffer->is_empty) {
+		return 0;
+	}
+	buflen = seqnum_cmp(raop_buffer->last_seqnum, raop_buffer->first_seqnum) + 1;
+	if (buflen <= 0) {
+		return 0;
 	}
+	return raop_buffer_count(raop_buffer, raop_buffer->first_seqnum, buflen < RAOP_BUFFER_LENGTH ? buflen : RAOP_BUFFER_LENGTH);
+}
+
+void
+raop_buffer_flush(raop_buffer_t *raop_buffer, int next_seq)
+{
+	assert(raop_buffer);
+	/* 清空位图,旧的重传状态靠generation失效,不需要遍历entry */
+	memset(raop_buffer->bitmap, 0, sizeof(raop_buffer->bitmap));
+	raop_buffer->generation++;
+	raop_buffer->resend_scan = 0;
+	raop_buffer->resend_deadline = 0;
+	/* flush之后重新建立时间基准 */
+	raop_buffer->has_anchor = 0;
+	raop_buffer->has_timestamp = 0;
 	if (next_seq < 0 || next_seq > 0xffff) {
 		raop_buffer->is_empty = 1;
 	} else {
@@ -15,6 +15,7 @@
 #ifndef RAOP_BUFFER_H
 #define RAOP_BUFFER_H
 
+#include <stdint.h>
 #include "logger.h"
 #include "raop_rtp.h"
 #ifdef __cplusplus
@@ -23,16 +24,42 @@ extern "C" {
 
 typedef struct raop_buffer_s raop_buffer_t;
 
-typedef int (*raop_resend_cb_t)(void *opaque, unsigned short seqno, unsigned short count);
+/* 默认的播放延迟 ms */
+#define RAOP_BUFFER_DEFAULT_LATENCY 100
+/* 延迟不能超过buffer能容纳的时长 */
+#define RAOP_BUFFER_MAX_LATENCY 4000
 
-raop_buffer_t *raop_buffer_init(logger_t *logger,
-                                const unsigned char *aeskey,
-                                const unsigned char *aesiv,
-								const unsigned char *ecdh_secret);
+/* 一次重传回调最多携带的区间数 */
+#define RAOP_BUFFER_MAX_RESEND_RANGES 16
 
-int raop_buffer_queue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned short datalen, raop_callbacks_t *callbacks);
-const void *raop_buffer_dequeue(raop_buffer_t *raop_buffer, int *length, unsigned int* pts, int no_resend);
-void raop_buffer_handle_resends(raop_buffer_t *raop_buffer, raop_resend_cb_t resend_cb, void *opaque);
+typedef struct {
+	unsigned short seqnum;
+	unsigned short count;
+} raop_resend_range_t;
+
+typedef int (*raop_resend_cb_t)(void *opaque, const raop_resend_range_t *ranges, int count);
+
+/* 分配包缓存和解码器,每个会话用raop_buffer_set_key设置密钥 */
+raop_buffer_t *raop_buffer_init(logger_t *logger);
+void raop_buffer_set_key(raop_buffer_t *raop_buffer,
+                         const unsigned char *aeskey,
+                         const unsigned char *aesiv,
+                         const unsigned char *ecdh_secret);
+/* 回到刚创建时的状态,保留包缓存和解码器 */
+void raop_buffer_reset(raop_buffer_t *raop_buffer);
+
+void raop_buffer_set_latency(raop_buffer_t *raop_buffer, unsigned int latency_ms);
+/* 实际使用的播放延迟 us,目标延迟加上按抖动估计的余量 */
+unsigned int raop_buffer_get_playout_delay(raop_buffer_t *raop_buffer);
+void raop_buffer_set_conceal_method(raop_buffer_t *raop_buffer, int method);
+int raop_buffer_queue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned short datalen, uint64_t arrival, raop_callbacks_t *callbacks);
+const void *raop_buffer_dequeue(raop_buffer_t *raop_buffer, uint64_t now, void *output, int *length, unsigned int* pts);
+uint64_t raop_buffer_get_deadline(raop_buffer_t *raop_buffer);
+uint64_t raop_buffer_get_resend_deadline(raop_buffer_t *raop_buffer);
+void raop_buffer_handle_resends(raop_buffer_t *raop_buffer, uint64_t now, raop_resend_cb_t resend_cb, void *opaque);
+void raop_buffer_get_resend_stats(raop_buffer_t *raop_buffer, audio_stats_struct *stats);
+/* buffer中已经收到的包数 */
+int raop_buffer_get_depth(raop_buffer_t *raop_buffer);
 void raop_buffer_flush(raop_buffer_t *raop_buffer, int next_seq);
 void raop_buffer_destroy(raop_buffer_t *raop_buffer);
 #ifdef __cplusplus
@@ -0,0 +1,742 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "raop_buffered.h"
+#include "netutils.h"
+#include "compat.h"
+#include "logger.h"
+#include "timeutils.h"
+#include "packet_ring.h"
+#include "aac_decoder.h"
+#include "crypto.h"
+#include "pcm_gain.h"
+#include "pcm_resampler.h"
+#include "pcm_convert.h"
+
+/* 加密包的队列,AAC每包1024个采样时约95秒 */
+#define RAOP_BUFFERED_STORE_SIZE 4096
+/* 单个加密包的最大长度,256kbps的AAC每包不到800字节 */
+#define RAOP_BUFFERED_SLOT_LEN 2048
+/* rtp头12字节,之后是密文,16字节tag和8字节nonce */
+#define RAOP_BUFFERED_HEADER_LEN 12
+#define RAOP_BUFFERED_TRAILER_LEN 24
+
+#define RAOP_BUFFERED_SAMPLE_RATE 44100
+#define RAOP_BUFFERED_MAX_SPF 1024
+/* 已解码等待播放的帧数上限 */
+#define RAOP_BUFFERED_PCM_FRAMES 256
+/* 已解码的数据低于低水位时开始成批解码,到高水位为止 ms */
+#define RAOP_BUFFERED_LOW_WATER 500
+#define RAOP_BUFFERED_HIGH_WATER 2000
+/* 比播放时间提前回调 us,超过播放时间这么久的帧直接丢弃 */
+#define RAOP_BUFFERED_DELIVER_AHEAD 20000
+#define RAOP_BUFFERED_MAX_LATE 100000
+/* 解码线程最长休眠 ms */
+#define RAOP_BUFFERED_MAX_WAIT 20
+/* 更新采样率转换漂移补偿的间隔 us */
+#define RAOP_BUFFERED_DRIFT_INTERVAL 1000000
+
+typedef struct {
+    int seqnum;
+    unsigned int timestamp;
+    int len;
+    short data[2 * RAOP_BUFFERED_MAX_SPF];
+} raop_buffered_frame_t;
+
+struct raop_buffered_s {
+    logger_t *logger;
+    raop_callbacks_t callbacks;
+    raop_ntp_t *ntp;
+
+    unsigned char key[CHACHA20_POLY1305_KEY_SIZE];
+    aac_decoder_t *aac;
+    int spf;
+    /* 音量在回调之前处理,解码缓冲中保存原始数据 */
+    int gain_mode;
+    pcm_gain_t *gain;
+    /* 输出采样率和44100不同时在回调之前转换,按发送端时钟的漂移微调 */
+    pcm_resampler_t *resampler;
+    short *resample_buf;
+    int resample_frames;
+    uint64_t drift_time;
+    /* 回调的格式,不是交错的16位双声道时转换到convert_buf,按需要扩大 */
+    int format;
+    int channels;
+    int planar;
+    pcm_convert_t *convert;
+    void *convert_buf;
+    int convert_frames;
+    int low_frames;
+    int high_frames;
+
+    /* 接收线程写入,解码线程读出 */
+    packet_ring_t *store;
+
+    int dsock;
+    unsigned short data_lport;
+
+    /* MUTEX LOCKED VARIABLES START */
+    int running;
+    int joined;
+    /* 播放锚点,rate为0时暂停 */
+    int rate;
+    int anchor_valid;
+    unsigned int anchor_rtp;
+    uint64_t anchor_time;
+    int flush;
+    int flush_from;
+    int flush_seq;
+    thread_handle_t recv_thread;
+    thread_handle_t decode_thread;
+    mutex_handle_t run_mutex;
+    cond_handle_t run_cond;
+    /* MUTEX LOCKED VARIABLES END */
+
+    /* 以下只在解码线程中使用 */
+    raop_buffered_frame_t *frames;
+    int frame_head;
+    int frame_count;
+    /* 正在丢弃until之前的包 */
+    int flushing;
+    int flush_until;
+    /* 等待播放到from的区间flush,在这之前解码时跳过[from, until)的包 */
+    int range_flush;
+    int range_from;
+    int range_until;
+    unsigned char plain[RAOP_BUFFERED_SLOT_LEN];
+};
+
+/* 序号是24位的 */
+static int
+raop_buffered_seq_before(int a, int b)
+{
+    return ((a - b) & 0xffffff) >= 0x800000;
+}
+
+raop_buffered_t *
+raop_buffered_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp,
+                   const unsigned char *shk, int ct, int spf)
+{
+    raop_buffered_t *raop_buffered;
+
+    assert(logger);
+    assert(callbacks);
+    assert(ntp);
+    assert(shk);
+
+    if (ct == RAOP_BUFFERED_CT_AAC) {
+        if (spf != 1024) {
+            logger_log(logger, LOGGER_ERR, "raop_buffered unsupported AAC frame size %d", spf);
+            return NULL;
+        }
+    } else if (ct == RAOP_BUFFERED_CT_AAC_ELD) {
+        if (spf != 480) {
+            logger_log(logger, LOGGER_ERR, "raop_buffered unsupported AAC-ELD frame size %d", spf);
+            return NULL;
+        }
+    } else {
+        logger_log(logger, LOGGER_ERR, "raop_buffered unsupported compression type %d", ct);
+        return NULL;
+    }
+
+    raop_buffered = calloc(1, sizeof(raop_buffered_t));
+    if (!raop_buffered) {
+        return NULL;
+    }
+    raop_buffered->logger = logger;
+    raop_buffered->ntp = ntp;
+    memcpy(&raop_buffered->callbacks, callbacks, sizeof(raop_callbacks_t));
+    memcpy(raop_buffered->key, shk, sizeof(raop_buffered->key));
+    raop_buffered->spf = spf;
+    raop_buffered->low_frames = RAOP_BUFFERED_LOW_WATER * RAOP_BUFFERED_SAMPLE_RATE / (1000 * spf);
+    raop_buffered->high_frames = RAOP_BUFFERED_HIGH_WATER * RAOP_BUFFERED_SAMPLE_RATE / (1000 * spf);
+    if (raop_buffered->high_frames > RAOP_BUFFERED_PCM_FRAMES) {
+        raop_buffered->high_frames = RAOP_BUFFERED_PCM_FRAMES;
+    }
+
+    if (ct == RAOP_BUFFERED_CT_AAC) {
+        /* AAC-LC 44100 双声道 */
+        static const unsigned char lc_conf[] = { 0x12, 0x10 };
+        raop_buffered->aac = aac_create_with_config(logger, lc_conf, sizeof(lc_conf));
+    } else {
+        raop_buffered->aac = aac_create(logger);
+    }
+    raop_buffered->store = packet_ring_init(RAOP_BUFFERED_STORE_SIZE, RAOP_BUFFERED_SLOT_LEN);
+    raop_buffered->frames = malloc(RAOP_BUFFERED_PCM_FRAMES * sizeof(raop_buffered_frame_t));
+    raop_buffered->gain = pcm_gain_init(1);
+    if (!raop_buffered->aac || !raop_buffered->store || !raop_buffered->frames || !raop_buffered->gain) {
+        aac_free(raop_buffered->aac);
+        pcm_gain_destroy(raop_buffered->gain);
+        if (raop_buffered->store) {
+            packet_ring_destroy(raop_buffered->store);
+        }
+        free(raop_buffered->frames);
+        free(raop_buffered);
+        return NULL;
+    }
+
+    raop_buffered->gain_mode = RAOP_AUDIO_GAIN_DITHER;
+    raop_buffered->dsock = -1;
+    raop_buffered->running = 0;
+    raop_buffered->joined = 1;
+
+    MUTEX_CREATE(raop_buffered->run_mutex);
+    COND_CREATE(raop_buffered->run_cond);
+    return raop_buffered;
+}
+
+void
+raop_buffered_destroy(raop_buffered_t *raop_buffered)
+{
+    if (raop_buffered) {
+        raop_buffered_stop(raop_buffered);
+        MUTEX_DESTROY(raop_buffered->run_mutex);
+        COND_DESTROY(raop_buffered->run_cond);
+        aac_free(raop_buffered->aac);
+        packet_ring_destroy(raop_buffered->store);
+        pcm_gain_destroy(raop_buffered->gain);
+        pcm_resampler_destroy(raop_buffered->resampler);
+        free(raop_buffered->resample_buf);
+        pcm_convert_destroy(raop_buffered->convert);
+        free(raop_buffered->convert_buf);
+        free(raop_buffered->frames);
+        free(raop_buffered);
+    }
+}
+
+void
+raop_buffered_set_gain(raop_buffered_t *raop_buffered, int mode)
+{
+    assert(raop_buffered);
+    raop_buffered->gain_mode = mode;
+    pcm_gain_set_dither(raop_buffered->gain, mode == RAOP_AUDIO_GAIN_DITHER);
+}
+
+int
+raop_buffered_set_output_rate(raop_buffered_t *raop_buffered, unsigned int rate)
+{
+    assert(raop_buffered);
+
+    pcm_resampler_destroy(raop_buffered->resampler);
+    raop_buffered->resampler = NULL;
+    free(raop_buffered->resample_buf);
+    raop_buffered->resample_buf = NULL;
+    if (rate == 0 || rate == RAOP_BUFFERED_SAMPLE_RATE) {
+        return 0;
+    }
+    raop_buffered->resampler = pcm_resampler_init(RAOP_BUFFERED_SAMPLE_RATE, rate);
+    if (!raop_buffered->resampler) {
+        return -1;
+    }
+    raop_buffered->resample_frames = pcm_resampler_max_output(raop_buffered->resampler, raop_buffered->spf);
+    raop_buffered->resample_buf = malloc(raop_buffered->resample_frames * 2 * sizeof(short));
+    if (!raop_buffered->resample_buf) {
+        pcm_resampler_destroy(raop_buffered->resampler);
+        raop_buffered->resampler = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int
+raop_buffered_set_format(raop_buffered_t *raop_buffered, int format, int channels, int planar)
+{
+    pcm_convert_t *convert;
+
+    assert(raop_buffered);
+
+    convert = pcm_convert_init(format, channels, planar);
+    if (!convert) {
+        return -1;
+    }
+    pcm_convert_destroy(raop_buffered->convert);
+    raop_buffered->convert = NULL;
+    raop_buffered->format = format;
+    raop_buffered->channels = channels;
+    raop_buffered->planar = channels == 2 && planar;
+    if (pcm_convert_is_identity(convert)) {
+        pcm_convert_destroy(convert);
+    } else {
+        raop_buffered->convert = convert;
+    }
+    return 0;
+}
+
+void
+raop_buffered_set_volume(raop_buffered_t *raop_buffered, float volume)
+{
+    assert(raop_buffered);
+    pcm_gain_set_volume(raop_buffered->gain, volume);
+}
+
+int
+raop_buffered_get_buffer_size(raop_buffered_t *raop_buffered)
+{
+    return RAOP_BUFFERED_STORE_SIZE * RAOP_BUFFERED_SLOT_LEN;
+}
+
+static int
+raop_buffered_is_running(raop_buffered_t *raop_buffered)
+{
+    int running;
+    MUTEX_LOCK(raop_buffered->run_mutex);
+    running = raop_buffered->running;
+    MUTEX_UNLOCK(raop_buffered->run_mutex);
+    return running;
+}
+
+/**
+ * 接收线程,每个包是2字节长度(包括这2字节)加上包体,包体直接读入队列的slot
+ * 队列满时不再读socket,发送端由TCP流控暂停推送
+ */
+static THREAD_RETVAL
+raop_buffered_thread_recv(void *arg)
+{
+    raop_buffered_t *raop_buffered = arg;
+    int stream_fd = -1;
+    unsigned char header[2];
+    int header_read = 0;
+    packet_ring_entry_t *entry = NULL;
+    int body_len = 0;
+    int body_read = 0;
+
+    assert(raop_buffered);
+
+    while (raop_buffered_is_running(raop_buffered)) {
+        fd_set rfds;
+        struct timeval tv;
+        int nfds, ret;
+
+        if (header_read == 2 && !entry) {
+            entry = packet_ring_write_begin(raop_buffered->store);
+            if (!entry) {
+                sleepms(RAOP_BUFFERED_MAX_WAIT);
+                continue;
+            }
+        }
+
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        FD_ZERO(&rfds);
+        if (stream_fd == -1) {
+            FD_SET(raop_buffered->dsock, &rfds);
+            nfds = raop_buffered->dsock + 1;
+        } else {
+            FD_SET(stream_fd, &rfds);
+            nfds = stream_fd + 1;
+        }
+        ret = select(nfds, &rfds, NULL, NULL, &tv);
+        if (ret == 0) {
+            continue;
+        } else if (ret == -1) {
+            logger_log(raop_buffered->logger, LOGGER_INFO, "raop_buffered error in select");
+            break;
+        }
+
+        if (stream_fd == -1) {
+            struct sockaddr_storage saddr;
+            socklen_t saddrlen = sizeof(saddr);
+            logger_log(raop_buffered->logger, LOGGER_INFO, "raop_buffered accepting client");
+            stream_fd = accept(raop_buffered->dsock, (struct sockaddr *) &saddr, &saddrlen);
+            if (stream_fd == -1) {
+                logger_log(raop_buffered->logger, LOGGER_INFO, "raop_buffered error in accept %d %s", errno, strerror(errno));
+                break;
+            }
+            continue;
+        }
+
+        if (header_read < 2) {
+            ret = recv(stream_fd, (char *) header + header_read, 2 - header_read, 0);
+        } else {
+            ret = recv(stream_fd, (char *) entry->data + body_read, body_len - body_read, 0);
+        }
+        if (ret == 0) {
+            logger_log(raop_buffered->logger, LOGGER_INFO, "raop_buffered TCP socket closed");
+            break;
+        } else if (ret == -1) {
+            logger_log(raop_buffered->logger, LOGGER_INFO, "raop_buffered error in recv");
+            break;
+        }
+
+        if (header_read < 2) {
+            header_read += ret;
+            if (header_read == 2) {
+                body_len = ((header[0] << 8) | header[1]) - 2;
+                body_read = 0;
+                if (body_len <= RAOP_BUFFERED_HEADER_LEN + RAOP_BUFFERED_TRAILER_LEN ||
+                    body_len > RAOP_BUFFERED_SLOT_LEN) {
+                    logger_log(raop_buffered->logger, LOGGER_ERR, "raop_buffered invalid packet length %d", body_len);
+                    break;
+                }
+            }
+            continue;
+        }
+        body_read += ret;
+        if (body_read == body_len) {
+            entry->type = 0;
+            entry->value = 0;
+            entry->len = body_len;
+            entry->time_us = timeutils_monotonic_us();
+            packet_ring_write_commit(raop_buffered->store);
+            entry = NULL;
+            header_read = 0;
+        }
+    }
+
+    if (stream_fd != -1) {
+        closesocket(stream_fd);
+    }
+    logger_log(raop_buffered->logger, LOGGER_INFO, "Exiting raop_buffered recv thread");
+    return 0;
+}
+
+/* 解密解码队列中的一个包,队列空时返回0 */
+static int
+raop_buffered_decode_one(raop_buffered_t *raop_buffered)
+{
+    packet_ring_entry_t *entry;
+    raop_buffered_frame_t *frame;
+    unsigned char nonce[CHACHA20_POLY1305_NONCE_SIZE];
+    unsigned char *packet;
+    int seqnum, payload_len, ret;
+
+    entry = packet_ring_read_begin(raop_buffered->store);
+    if (!entry) {
+        return 0;
+    }
+    packet = entry->data;
+    seqnum = (packet[1] << 16) | (packet[2] << 8) | packet[3];
+    if (raop_buffered->range_flush &&
+        !raop_buffered_seq_before(seqnum, raop_buffered->range_from) &&
+        raop_buffered_seq_before(seqnum, raop_buffered->range_until)) {
+        packet_ring_read_commit(raop_buffered->store);
+        return 1;
+    }
+    if (raop_buffered->flushing) {
+        if (raop_buffered_seq_before(seqnum, raop_buffered->flush_until)) {
+            packet_ring_read_commit(raop_buffered->store);
+            return 1;
+        }
+        raop_buffered->flushing = 0;
+    }
+
+    frame = &raop_buffered->frames[(raop_buffered->frame_head + raop_buffered->frame_count) % RAOP_BUFFERED_PCM_FRAMES];
+    frame->seqnum = seqnum;
+    frame->timestamp = (packet[4] << 24) | (packet[5] << 16) | (packet[6] << 8) | packet[7];
+
+    /* nonce是包尾的8字节前面补4个0,aad是rtp头中的timestamp和ssrc */
+    payload_len = entry->len - RAOP_BUFFERED_HEADER_LEN - RAOP_BUFFERED_TRAILER_LEN;
+    memset(nonce, 0, 4);
+    memcpy(nonce + 4, packet + entry->len - 8, 8);
+    ret = chacha20_poly1305_decrypt(raop_buffered->key, nonce, packet + 4, 8,
+                                    packet + RAOP_BUFFERED_HEADER_LEN, payload_len,
+                                    packet + entry->len - RAOP_BUFFERED_TRAILER_LEN, raop_buffered->plain);
+    packet_ring_read_commit(raop_buffered->store);
+    if (ret < 0) {
+        logger_log(raop_buffered->logger, LOGGER_WARNING, "raop_buffered packet %d failed authentication", seqnum);
+        return 1;
+    }
+
+    frame->len = raop_buffered->spf * 2 * sizeof(short);
+    ret = aac_decode_frame(raop_buffered->aac, raop_buffered->plain, payload_len, frame->data, frame->len);
+    if (ret != 0) {
+        /* 解码失败时用解码器的丢包补偿代替,保持时间线连续 */
+        if (aac_conceal_frame(raop_buffered->aac, frame->data, frame->len) != 0) {
+            memset(frame->data, 0, frame->len);
+        }
+    }
+    raop_buffered->frame_count++;
+    return 1;
+}
+
+static void
+raop_buffered_pop_frame(raop_buffered_t *raop_buffered)
+{
+    raop_buffered->frame_head = (raop_buffered->frame_head + 1) % RAOP_BUFFERED_PCM_FRAMES;
+    raop_buffered->frame_count--;
+}
+
+/* 丢弃已解码的帧和队列中until之前的包,until小于0时全部丢弃 */
+static void
+raop_buffered_apply_flush(raop_buffered_t *raop_buffered, int until)
+{
+    packet_ring_entry_t *entry;
+
+    if (until < 0) {
+        raop_buffered->frame_count = 0;
+        while ((entry = packet_ring_read_begin(raop_buffered->store)) != NULL) {
+            packet_ring_read_commit(raop_buffered->store);
+        }
+        raop_buffered->flushing = 0;
+    } else {
+        while (raop_buffered->frame_count > 0 &&
+               raop_buffered_seq_before(raop_buffered->frames[raop_buffered->frame_head].seqnum, until)) {
+            raop_buffered_pop_frame(raop_buffered);
+        }
+        /* 已解码的帧都在until之前时,队列中的包还需要继续丢弃 */
+        if (raop_buffered->frame_count == 0) {
+            raop_buffered->flushing = 1;
+            raop_buffered->flush_until = until;
+        }
+    }
+}
+
+/* flush之后输出不再连续 */
+static void
+raop_buffered_flush_output(raop_buffered_t *raop_buffered, void *cb_data)
+{
+    if (raop_buffered->resampler) {
+        pcm_resampler_reset(raop_buffered->resampler);
+    }
+    if (raop_buffered->callbacks.audio_flush) {
+        raop_buffered->callbacks.audio_flush(raop_buffered->callbacks.cls, cb_data);
+    }
+}
+
+/**
+ * 解码线程,已解码的数据不足低水位时成批解码到高水位,
+ * 然后回调到期的帧,休眠到下一帧到期或者有新的锚点,flush
+ */
+static THREAD_RETVAL
+raop_buffered_thread_decode(void *arg)
+{
+    raop_buffered_t *raop_buffered = arg;
+    void *cb_data = NULL;
+    int rate = 0, anchor_valid = 0;
+    unsigned int anchor_rtp = 0;
+    uint64_t anchor_time = 0;
+
+    assert(raop_buffered);
+
+    if (raop_buffered->callbacks.audio_init) {
+        cb_data = raop_buffered->callbacks.audio_init(raop_buffered->callbacks.cls);
+    }
+
+    MUTEX_LOCK(raop_buffered->run_mutex);
+    while (raop_buffered->running) {
+        int flush = raop_buffered->flush;
+        int flush_from = raop_buffered->flush_from;
+        int flush_seq = raop_buffered->flush_seq;
+        unsigned int wait_ms = RAOP_BUFFERED_MAX_WAIT;
+        uint64_t now;
+
+        raop_buffered->flush = 0;
+        rate = raop_buffered->rate;
+        anchor_valid = raop_buffered->anchor_valid;
+        anchor_rtp = raop_buffered->anchor_rtp;
+        anchor_time = raop_buffered->anchor_time;
+        MUTEX_UNLOCK(raop_buffered->run_mutex);
+
+        if (flush && flush_from >= 0 && flush_seq >= 0) {
+            /* 跳曲时from之前已经缓冲的部分继续播放,播放到from时才生效 */
+            raop_buffered->range_flush = 1;
+            raop_buffered->range_from = flush_from;
+            raop_buffered->range_until = flush_seq;
+        } else if (flush) {
+            raop_buffered->range_flush = 0;
+            raop_buffered_apply_flush(raop_buffered, flush_seq);
+            raop_buffered_flush_output(raop_buffered, cb_data);
+        }
+
+        if (raop_buffered->frame_count < raop_buffered->low_frames) {
+            while (raop_buffered->frame_count < raop_buffered->high_frames &&
+                   raop_buffered_decode_one(raop_buffered));
+        }
+
+        now = raop_ntp_get_local_time(raop_buffered->ntp);
+        if (raop_buffered->resampler && now - raop_buffered->drift_time >= RAOP_BUFFERED_DRIFT_INTERVAL) {
+            int clock_drift = 0;
+            raop_buffered->drift_time = now;
+            if (raop_ntp_get_stats(raop_buffered->ntp, NULL, NULL, &clock_drift)) {
+                pcm_resampler_set_drift(raop_buffered->resampler, clock_drift);
+            }
+        }
+        while (rate && anchor_valid && raop_buffered->frame_count > 0) {
+            raop_buffered_frame_t *frame = &raop_buffered->frames[raop_buffered->frame_head];
+            int64_t offset;
+            uint64_t pts;
+            if (raop_buffered->range_flush &&
+                !raop_buffered_seq_before(frame->seqnum, raop_buffered->range_from)) {
+                /* 在播放到from之前解码的帧中可能还有区间内的 */
+                raop_buffered->range_flush = 0;
+                raop_buffered_apply_flush(raop_buffered, raop_buffered->range_until);
+                raop_buffered_flush_output(raop_buffered, cb_data);
+                continue;
+            }
+            offset = timeutils_rtp_to_us((int32_t) (frame->timestamp - anchor_rtp), RAOP_BUFFERED_SAMPLE_RATE);
+            pts = raop_ntp_convert_remote_time(raop_buffered->ntp, anchor_time + offset);
+            if (pts > now + RAOP_BUFFERED_DELIVER_AHEAD) {
+                uint64_t wait_us = pts - now - RAOP_BUFFERED_DELIVER_AHEAD;
+                if (wait_us < (uint64_t) wait_ms * 1000) {
+                    wait_ms = (unsigned int) (wait_us / 1000) + 1;
+                }
+                break;
+            }
+            if (pts + RAOP_BUFFERED_MAX_LATE >= now) {
+                pcm_data_struct pcm_data;
+                short *data = frame->data;
+                int len = frame->len;
+                if (raop_buffered->resampler) {
+                    /* 第一个输出采样对应还在转换历史中的输入,pts相应提前 */
+                    int delay = pcm_resampler_get_delay(raop_buffered->resampler);
+                    int frames = pcm_resampler_process(raop_buffered->resampler, frame->data, frame->len / (2 * sizeof(short)),
+                                                       raop_buffered->resample_buf, raop_buffered->resample_frames);
+                    data = raop_buffered->resample_buf;
+                    len = frames * 2 * sizeof(short);
+                    pts -= (int64_t) delay * 1000000 / RAOP_BUFFERED_SAMPLE_RATE;
+                }
+                pcm_data.frames = len / (2 * sizeof(short));
+                pcm_data.data = data;
+                pcm_data.data_len = len;
+                if (len > 0 && raop_buffered->convert && pcm_data.frames > raop_buffered->convert_frames) {
+                    void *buf = realloc(raop_buffered->convert_buf, pcm_data.frames * pcm_convert_frame_bytes(raop_buffered->convert));
+                    if (buf) {
+                        raop_buffered->convert_buf = buf;
+                        raop_buffered->convert_frames = pcm_data.frames;
+                    }
+                }
+                if (len > 0) {
+                    if (raop_buffered->gain_mode != RAOP_AUDIO_GAIN_OFF) {
+                        pcm_gain_apply(raop_buffered->gain, data, len / sizeof(short));
+                    }
+                    if (raop_buffered->convert && pcm_data.frames <= raop_buffered->convert_frames) {
+                        pcm_convert_process(raop_buffered->convert, data, pcm_data.frames, raop_buffered->convert_buf, 0, pcm_data.frames);
+                        pcm_data.data = raop_buffered->convert_buf;
+                        pcm_data.data_len = pcm_data.frames * pcm_convert_frame_bytes(raop_buffered->convert);
+                        pcm_data.format = raop_buffered->format;
+                        pcm_data.channels = raop_buffered->channels;
+                        pcm_data.planar = raop_buffered->planar;
+                    } else {
+                        pcm_data.format = PCM_FORMAT_S16;
+                        pcm_data.channels = 2;
+                        pcm_data.planar = 0;
+                    }
+                    pcm_data.pts = pts;
+                    pcm_data.frame = NULL;
+                    raop_buffered->callbacks.audio_process(raop_buffered->callbacks.cls, cb_data, &pcm_data);
+                }
+            } else if (raop_buffered->resampler) {
+                /* 丢弃的帧之后数据不连续 */
+                pcm_resampler_reset(raop_buffered->resampler);
+            }
+            raop_buffered_pop_frame(raop_buffered);
+        }
+
+        MUTEX_LOCK(raop_buffered->run_mutex);
+        if (raop_buffered->running && !raop_buffered->flush) {
+            COND_TIMEDWAIT(raop_buffered->run_cond, raop_buffered->run_mutex, wait_ms);
+        }
+    }
+    MUTEX_UNLOCK(raop_buffered->run_mutex);
+
+    logger_log(raop_buffered->logger, LOGGER_INFO, "Exiting raop_buffered decode thread");
+    if (raop_buffered->callbacks.audio_destroy) {
+        raop_buffered->callbacks.audio_destroy(raop_buffered->callbacks.cls, cb_data);
+    }
+    return 0;
+}
+
+int
+raop_buffered_start(raop_buffered_t *raop_buffered, unsigned short *data_lport)
+{
+    int dsock;
+    unsigned short dport = 0;
+
+    assert(raop_buffered);
+
+    MUTEX_LOCK(raop_buffered->run_mutex);
+    if (raop_buffered->running || !raop_buffered->joined) {
+        if (data_lport) *data_lport = raop_buffered->data_lport;
+        MUTEX_UNLOCK(raop_buffered->run_mutex);
+        return 0;
+    }
+
+    dsock = netutils_init_socket(&dport, 0, 0);
+    if (dsock == -1 || listen(dsock, 1) < 0) {
+        logger_log(raop_buffered->logger, LOGGER_ERR, "raop_buffered initializing socket failed");
+        if (dsock != -1) closesocket(dsock);
+        MUTEX_UNLOCK(raop_buffered->run_mutex);
+        return -1;
+    }
+    raop_buffered->dsock = dsock;
+    raop_buffered->data_lport = dport;
+    if (data_lport) *data_lport = dport;
+
+    raop_buffered->running = 1;
+    raop_buffered->joined = 0;
+    THREAD_CREATE(raop_buffered->recv_thread, raop_buffered_thread_recv, raop_buffered);
+    THREAD_CREATE(raop_buffered->decode_thread, raop_buffered_thread_decode, raop_buffered);
+    MUTEX_UNLOCK(raop_buffered->run_mutex);
+    return 0;
+}
+
+void
+raop_buffered_set_anchor(raop_buffered_t *raop_buffered, int rate, unsigned int rtp_time, uint64_t network_time)
+{
+    assert(raop_buffered);
+
+    MUTEX_LOCK(raop_buffered->run_mutex);
+    raop_buffered->rate = rate;
+    if (rate) {
+        raop_buffered->anchor_valid = 1;
+        raop_buffered->anchor_rtp = rtp_time;
+        raop_buffered->anchor_time = network_time;
+    }
+    COND_SIGNAL(raop_buffered->run_cond);
+    MUTEX_UNLOCK(raop_buffered->run_mutex);
+}
+
+void
+raop_buffered_flush(raop_buffered_t *raop_buffered, int from_seq, int until_seq)
+{
+    assert(raop_buffered);
+
+    MUTEX_LOCK(raop_buffered->run_mutex);
+    raop_buffered->flush = 1;
+    raop_buffered->flush_from = from_seq;
+    raop_buffered->flush_seq = until_seq;
+    COND_SIGNAL(raop_buffered->run_cond);
+    MUTEX_UNLOCK(raop_buffered->run_mutex);
+}
+
+void
+raop_buffered_stop(raop_buffered_t *raop_buffered)
+{
+    assert(raop_buffered);
+
+    MUTEX_LOCK(raop_buffered->run_mutex);
+    if (!raop_buffered->running || raop_buffered->joined) {
+        MUTEX_UNLOCK(raop_buffered->run_mutex);
+        return;
+    }
+    raop_buffered->running = 0;
+    COND_SIGNAL(raop_buffered->run_cond);
+    MUTEX_UNLOCK(raop_buffered->run_mutex);
+
+    THREAD_JOIN(raop_buffered->recv_thread);
+    THREAD_JOIN(raop_buffered->decode_thread);
+    if (raop_buffered->dsock != -1) {
+        closesocket(raop_buffered->dsock);
+        raop_buffered->dsock = -1;
+    }
+
+    MUTEX_LOCK(raop_buffered->run_mutex);
+    raop_buffered->joined = 1;
+    MUTEX_UNLOCK(raop_buffered->run_mutex);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * 缓冲音频(SETUP stream type 103)
+ * 发送端通过TCP提前推送几十秒的音频,接收线程把加密的包原样存入大容量的队列,
+ * 解码线程在已解码的数据低于低水位时成批解密解码到高水位,其余时间休眠,
+ * 按SETRATEANCHORTIME给出的锚点在播放时间回调audio_process
+ * 网络短时中断时播放不受影响,发送端的推送由TCP流控限制在队列容量以内
+ */
+
+#ifndef RAOP_BUFFERED_H
+#define RAOP_BUFFERED_H
+
+#include <stdint.h>
+#include "raop.h"
+#include "logger.h"
+#include "raop_ntp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SETUP的ct */
+#define RAOP_BUFFERED_CT_AAC     4
+#define RAOP_BUFFERED_CT_AAC_ELD 8
+
+typedef struct raop_buffered_s raop_buffered_t;
+
+/* shk是SETUP中的32字节密钥,ct和spf是压缩格式和每帧的采样数,不支持的格式返回NULL */
+raop_buffered_t *raop_buffered_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp,
+                                    const unsigned char *shk, int ct, int spf);
+/* 创建tcp数据端口和接收,解码线程,data_lport返回本地的数据端口 */
+int raop_buffered_start(raop_buffered_t *raop_buffered, unsigned short *data_lport);
+/* SETUP应答的audioBufferSize,发送端最多提前推送这么多字节 */
+int raop_buffered_get_buffer_size(raop_buffered_t *raop_buffered);
+/* rate为0时暂停,否则rtp_time在发送端时间network_time(from 1970 us)播放 */
+void raop_buffered_set_anchor(raop_buffered_t *raop_buffered, int rate, unsigned int rtp_time, uint64_t network_time);
+/* 音量的处理方式RAOP_AUDIO_GAIN_*,需要在start之前设置 */
+void raop_buffered_set_gain(raop_buffered_t *raop_buffered, int mode);
+/* 回调的采样率,0或44100表示不转换,需要在start之前设置,失败时返回-1并保持44100 */
+int raop_buffered_set_output_rate(raop_buffered_t *raop_buffered, unsigned int rate);
+/* 回调的pcm格式,见raop_set_audio_format,需要在start之前设置,不支持的组合返回-1并保持交错的16位双声道 */
+int raop_buffered_set_format(raop_buffered_t *raop_buffered, int format, int channels, int planar);
+/* AirPlay的音量 dB,在回调时处理,不影响已经解码的缓冲 */
+void raop_buffered_set_volume(raop_buffered_t *raop_buffered, float volume);
+/**
+ * 丢弃序号在[from_seq, until_seq)之间的包,播放到from_seq时生效,之前的包照常播放
+ * from_seq小于0时立即丢弃until_seq之前的包,until_seq也小于0时丢弃已经收到的所有包
+ */
+void raop_buffered_flush(raop_buffered_t *raop_buffered, int from_seq, int until_seq);
+void raop_buffered_stop(raop_buffered_t *raop_buffered);
+void raop_buffered_destroy(raop_buffered_t *raop_buffered);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RAOP_BUFFERED_H
@@ -296,8 +296,24 @@ raop_handler_setup(raop_conn_t *conn,
         logger_log(conn->raop->logger, LOGGER_DEBUG, "fairplay_decrypt ret = %d", ret);
         unsigned char ecdh_secret[32];
         pairing_get_ecdh_secret_key(conn->pairing, ecdh_secret);
-        conn->raop_rtp_mirror = raop_rtp_mirror_init(conn->raop->logger, &conn->raop->callbacks, conn->remote, conn->remotelen, aeskey, ecdh_secret, timing_rport);
-        conn->raop_rtp = raop_rtp_init(conn->raop->logger, &conn->raop->callbacks, conn->remote, conn->remotelen, aeskey, aesiv, ecdh_secret, timing_rport);
+        /* 音频和镜像共用一个时钟同步服务,尽早开始交换使推流开始前已经同步 */
+        conn->raop_ntp = raop_ntp_init(conn->raop->logger, conn->raop->pool, conn->remote, conn->remotelen, timing_rport);
+        if (conn->raop_ntp) {
+            raop_ntp_start(conn->raop_ntp, NULL);
+            conn->raop_rtp_mirror = raop_rtp_mirror_init(conn->raop->logger, &conn->raop->callbacks, conn->raop_ntp, conn->raop->pool, conn->remote, conn->remotelen, aeskey, ecdh_secret);
+            conn->raop_rtp = raop_rtp_init(conn->raop->logger, &conn->raop->callbacks, conn->raop_ntp, conn->raop->pool, conn->remote, conn->remotelen, aeskey, aesiv, ecdh_secret);
+        }
+        if (conn->raop_rtp) {
+            raop_rtp_set_pipeline(conn->raop_rtp, conn->raop->audio_pipeline);
+            raop_rtp_set_latency(conn->raop_rtp, conn->raop->audio_latency);
+            raop_rtp_set_conceal_method(conn->raop_rtp, conn->raop->audio_conceal_method);
+            raop_rtp_set_pull(conn->raop_rtp, conn->raop->audio_pull);
+            raop_rtp_set_batch_frames(conn->raop_rtp, conn->raop->audio_batch_frames);
+            raop_rtp_set_silence(conn->raop_rtp, conn->raop->audio_silence_mode, conn->raop->audio_silence_threshold);
+            raop_rtp_set_gain(conn->raop_rtp, conn->raop->audio_gain_mode);
+            raop_rtp_set_output_rate(conn->raop_rtp, conn->raop->audio_output_rate);
+            raop_rtp_set_format(conn->raop_rtp, conn->raop->audio_format, conn->raop->audio_channels, conn->raop->audio_planar);
+        }
     } else {
         int count = plist_array_get_size(streams_note);
         for (int i = 0; i < count; i++) {
@@ -316,7 +332,8 @@ raop_handler_setup(raop_conn_t *conn,
                     logger_log(conn->raop->logger, LOGGER_DEBUG, "streamConnectionID = %llu", streamConnectionID);
                     if (conn->raop_rtp_mirror) {
                         raop_rtp_init_mirror_aes(conn->raop_rtp_mirror, streamConnectionID);
-                        raop_rtp_start_mirror(conn->raop_rtp_mirror, use_udp, &tport, &dport);
+                        raop_ntp_start(conn->raop_ntp, &tport);
+                        raop_rtp_start_mirror(conn->raop_rtp_mirror, use_udp, &dport);
                         logger_log(conn->raop->logger, LOGGER_DEBUG, "RAOP initialized success");
                     } else {
                         logger_log(conn->raop->logger, LOGGER_ERR, "RAOP not initialized at SETUP, playing will fail!");
@@ -347,7 +364,8 @@ raop_handler_setup(raop_conn_t *conn,
                     /* 音频数据 */
                     unsigned short cport = 0, tport = 0, dport = 0;
                     if (conn->raop_rtp) {
-                        raop_rtp_start_audio(conn->raop_rtp, use_udp, remote_cport, &cport, &tport, &dport);
+                        raop_ntp_start(conn->raop_ntp, &tport);
+                        raop_rtp_start_audio(conn->raop_rtp, use_udp, remote_cport, &cport, &dport);
                         logger_log(conn->raop->logger, LOGGER_DEBUG, "RAOP initialized success");
                     } else {
                         logger_log(conn->raop->logger, LOGGER_ERR, "RAOP not initialized at SETUP, playing will fail!");
@@ -394,6 +412,54 @@ raop_handler_setup(raop_conn_t *conn,
                     logger_log(conn->raop->logger, LOGGER_INFO, "dport = %d, tport = %d, cport = %d", dport, tport, cport);
                     break;
                 }
+                case 103: {
+                    /* 缓冲音频 */
+                    unsigned short dport = 0;
+                    uint64_t ct = 0, spf = 0;
+                    char *shk = NULL;
+                    uint64_t shk_len = 0;
+                    plist_get_uint_val(plist_dict_get_item(stream_note, "ct"), &ct);
+                    plist_get_uint_val(plist_dict_get_item(stream_note, "spf"), &spf);
+                    plist_get_data_val(plist_dict_get_item(stream_note, "shk"), &shk, &shk_len);
+                    logger_log(conn->raop->logger, LOGGER_DEBUG, "ct = %llu, spf = %llu, shk_len = %llu", ct, spf, shk_len);
+                    if (conn->raop_ntp && !conn->raop_buffered && shk && shk_len == 32) {
+                        conn->raop_buffered = raop_buffered_init(conn->raop->logger, &conn->raop->callbacks, conn->raop_ntp,
+                                                                 (unsigned char *) shk, (int) ct, (int) spf);
+                        if (conn->raop_buffered) {
+                            raop_buffered_set_gain(conn->raop_buffered, conn->raop->audio_gain_mode);
+                            if (raop_buffered_set_output_rate(conn->raop_buffered, conn->raop->audio_output_rate) < 0) {
+                                logger_log(conn->raop->logger, LOGGER_WARNING, "Unsupported audio output rate %u", conn->raop->audio_output_rate);
+                            }
+                            if (raop_buffered_set_format(conn->raop_buffered, conn->raop->audio_format,
+                                                         conn->raop->audio_channels, conn->raop->audio_planar) < 0) {
+                                logger_log(conn->raop->logger, LOGGER_WARNING, "Unsupported audio format %d/%d/%d",
+                                           conn->raop->audio_format, conn->raop->audio_channels, conn->raop->audio_planar);
+                            }
+                        }
+                    }
+                    free(shk);
+                    if (conn->raop_buffered && raop_buffered_start(conn->raop_buffered, &dport) == 0) {
+                        logger_log(conn->raop->logger, LOGGER_DEBUG, "RAOP buffered audio initialized success");
+                    } else {
+                        logger_log(conn->raop->logger, LOGGER_ERR, "RAOP buffered audio not initialized at SETUP, playing will fail!");
+                        http_response_set_disconnect(response, 1);
+                        break;
+                    }
+
+                    plist_t s_node = plist_new_array();
+                    plist_t s_sub_node = plist_new_dict();
+                    plist_dict_set_item(s_sub_node, "dataPort", plist_new_uint(dport));
+                    plist_dict_set_item(s_sub_node, "type", plist_new_uint(103));
+                    plist_dict_set_item(s_sub_node, "audioBufferSize", plist_new_uint(raop_buffered_get_buffer_size(conn->raop_buffered)));
+                    plist_array_append_item(s_node, s_sub_node);
+                    plist_dict_set_item(r_node, "streams", s_node);
+                    uint32_t len = 0;
+                    plist_to_bin(r_node, response_data, &len);
+                    http_response_add_header(response, "Content-Type", "application/x-apple-binary-plist");
+                    *response_datalen = len;
+                    logger_log(conn->raop->logger, LOGGER_INFO, "buffered dport = %d", dport);
+                    break;
+                }
                 default: {
                     logger_log(conn->raop->logger, LOGGER_ERR, "SETUP tries to setup stream of unknown type %d", type);
                     http_response_set_disconnect(response, 1);
@@ -468,6 +534,9 @@ raop_handler_set_parameter(raop_conn_t *conn,
 				float vol = 0.0;
 				sscanf(datastr+8, "%f", &vol);
 				raop_rtp_set_volume(conn->raop_rtp, vol);
+				if (conn->raop_buffered) {
+					raop_buffered_set_volume(conn->raop_buffered, vol);
+				}
 			} else if (!strncmp(datastr, "progress: ", 10)) {
 				unsigned int start, curr, end;
 				sscanf(datastr+10, "%u/%u/%u", &start, &curr, &end);
@@ -508,11 +577,95 @@ raop_handler_record(raop_conn_t *conn,
                       http_request_t *request, http_response_t *response,
                       char **response_data, int *response_datalen)
 {
+    char latency[16];
+    /* 没有音频会话时使用原来的默认值 */
+    unsigned int samples = 11025;
     logger_log(conn->raop->logger, LOGGER_DEBUG, "raop_handler_record");
-    http_response_add_header(response, "Audio-Latency", "11025");
+    if (conn->raop_rtp) {
+        samples = raop_rtp_get_latency(conn->raop_rtp) + conn->raop->audio_sink_latency * 44100 / 1000;
+    }
+    snprintf(latency, sizeof(latency), "%u", samples);
+    logger_log(conn->raop->logger, LOGGER_DEBUG, "raop_handler_record Audio-Latency = %s", latency);
+    http_response_add_header(response, "Audio-Latency", latency);
     http_response_add_header(response, "Audio-Jack-Status", "connected; type=analog");
 }
 
+/* 缓冲音频的播放锚点,rate为0时暂停 */
+static void
+raop_handler_setrateanchortime(raop_conn_t *conn,
+                               http_request_t *request, http_response_t *response,
+                               char **response_data, int *response_datalen)
+{
+    const char *data;
+    int datalen;
+    plist_t root_node = NULL;
+    plist_t rate_node;
+    uint64_t rtp_time = 0, secs = 0, frac = 0;
+    double rate = 0;
+
+    data = http_request_get_data(request, &datalen);
+    plist_from_bin(data, datalen, &root_node);
+    rate_node = plist_dict_get_item(root_node, "rate");
+    if (PLIST_IS_REAL(rate_node)) {
+        plist_get_real_val(rate_node, &rate);
+    } else if (PLIST_IS_UINT(rate_node)) {
+        uint64_t rate_val = 0;
+        plist_get_uint_val(rate_node, &rate_val);
+        rate = (double) rate_val;
+    }
+    plist_get_uint_val(plist_dict_get_item(root_node, "rtpTime"), &rtp_time);
+    plist_get_uint_val(plist_dict_get_item(root_node, "networkTimeSecs"), &secs);
+    plist_get_uint_val(plist_dict_get_item(root_node, "networkTimeFrac"), &frac);
+    plist_free(root_node);
+    logger_log(conn->raop->logger, LOGGER_DEBUG, "SETRATEANCHORTIME rate = %f, rtpTime = %llu, networkTime = %llu.%llu",
+               rate, rtp_time, secs, frac);
+
+    if (conn->raop_buffered) {
+        /* networkTimeFrac是64位的二进制小数 */
+        uint64_t network_time = secs * 1000000 + (((frac >> 32) * 1000000) >> 32);
+        raop_buffered_set_anchor(conn->raop_buffered, rate != 0, (unsigned int) rtp_time, network_time);
+    } else {
+        logger_log(conn->raop->logger, LOGGER_WARNING, "RAOP buffered audio not initialized at SETRATEANCHORTIME");
+    }
+}
+
+static void
+raop_handler_flushbuffered(raop_conn_t *conn,
+                           http_request_t *request, http_response_t *response,
+                           char **response_data, int *response_datalen)
+{
+    const char *data;
+    int datalen;
+    plist_t root_node = NULL;
+    plist_t from_node;
+    plist_t until_node;
+    int from_seq = -1;
+    int until_seq = -1;
+
+    data = http_request_get_data(request, &datalen);
+    plist_from_bin(data, datalen, &root_node);
+    from_node = plist_dict_get_item(root_node, "flushFromSeq");
+    if (PLIST_IS_UINT(from_node)) {
+        uint64_t seq = 0;
+        plist_get_uint_val(from_node, &seq);
+        from_seq = (int) (seq & 0xffffff);
+    }
+    until_node = plist_dict_get_item(root_node, "flushUntilSeq");
+    if (PLIST_IS_UINT(until_node)) {
+        uint64_t seq = 0;
+        plist_get_uint_val(until_node, &seq);
+        until_seq = (int) (seq & 0xffffff);
+    }
+    plist_free(root_node);
+    logger_log(conn->raop->logger, LOGGER_INFO, "FLUSHBUFFERED from seq %d until seq %d", from_seq, until_seq);
+
+    if (conn->raop_buffered) {
+        raop_buffered_flush(conn->raop_buffered, from_seq, until_seq);
+    } else {
+        logger_log(conn->raop->logger, LOGGER_WARNING, "RAOP buffered audio not initialized at FLUSHBUFFERED");
+    }
+}
+
 static void
 raop_handler_teardown(raop_conn_t *conn,
 				   http_request_t *request, http_response_t *response,
@@ -545,6 +698,16 @@ raop_handler_teardown(raop_conn_t *conn,
                     if (conn->raop_rtp) {
                         raop_rtp_destroy(conn->raop_rtp);
                         conn->raop_rtp = NULL;
+                    }
+                    /* 销毁缓冲音频 */
+                    if (conn->raop_buffered) {
+                        raop_buffered_destroy(conn->raop_buffered);
+                        conn->raop_buffered = NULL;
+                    }
+                    /* 销毁时钟同步服务 */
+                    if (conn->raop_ntp) {
+                        raop_ntp_destroy(conn->raop_ntp);
+                        conn->raop_ntp = NULL;
                     }
 					break;
 				}
@@ -555,6 +718,14 @@ raop_handler_teardown(raop_conn_t *conn,
 					}
 					break;
 				}
+				case 103: {
+					/* 销毁缓冲音频 */
+					if (conn->raop_buffered) {
+						raop_buffered_destroy(conn->raop_buffered);
+						conn->raop_buffered = NULL;
+					}
+					break;
+				}
 				default: {
 					logger_log(conn->raop->logger, LOGGER_ERR, "SETUP tries to teardown stream of unknown type %d", type);
 					http_response_set_disconnect(response, 1);
@@ -0,0 +1,508 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "raop_ntp.h"
+#include "netutils.h"
+#include "compat.h"
+#include "byteutils.h"
+#include "timeutils.h"
+
+#define RAOP_NTP_PACKET_LEN 48
+/* 最小延迟滤波的窗口 */
+#define RAOP_NTP_FILTER_SIZE 8
+/* 估计漂移用的偏移历史 */
+#define RAOP_NTP_HISTORY_SIZE 16
+/* 交换间隔 ms,未同步或网络抖动时用最小值,稳定后每次翻倍 */
+#define RAOP_NTP_MIN_INTERVAL 200
+#define RAOP_NTP_MAX_INTERVAL 3000
+/* 等待应答的超时 ms */
+#define RAOP_NTP_REPLY_TIMEOUT 500
+/* 往返延迟不超过最小延迟的两倍加上这个值(us)时认为网络稳定 */
+#define RAOP_NTP_DELAY_SLACK 1000
+/* 历史跨度不足时不估计漂移 us */
+#define RAOP_NTP_DRIFT_SPAN 10000000
+/* 漂移的上限,超出认为是估计错误 */
+#define RAOP_NTP_MAX_DRIFT 0.0005
+
+#define NTP_MODE_CLIENT 3
+#define NTP_MODE_SERVER 4
+
+typedef struct {
+    /* 交换的中点,本地时间 */
+    uint64_t time;
+    /* 发送端减本地 */
+    int64_t offset;
+    unsigned int delay;
+} raop_ntp_sample_t;
+
+struct raop_ntp_s {
+    logger_t *logger;
+    raop_pool_t *pool;
+
+    /* Remote address as sockaddr */
+    struct sockaddr_storage remote_saddr;
+    socklen_t remote_saddr_len;
+
+    /* 本地时钟相对单调时钟的偏移,使本地时间为from 1970 */
+    uint64_t local_base;
+
+    /* MUTEX LOCKED VARIABLES START */
+    /* These variables only edited mutex locked */
+    int running;
+    int joined;
+
+    thread_handle_t thread;
+    mutex_handle_t run_mutex;
+    cond_handle_t run_cond;
+    /* MUTEX LOCKED VARIABLES END */
+
+    int tsock;
+    unsigned short timing_rport;
+    unsigned short timing_lport;
+
+    /* 以下只在交换线程中使用 */
+    raop_ntp_sample_t filter[RAOP_NTP_FILTER_SIZE];
+    int filter_count;
+    int filter_index;
+    raop_ntp_sample_t history[RAOP_NTP_HISTORY_SIZE];
+    int history_count;
+    int history_index;
+    uint64_t best_time;
+    int interval;
+
+    /* 同步结果,sync_mutex保护 */
+    mutex_handle_t sync_mutex;
+    int synced;
+    int64_t offset;
+    uint64_t offset_time;
+    unsigned int rtt;
+    double drift;
+};
+
+static int
+raop_ntp_parse_remote(raop_ntp_t *raop_ntp, const unsigned char *remote, int remotelen)
+{
+    char current[25];
+    int family;
+    int ret;
+    assert(raop_ntp);
+    if (remotelen == 4) {
+        family = AF_INET;
+    } else if (remotelen == 16) {
+        family = AF_INET6;
+    } else {
+        return -1;
+    }
+    memset(current, 0, sizeof(current));
+    sprintf(current, "%d.%d.%d.%d", remote[0], remote[1], remote[2], remote[3]);
+    logger_log(raop_ntp->logger, LOGGER_DEBUG, "raop_ntp_parse_remote ip = %s", current);
+    ret = netutils_parse_address(family, current,
+                                 &raop_ntp->remote_saddr,
+                                 sizeof(raop_ntp->remote_saddr));
+    if (ret < 0) {
+        return -1;
+    }
+    raop_ntp->remote_saddr_len = ret;
+    if (raop_ntp->remote_saddr.ss_family == AF_INET6) {
+        ((struct sockaddr_in6 *)&raop_ntp->remote_saddr)->sin6_port = htons(raop_ntp->timing_rport);
+    } else {
+        ((struct sockaddr_in *)&raop_ntp->remote_saddr)->sin_port = htons(raop_ntp->timing_rport);
+    }
+    return 0;
+}
+
+raop_ntp_t *
+raop_ntp_init(logger_t *logger, raop_pool_t *pool, const unsigned char *remote, int remotelen, unsigned short timing_rport)
+{
+    raop_ntp_t *raop_ntp;
+
+    assert(logger);
+    assert(pool);
+
+    raop_ntp = calloc(1, sizeof(raop_ntp_t));
+    if (!raop_ntp) {
+        return NULL;
+    }
+    raop_ntp->logger = logger;
+    raop_ntp->pool = pool;
+    raop_ntp->timing_rport = timing_rport;
+    if (raop_ntp_parse_remote(raop_ntp, remote, remotelen) < 0) {
+        free(raop_ntp);
+        return NULL;
+    }
+    raop_ntp->local_base = timeutils_realtime_us() - timeutils_monotonic_us();
+    raop_ntp->tsock = -1;
+    raop_ntp->running = 0;
+    raop_ntp->joined = 1;
+
+    MUTEX_CREATE(raop_ntp->run_mutex);
+    COND_CREATE(raop_ntp->run_cond);
+    MUTEX_CREATE(raop_ntp->sync_mutex);
+    return raop_ntp;
+}
+
+uint64_t
+raop_ntp_get_local_time(raop_ntp_t *raop_ntp)
+{
+    return timeutils_monotonic_us() + raop_ntp->local_base;
+}
+
+static int
+raop_ntp_is_running(raop_ntp_t *raop_ntp)
+{
+    int running;
+    MUTEX_LOCK(raop_ntp->run_mutex);
+    running = raop_ntp->running;
+    MUTEX_UNLOCK(raop_ntp->run_mutex);
+    return running;
+}
+
+/* 最小二乘拟合偏移历史的斜率 */
+static double
+raop_ntp_estimate_drift(raop_ntp_t *raop_ntp)
+{
+    uint64_t first = raop_ntp->history[0].time, last = first;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, n, drift;
+    int i;
+
+    if (raop_ntp->history_count < 4) {
+        return 0;
+    }
+    for (i = 1; i < raop_ntp->history_count; i++) {
+        if (raop_ntp->history[i].time < first) first = raop_ntp->history[i].time;
+        if (raop_ntp->history[i].time > last) last = raop_ntp->history[i].time;
+    }
+    if (last - first < RAOP_NTP_DRIFT_SPAN) {
+        return 0;
+    }
+    for (i = 0; i < raop_ntp->history_count; i++) {
+        double x = (double)(raop_ntp->history[i].time - first);
+        double y = (double)(raop_ntp->history[i].offset - raop_ntp->history[0].offset);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    n = raop_ntp->history_count;
+    if (n * sxx - sx * sx <= 0) {
+        return 0;
+    }
+    drift = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    if (drift > RAOP_NTP_MAX_DRIFT) drift = RAOP_NTP_MAX_DRIFT;
+    if (drift < -RAOP_NTP_MAX_DRIFT) drift = -RAOP_NTP_MAX_DRIFT;
+    return drift;
+}
+
+/* t1,t4是本地时间,t2,t3是发送端时间 */
+static void
+raop_ntp_add_sample(raop_ntp_t *raop_ntp, uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4)
+{
+    raop_ntp_sample_t sample;
+    raop_ntp_sample_t *best;
+    int64_t delay = (int64_t)(t4 - t1) - (int64_t)(t3 - t2);
+    int i;
+
+    if (delay < 0) {
+        delay = 0;
+    }
+    sample.time = t1 + (t4 - t1) / 2;
+    sample.offset = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+    sample.delay = (unsigned int) delay;
+
+    raop_ntp->filter[raop_ntp->filter_index] = sample;
+    raop_ntp->filter_index = (raop_ntp->filter_index + 1) % RAOP_NTP_FILTER_SIZE;
+    if (raop_ntp->filter_count < RAOP_NTP_FILTER_SIZE) {
+        raop_ntp->filter_count++;
+    }
+    best = &raop_ntp->filter[0];
+    for (i = 1; i < raop_ntp->filter_count; i++) {
+        if (raop_ntp->filter[i].delay < best->delay) {
+            best = &raop_ntp->filter[i];
+        }
+    }
+
+    /* 窗口填满前快速交换,之后延迟正常时拉长间隔,出现大延迟时恢复快速交换 */
+    if (raop_ntp->filter_count < RAOP_NTP_FILTER_SIZE ||
+        sample.delay > 2 * best->delay + RAOP_NTP_DELAY_SLACK) {
+        raop_ntp->interval = RAOP_NTP_MIN_INTERVAL;
+    } else if (raop_ntp->interval < RAOP_NTP_MAX_INTERVAL) {
+        raop_ntp->interval *= 2;
+        if (raop_ntp->interval > RAOP_NTP_MAX_INTERVAL) {
+            raop_ntp->interval = RAOP_NTP_MAX_INTERVAL;
+        }
+    }
+
+    if (best->time == raop_ntp->best_time) {
+        return;
+    }
+    raop_ntp->best_time = best->time;
+    raop_ntp->history[raop_ntp->history_index] = *best;
+    raop_ntp->history_index = (raop_ntp->history_index + 1) % RAOP_NTP_HISTORY_SIZE;
+    if (raop_ntp->history_count < RAOP_NTP_HISTORY_SIZE) {
+        raop_ntp->history_count++;
+    }
+    double drift = raop_ntp_estimate_drift(raop_ntp);
+
+    MUTEX_LOCK(raop_ntp->sync_mutex);
+    raop_ntp->synced = 1;
+    raop_ntp->offset = best->offset;
+    raop_ntp->offset_time = best->time;
+    raop_ntp->rtt = best->delay;
+    raop_ntp->drift = drift;
+    MUTEX_UNLOCK(raop_ntp->sync_mutex);
+    logger_log(raop_ntp->logger, LOGGER_DEBUG, "raop_ntp offset = %lld us, rtt = %u us, drift = %d ppm",
+               (long long) best->offset, best->delay, (int)(drift * 1000000));
+}
+
+/* 应答发送端发来的请求,使发送端也能估计两端的时钟偏移 */
+static void
+raop_ntp_answer(raop_ntp_t *raop_ntp, const unsigned char *packet, struct sockaddr_storage *saddr, socklen_t saddrlen,
+                uint64_t receive_time)
+{
+    unsigned char reply[RAOP_NTP_PACKET_LEN];
+    memset(reply, 0, sizeof(reply));
+    reply[0] = (packet[0] & 0x38) | NTP_MODE_SERVER;
+    reply[1] = 1;
+    memcpy(reply + 24, packet + 40, 8);
+    byteutils_put_ntp(reply, 32, timeutils_us_to_ntp(receive_time));
+    byteutils_put_ntp(reply, 40, timeutils_us_to_ntp(raop_ntp_get_local_time(raop_ntp)));
+    sendto(raop_ntp->tsock, (char *)reply, sizeof(reply), 0, (struct sockaddr *)saddr, saddrlen);
+}
+
+/* 等待request的应答,收到时记录一次交换并返回1,超时或停止时返回0 */
+static int
+raop_ntp_wait_reply(raop_ntp_t *raop_ntp, const unsigned char *request, uint64_t send_time)
+{
+    unsigned char packet[128];
+    struct sockaddr_storage saddr;
+    int saddrlen;
+    uint64_t deadline = send_time + RAOP_NTP_REPLY_TIMEOUT * 1000;
+
+    while (raop_ntp_is_running(raop_ntp)) {
+        uint64_t now = raop_ntp_get_local_time(raop_ntp);
+        uint64_t remaining;
+        struct timeval tv;
+        fd_set rfds;
+        int ret;
+
+        if (now >= deadline) {
+            return 0;
+        }
+        /* 分段等待,停止时不需要等完整个超时 */
+        remaining = deadline - now;
+        if (remaining > 100000) {
+            remaining = 100000;
+        }
+        tv.tv_sec = 0;
+        tv.tv_usec = (long) remaining;
+        FD_ZERO(&rfds);
+        FD_SET(raop_ntp->tsock, &rfds);
+        ret = select(raop_ntp->tsock + 1, &rfds, NULL, NULL, &tv);
+        if (ret == 0) {
+            continue;
+        } else if (ret == -1) {
+            logger_log(raop_ntp->logger, LOGGER_INFO, "raop_ntp error in select");
+            return 0;
+        }
+        uint64_t timestamp;
+        saddrlen = sizeof(saddr);
+        ret = netutils_recvfrom_timestamp(raop_ntp->tsock, packet, sizeof(packet), 0, &saddr, &saddrlen, &timestamp);
+        uint64_t receive_time = timestamp ? timeutils_realtime_to_monotonic_us(timestamp) + raop_ntp->local_base
+                                          : raop_ntp_get_local_time(raop_ntp);
+        if (ret < RAOP_NTP_PACKET_LEN) {
+            continue;
+        }
+        if ((packet[0] & 0x07) == NTP_MODE_CLIENT) {
+            raop_ntp_answer(raop_ntp, packet, &saddr, saddrlen, receive_time);
+            continue;
+        }
+        /* Origin Timestamp是我们请求里的Transmit Timestamp,不一致的是过期的应答 */
+        if ((packet[0] & 0x07) != NTP_MODE_SERVER || memcmp(packet + 24, request + 40, 8)) {
+            continue;
+        }
+        /* 32-40 请求到达发送端时发送端的时间 T2, 40-48 应答离开发送端时发送端的时间 T3 */
+        uint64_t t2 = timeutils_ntp_to_us(byteutils_read_ntp(packet, 32));
+        uint64_t t3 = timeutils_ntp_to_us(byteutils_read_ntp(packet, 40));
+        raop_ntp_add_sample(raop_ntp, send_time, t2, t3, receive_time);
+        return 1;
+    }
+    return 0;
+}
+
+static THREAD_RETVAL
+raop_ntp_thread(void *arg)
+{
+    raop_ntp_t *raop_ntp = arg;
+    unsigned char request[RAOP_NTP_PACKET_LEN];
+    assert(raop_ntp);
+
+    raop_ntp->interval = RAOP_NTP_MIN_INTERVAL;
+    while (1) {
+        MUTEX_LOCK(raop_ntp->run_mutex);
+        if (!raop_ntp->running) {
+            MUTEX_UNLOCK(raop_ntp->run_mutex);
+            break;
+        }
+        MUTEX_UNLOCK(raop_ntp->run_mutex);
+
+        memset(request, 0, sizeof(request));
+        request[0] = 0x20 | NTP_MODE_CLIENT;
+        uint64_t send_time = raop_ntp_get_local_time(raop_ntp);
+        byteutils_put_ntp(request, 40, timeutils_us_to_ntp(send_time));
+        int sendlen = sendto(raop_ntp->tsock, (char *)request, sizeof(request), 0,
+                             (struct sockaddr *)&raop_ntp->remote_saddr, raop_ntp->remote_saddr_len);
+        if (sendlen < 0) {
+            logger_log(raop_ntp->logger, LOGGER_WARNING, "raop_ntp send failed: %d", SOCKET_GET_ERROR());
+        }
+        if (!raop_ntp_wait_reply(raop_ntp, request, send_time)) {
+            logger_log(raop_ntp->logger, LOGGER_DEBUG, "raop_ntp no reply, port = %d", raop_ntp->timing_rport);
+            raop_ntp->interval = RAOP_NTP_MIN_INTERVAL;
+        }
+
+        MUTEX_LOCK(raop_ntp->run_mutex);
+        if (raop_ntp->running) {
+            COND_TIMEDWAIT(raop_ntp->run_cond, raop_ntp->run_mutex, raop_ntp->interval);
+        }
+        MUTEX_UNLOCK(raop_ntp->run_mutex);
+    }
+    logger_log(raop_ntp->logger, LOGGER_INFO, "Exiting UDP raop_ntp_thread thread");
+    return 0;
+}
+
+int
+raop_ntp_start(raop_ntp_t *raop_ntp, unsigned short *timing_lport)
+{
+    unsigned short tport = 0;
+    int tsock;
+
+    assert(raop_ntp);
+
+    MUTEX_LOCK(raop_ntp->run_mutex);
+    if (raop_ntp->running || !raop_ntp->joined) {
+        MUTEX_UNLOCK(raop_ntp->run_mutex);
+        if (timing_lport) *timing_lport = raop_ntp->timing_lport;
+        return 0;
+    }
+    tsock = raop_pool_get_socket(raop_ntp->pool, 1, &tport);
+    if (tsock == -1) {
+        logger_log(raop_ntp->logger, LOGGER_INFO, "Initializing timing socket failed");
+        MUTEX_UNLOCK(raop_ntp->run_mutex);
+        return -1;
+    }
+    /* 应答的到达时间使用内核时间戳,不含交换线程的调度延迟 */
+    if (netutils_enable_rx_timestamp(tsock) < 0) {
+        logger_log(raop_ntp->logger, LOGGER_DEBUG, "raop_ntp kernel rx timestamps not available");
+    }
+    raop_ntp->tsock = tsock;
+    raop_ntp->timing_lport = tport;
+    if (timing_lport) *timing_lport = tport;
+
+    /* Create the thread and initialize running values */
+    raop_ntp->running = 1;
+    raop_ntp->joined = 0;
+
+    THREAD_CREATE(raop_ntp->thread, raop_ntp_thread, raop_ntp);
+    MUTEX_UNLOCK(raop_ntp->run_mutex);
+    return 0;
+}
+
+void
+raop_ntp_stop(raop_ntp_t *raop_ntp)
+{
+    assert(raop_ntp);
+
+    /* Check that we are running and thread is not
+     * joined (should never be while still running) */
+    MUTEX_LOCK(raop_ntp->run_mutex);
+    if (!raop_ntp->running || raop_ntp->joined) {
+        MUTEX_UNLOCK(raop_ntp->run_mutex);
+        return;
+    }
+    raop_ntp->running = 0;
+    COND_SIGNAL(raop_ntp->run_cond);
+    MUTEX_UNLOCK(raop_ntp->run_mutex);
+
+    /* Join the thread */
+    THREAD_JOIN(raop_ntp->thread);
+    if (raop_ntp->tsock != -1) closesocket(raop_ntp->tsock);
+    raop_ntp->tsock = -1;
+
+    /* Mark thread as joined */
+    MUTEX_LOCK(raop_ntp->run_mutex);
+    raop_ntp->joined = 1;
+    MUTEX_UNLOCK(raop_ntp->run_mutex);
+}
+
+void
+raop_ntp_destroy(raop_ntp_t *raop_ntp)
+{
+    if (raop_ntp) {
+        raop_ntp_stop(raop_ntp);
+        MUTEX_DESTROY(raop_ntp->run_mutex);
+        COND_DESTROY(raop_ntp->run_cond);
+        MUTEX_DESTROY(raop_ntp->sync_mutex);
+        free(raop_ntp);
+    }
+}
+
+/* sync_mutex locked */
+static int64_t
+raop_ntp_offset_at(raop_ntp_t *raop_ntp, uint64_t local_time)
+{
+    return raop_ntp->offset + (int64_t)(raop_ntp->drift * (double)(int64_t)(local_time - raop_ntp->offset_time));
+}
+
+uint64_t
+raop_ntp_convert_remote_time(raop_ntp_t *raop_ntp, uint64_t remote_time)
+{
+    uint64_t local_time = remote_time;
+    MUTEX_LOCK(raop_ntp->sync_mutex);
+    if (raop_ntp->synced) {
+        /* 先用偏移近似本地时间,再按该时刻的偏移换算 */
+        local_time = remote_time - raop_ntp->offset;
+        local_time = remote_time - raop_ntp_offset_at(raop_ntp, local_time);
+    }
+    MUTEX_UNLOCK(raop_ntp->sync_mutex);
+    return local_time;
+}
+
+uint64_t
+raop_ntp_convert_local_time(raop_ntp_t *raop_ntp, uint64_t local_time)
+{
+    uint64_t remote_time = local_time;
+    MUTEX_LOCK(raop_ntp->sync_mutex);
+    if (raop_ntp->synced) {
+        remote_time = local_time + raop_ntp_offset_at(raop_ntp, local_time);
+    }
+    MUTEX_UNLOCK(raop_ntp->sync_mutex);
+    return remote_time;
+}
+
+int
+raop_ntp_get_stats(raop_ntp_t *raop_ntp, int64_t *offset, unsigned int *rtt, int *drift_ppm)
+{
+    int synced;
+    MUTEX_LOCK(raop_ntp->sync_mutex);
+    synced = raop_ntp->synced;
+    if (offset) *offset = raop_ntp->offset;
+    if (rtt) *rtt = raop_ntp->rtt;
+    if (drift_ppm) *drift_ppm = (int)(raop_ntp->drift * 1000000);
+    MUTEX_UNLOCK(raop_ntp->sync_mutex);
+    return synced;
+}
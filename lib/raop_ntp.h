@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * 每个发送端一个的时钟同步服务,音频和镜像共用
+ * 向发送端的timing端口做NTP式的时间交换,同步前快速交换,稳定后逐步拉长间隔
+ * 取最近几次交换中往返延迟最小的一次作为偏移估计,再用偏移的历史估计频率漂移
+ * 发送端时间换算成本地时间后作为音频和视频的pts,两者的误差不超过往返延迟的一半
+ */
+
+#ifndef RAOP_NTP_H
+#define RAOP_NTP_H
+
+#include <stdint.h>
+#include "logger.h"
+#include "raop_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct raop_ntp_s raop_ntp_t;
+
+raop_ntp_t *raop_ntp_init(logger_t *logger, raop_pool_t *pool, const unsigned char *remote, int remotelen, unsigned short timing_rport);
+/* 创建socket和交换线程,timing_lport返回本地的timing端口 */
+int raop_ntp_start(raop_ntp_t *raop_ntp, unsigned short *timing_lport);
+void raop_ntp_stop(raop_ntp_t *raop_ntp);
+void raop_ntp_destroy(raop_ntp_t *raop_ntp);
+
+/* 本地时钟,from 1970 us,单调递增 */
+uint64_t raop_ntp_get_local_time(raop_ntp_t *raop_ntp);
+/* 发送端时钟(from 1970 us)和本地时钟互相换算,还没有同步时原样返回 */
+uint64_t raop_ntp_convert_remote_time(raop_ntp_t *raop_ntp, uint64_t remote_time);
+uint64_t raop_ntp_convert_local_time(raop_ntp_t *raop_ntp, uint64_t local_time);
+/* 当前的偏移(发送端减本地) us,所用交换的往返延迟 us,频率漂移 ppm,返回是否已同步 */
+int raop_ntp_get_stats(raop_ntp_t *raop_ntp, int64_t *offset, unsigned int *rtt, int *drift_ppm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RAOP_NTP_H
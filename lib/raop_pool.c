@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "raop_pool.h"
+#include "raop_buffer.h"
+#include "netutils.h"
+#include "compat.h"
+
+/* 每个会话使用的udp socket:时钟同步,音频control和data */
+#define RAOP_POOL_UDP_PER_SESSION 3
+/* 每个会话使用的tcp socket:镜像数据 */
+#define RAOP_POOL_TCP_PER_SESSION 1
+/* 创建失败后重试的间隔 ms */
+#define RAOP_POOL_RETRY_INTERVAL 1000
+
+typedef struct {
+    int sock;
+    unsigned short port;
+} raop_pool_socket_t;
+
+struct raop_pool_s {
+    logger_t *logger;
+
+    /* MUTEX LOCKED VARIABLES START */
+    int size;
+    raop_buffer_t *buffers[RAOP_POOL_MAX_SESSIONS];
+    int buffer_count;
+    raop_pool_socket_t udp[RAOP_POOL_MAX_SESSIONS * RAOP_POOL_UDP_PER_SESSION];
+    int udp_count;
+    raop_pool_socket_t tcp[RAOP_POOL_MAX_SESSIONS * RAOP_POOL_TCP_PER_SESSION];
+    int tcp_count;
+    int running;
+    thread_handle_t thread;
+    mutex_handle_t mutex;
+    cond_handle_t cond;
+    /* MUTEX LOCKED VARIABLES END */
+};
+
+/* 依次补充buffer,udp和tcp socket,每次只创建一个,返回0表示都已补满 */
+static int
+raop_pool_refill_one(raop_pool_t *pool)
+{
+    if (pool->buffer_count < pool->size) {
+        raop_buffer_t *buffer;
+        MUTEX_UNLOCK(pool->mutex);
+        buffer = raop_buffer_init(pool->logger);
+        MUTEX_LOCK(pool->mutex);
+        if (!buffer) {
+            return -1;
+        }
+        if (pool->buffer_count < pool->size) {
+            pool->buffers[pool->buffer_count++] = buffer;
+        } else {
+            raop_buffer_destroy(buffer);
+        }
+        return 1;
+    }
+    if (pool->udp_count < pool->size * RAOP_POOL_UDP_PER_SESSION ||
+        pool->tcp_count < pool->size * RAOP_POOL_TCP_PER_SESSION) {
+        int use_udp = pool->udp_count < pool->size * RAOP_POOL_UDP_PER_SESSION;
+        unsigned short port = 0;
+        int sock;
+        MUTEX_UNLOCK(pool->mutex);
+        sock = netutils_init_socket(&port, 0, use_udp);
+        MUTEX_LOCK(pool->mutex);
+        if (sock == -1) {
+            return -1;
+        }
+        if (use_udp && pool->udp_count < pool->size * RAOP_POOL_UDP_PER_SESSION) {
+            pool->udp[pool->udp_count].sock = sock;
+            pool->udp[pool->udp_count++].port = port;
+        } else if (!use_udp && pool->tcp_count < pool->size * RAOP_POOL_TCP_PER_SESSION) {
+            pool->tcp[pool->tcp_count].sock = sock;
+            pool->tcp[pool->tcp_count++].port = port;
+        } else {
+            closesocket(sock);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static THREAD_RETVAL
+raop_pool_thread(void *arg)
+{
+    raop_pool_t *pool = arg;
+    int ret;
+
+    assert(pool);
+
+    MUTEX_LOCK(pool->mutex);
+    while (pool->running) {
+        ret = raop_pool_refill_one(pool);
+        if (ret > 0) {
+            continue;
+        }
+        if (ret < 0) {
+            logger_log(pool->logger, LOGGER_WARNING, "raop_pool refill failed, retrying later");
+            COND_TIMEDWAIT(pool->cond, pool->mutex, RAOP_POOL_RETRY_INTERVAL);
+        } else {
+            COND_WAIT(pool->cond, pool->mutex);
+        }
+    }
+    MUTEX_UNLOCK(pool->mutex);
+    return 0;
+}
+
+raop_pool_t *
+raop_pool_init(logger_t *logger, int sessions)
+{
+    raop_pool_t *pool;
+
+    assert(logger);
+
+    pool = calloc(1, sizeof(raop_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+    pool->logger = logger;
+    pool->size = sessions < 0 ? 0 : (sessions > RAOP_POOL_MAX_SESSIONS ? RAOP_POOL_MAX_SESSIONS : sessions);
+    pool->running = 1;
+
+    MUTEX_CREATE(pool->mutex);
+    COND_CREATE(pool->cond);
+    THREAD_CREATE(pool->thread, raop_pool_thread, pool);
+    return pool;
+}
+
+/* 超出新容量的资源在这里释放 */
+static void
+raop_pool_trim(raop_pool_t *pool)
+{
+    while (pool->buffer_count > pool->size) {
+        raop_buffer_destroy(pool->buffers[--pool->buffer_count]);
+    }
+    while (pool->udp_count > pool->size * RAOP_POOL_UDP_PER_SESSION) {
+        closesocket(pool->udp[--pool->udp_count].sock);
+    }
+    while (pool->tcp_count > pool->size * RAOP_POOL_TCP_PER_SESSION) {
+        closesocket(pool->tcp[--pool->tcp_count].sock);
+    }
+}
+
+void
+raop_pool_set_size(raop_pool_t *pool, int sessions)
+{
+    assert(pool);
+
+    MUTEX_LOCK(pool->mutex);
+    pool->size = sessions < 0 ? 0 : (sessions > RAOP_POOL_MAX_SESSIONS ? RAOP_POOL_MAX_SESSIONS : sessions);
+    raop_pool_trim(pool);
+    COND_SIGNAL(pool->cond);
+    MUTEX_UNLOCK(pool->mutex);
+}
+
+raop_buffer_t *
+raop_pool_get_buffer(raop_pool_t *pool)
+{
+    raop_buffer_t *buffer = NULL;
+
+    assert(pool);
+
+    MUTEX_LOCK(pool->mutex);
+    if (pool->buffer_count > 0) {
+        buffer = pool->buffers[--pool->buffer_count];
+        COND_SIGNAL(pool->cond);
+    }
+    MUTEX_UNLOCK(pool->mutex);
+    if (!buffer) {
+        logger_log(pool->logger, LOGGER_DEBUG, "raop_pool empty, creating buffer");
+        buffer = raop_buffer_init(pool->logger);
+    }
+    return buffer;
+}
+
+void
+raop_pool_put_buffer(raop_pool_t *pool, raop_buffer_t *buffer)
+{
+    assert(pool);
+
+    if (!buffer) {
+        return;
+    }
+    raop_buffer_reset(buffer);
+    MUTEX_LOCK(pool->mutex);
+    if (pool->buffer_count < pool->size) {
+        pool->buffers[pool->buffer_count++] = buffer;
+        buffer = NULL;
+    }
+    MUTEX_UNLOCK(pool->mutex);
+    if (buffer) {
+        raop_buffer_destroy(buffer);
+    }
+}
+
+int
+raop_pool_get_socket(raop_pool_t *pool, int use_udp, unsigned short *port)
+{
+    int sock = -1;
+
+    assert(pool);
+    assert(port);
+
+    MUTEX_LOCK(pool->mutex);
+    if (use_udp && pool->udp_count > 0) {
+        pool->udp_count--;
+        sock = pool->udp[pool->udp_count].sock;
+        *port = pool->udp[pool->udp_count].port;
+    } else if (!use_udp && pool->tcp_count > 0) {
+        pool->tcp_count--;
+        sock = pool->tcp[pool->tcp_count].sock;
+        *port = pool->tcp[pool->tcp_count].port;
+    }
+    if (sock != -1) {
+        COND_SIGNAL(pool->cond);
+    }
+    MUTEX_UNLOCK(pool->mutex);
+    if (sock == -1) {
+        *port = 0;
+        sock = netutils_init_socket(port, 0, use_udp);
+    }
+    return sock;
+}
+
+void
+raop_pool_destroy(raop_pool_t *pool)
+{
+    if (pool) {
+        MUTEX_LOCK(pool->mutex);
+        pool->running = 0;
+        COND_SIGNAL(pool->cond);
+        MUTEX_UNLOCK(pool->mutex);
+        THREAD_JOIN(pool->thread);
+
+        pool->size = 0;
+        raop_pool_trim(pool);
+        MUTEX_DESTROY(pool->mutex);
+        COND_DESTROY(pool->cond);
+        free(pool);
+    }
+}
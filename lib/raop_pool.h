@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * 会话资源池
+ * 后台线程预先创建音频的jitter buffer(包缓存和配置好的解码器)和绑定好端口的socket,
+ * SETUP时直接取用,不需要等待分配内存,打开解码器和绑定端口
+ * TEARDOWN时buffer复位后放回池中,socket用过即关闭,由后台线程补充新的
+ * 池空时退回到现场创建
+ */
+
+#ifndef RAOP_POOL_H
+#define RAOP_POOL_H
+
+#include "logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* raop_buffer.h经由raop_rtp.h间接包含本文件,这里只做前置声明 */
+typedef struct raop_buffer_s raop_buffer_t;
+
+/* 最多预先准备的会话数 */
+#define RAOP_POOL_MAX_SESSIONS 8
+
+typedef struct raop_pool_s raop_pool_t;
+
+raop_pool_t *raop_pool_init(logger_t *logger, int sessions);
+/* 预先准备的会话数,0表示不预先创建 */
+void raop_pool_set_size(raop_pool_t *pool, int sessions);
+raop_buffer_t *raop_pool_get_buffer(raop_pool_t *pool);
+/* buffer复位后放回池中,池满时销毁 */
+void raop_pool_put_buffer(raop_pool_t *pool, raop_buffer_t *buffer);
+/* 取出一个绑定好端口的ipv4 socket,tcp的还没有listen,失败返回-1 */
+int raop_pool_get_socket(raop_pool_t *pool, int use_udp, unsigned short *port);
+void raop_pool_destroy(raop_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RAOP_POOL_H
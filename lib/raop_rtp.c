@@ -12,6 +12,11 @@
  *  Lesser General Public License for more details.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+/* recvmmsg, sendmmsg */
+#define _GNU_SOURCE
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -25,11 +30,92 @@
 #include "compat.h"
 #include "logger.h"
 #include "byteutils.h"
+#include "timeutils.h"
 #include "mirror_buffer.h"
 #include "stream.h"
+#include "packet_ring.h"
+#include "pcm_pool.h"
+#include "raop_ntp.h"
+#include "rtp_clock.h"
+#include "pcm_gain.h"
+#include "pcm_resampler.h"
+#include "pcm_convert.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAOP_RTP_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RAOP_RTP_HAVE_NEON
+#include <arm_neon.h>
+#endif
 
 #define NO_FLUSH (-42)
 
+#if defined(__linux__)
+#define HAVE_RECVMMSG
+#define HAVE_SENDMMSG
+#define HAVE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#elif !defined(WIN32)
+#define HAVE_POLL
+#include <poll.h>
+#include <fcntl.h>
+#endif
+
+/* pipeline模式下接收线程到解码线程的队列长度 */
+#define RAOP_RTP_RING_SIZE 256
+/* 队列中的包类型 */
+#define RAOP_RTP_RING_DATA  0
+#define RAOP_RTP_RING_SYNC  1
+#define RAOP_RTP_RING_FLUSH 2
+
+/* audio_process_batch一次回调的最大帧数 */
+#define RAOP_RTP_MAX_BATCH_FRAMES 64
+/* 每帧pcm的最大short数,ELD每帧480个双声道采样 */
+#define RAOP_RTP_MAX_FRAME_LEN (2 * 480)
+/* push模式下按时钟漂移更新转换比例的间隔 us */
+#define RAOP_RTP_DRIFT_INTERVAL 1000000
+/* pull模式下读取滞后的平滑系数,开始时前若干帧的平均值作为目标 */
+#define RAOP_RTP_DRIFT_SMOOTH 64
+#define RAOP_RTP_DRIFT_SETTLE 100
+/* 滞后每偏离目标1us调整的ppm,积分项大约一分钟消除稳态误差 */
+#define RAOP_RTP_DRIFT_KP 0.1
+#define RAOP_RTP_DRIFT_KI 0.00002
+
+/* AAC-ELD解码的算法延迟,采样数 */
+#define RAOP_RTP_DECODER_DELAY 480
+/* 能量插值的丢包补偿多一帧延迟 */
+#define RAOP_RTP_CONCEAL_INTERPOLATION 2
+
+/* audio_process回调的帧池大小,应用最多可以同时持有这么多帧 */
+#define RAOP_RTP_PCM_POOL_SIZE 128
+
+/* 统计上报间隔 us */
+#define RAOP_RTP_STATS_INTERVAL 1000000
+
+/* raop_rtp_wait返回的事件 */
+#define RAOP_RTP_EVENT_CONTROL 0x01
+#define RAOP_RTP_EVENT_DATA    0x02
+#define RAOP_RTP_EVENT_WAKEUP  0x04
+
+/* 一次系统调用最多收取的包数 */
+#define RAOP_RTP_BATCH_SIZE 32
+/* 单个包的缓存大小,音频ELD包一般只有几百字节 */
+#define RAOP_RTP_SLOT_LEN 4096
+
+typedef struct {
+    int len;
+    struct sockaddr_storage saddr;
+    socklen_t saddrlen;
+    /* 到达时间,单调时钟 us,有内核时间戳时使用内核时间戳 */
+    uint64_t arrival;
+    char control[NETUTILS_RX_CONTROL_LEN];
+    unsigned char data[RAOP_RTP_SLOT_LEN];
+} raop_rtp_packet_t;
+
 struct h264codec_s {
     unsigned char compatibility;
     short lengthofPPS;
@@ -76,23 +162,25 @@ struct raop_rtp_s {
     int progress_changed;
 
     int flush;
+    /* 队列满时还没放进队列的flush,只由接收线程访问 */
+    int ring_flush;
     thread_handle_t thread;
-    //thread_handle_t thread_time;
     mutex_handle_t run_mutex;
-    //mutex_handle_t time_mutex;
-    //cond_handle_t time_cond;
     /* MUTEX LOCKED VARIABLES END */
 
-    /* Remote control and timing ports */
+    /* 发送端的时钟同步服务,和镜像共用 */
+    raop_ntp_t *ntp;
+    /* 会话资源池,提供jitter buffer和socket */
+    raop_pool_t *pool;
+
+    /* Remote control port */
     unsigned short control_rport;
-    unsigned short timing_rport;
 
-    /* Sockets for control, timing and data */
-    int csock, tsock, dsock;
+    /* Sockets for control and data */
+    int csock, dsock;
 
-    /* Local control, timing and data ports */
+    /* Local control and data ports */
     unsigned short control_lport;
-    unsigned short timing_lport;
     unsigned short data_lport;
 
     /* Initialized after the first control packet */
@@ -100,10 +188,110 @@ struct raop_rtp_s {
     socklen_t control_saddr_len;
     unsigned short control_seqnum;
 
-    /* 同步时间:sync_time是1970开始的真实时间,sync_timestamp是sync_time对应的rtp_timestamp */
-    uint64_t sync_time;
-    unsigned int sync_timestamp;
-
+    /* sync包拟合出的rtp时间戳到发送端时钟的映射 */
+    rtp_clock_t *clock;
+
+    /* 数据包到达间隔的抖动(RFC 3550),只在接收线程中使用,jitter是us的16倍 */
+    int jitter_valid;
+    uint64_t jitter_arrival;
+    unsigned int jitter_timestamp;
+    unsigned int jitter;
+
+    /* pipeline模式:接收线程只收包入队,解码线程负责解密,解码和回调 */
+    int pipeline;
+    /* 播放目标延迟 ms,0表示使用默认值 */
+    unsigned int latency;
+    /* 运行中修改了latency,由持有buffer的线程设置到buffer,用原子操作读写 */
+    int latency_changed;
+    /* 丢包补偿方法,小于0表示使用解码器默认值 */
+    int conceal_method;
+    /* pull模式:接收线程只收包入buffer,应用调用raop_rtp_read出队,buffer用buffer_mutex保护 */
+    int pull;
+    mutex_handle_t buffer_mutex;
+    int pull_started;
+    /* 下一个读出的采样对应的rtp timestamp,转换采样率时带32位小数,pull_step是每个输出采样对应的输入采样数 */
+    unsigned int pull_timestamp;
+    uint32_t pull_frac;
+    uint64_t pull_step;
+    /* 上次出队的帧中还没读出的数据 */
+    const short *pull_data;
+    int pull_samples;
+
+    /* audio_process_batch:每批的帧数,0表示每次出队的所有帧一起回调 */
+    unsigned int batch_frames;
+    unsigned char *batch_data;
+    uint64_t *batch_pts;
+    int *batch_lens;
+    int batch_count;
+    /* batch_data中已经写入的帧,按每个采样的所有声道计 */
+    int batch_samples;
+    /* 最早攒着的帧最晚在这个时间回调,monotonic us */
+    uint64_t batch_deadline;
+
+    /* audio_process回调的帧直接解码到池中 */
+    pcm_pool_t *pcm_pool;
+
+    /* 输出采样率,0表示不转换;resampler在线程启动时创建,pull模式下用buffer_mutex保护 */
+    unsigned int output_rate;
+    pcm_resampler_t *resampler;
+    /* 没有pcm帧池的帧时转换到这里 */
+    short *resample_buf;
+    /* 每帧short的最大个数,转换到更高的采样率时比解码的一帧长 */
+    int max_frame_len;
+    /* 漂移补偿:push模式按时钟同步的漂移定期更新,pull模式按读取的滞后调整 */
+    uint64_t drift_time;
+    int drift_count;
+    double drift_lag;
+    double drift_target;
+    double drift_integral;
+
+    /* 回调的格式,不是交错的16位双声道时convert在线程启动时创建,frame_bytes是每帧输出的字节数 */
+    int format;
+    int channels;
+    int planar;
+    pcm_convert_t *convert;
+    int frame_bytes;
+    /* 没有pcm帧池的帧时转换到这里 */
+    void *convert_buf;
+
+    /* 库内音量处理,RAOP_AUDIO_GAIN_*,gain和会话同生命周期,音量可以随时设置 */
+    int gain_mode;
+    pcm_gain_t *gain;
+
+    /* 静音检测,silence_samples是当前这段连续静音的采样数 */
+    int silence_mode;
+    int silence_threshold;
+    unsigned int silence_timestamp;
+    unsigned int silence_samples;
+    packet_ring_t *ring;
+    void *cb_data;
+    thread_handle_t decoder_thread;
+    mutex_handle_t decoder_mutex;
+    cond_handle_t decoder_cond;
+    int decoder_running;
+
+    /* 统计,耗时的累计值在每次上报后清零 */
+    mutex_handle_t stats_mutex;
+    audio_stats_struct stats;
+    /* buffer实际使用的播放延迟 us,由处理线程更新,0表示还没有开始 */
+    unsigned int playout_delay;
+    uint64_t stats_time;
+    uint64_t queue_wait_sum;
+    uint64_t decode_sum;
+    uint64_t deliver_sum;
+    unsigned int queue_wait_count;
+    unsigned int decode_count;
+    unsigned int deliver_count;
+
+    /* 唤醒音频线程:Linux下是eventfd(读写同一个fd),其他平台是self-pipe */
+    int wakeup_rfd, wakeup_wfd;
+
+    /* 批量收包使用的预分配缓存 */
+    raop_rtp_packet_t *packets;
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr msgs[RAOP_RTP_BATCH_SIZE];
+    struct iovec iovecs[RAOP_RTP_BATCH_SIZE];
+#endif
 };
 
 static int
@@ -133,40 +321,145 @@ raop_rtp_parse_remote(raop_rtp_t *raop_rtp, const unsigned char *remote, int rem
     return 0;
 }
 
+static int
+raop_rtp_init_wakeup(raop_rtp_t *raop_rtp)
+{
+    raop_rtp->wakeup_rfd = -1;
+    raop_rtp->wakeup_wfd = -1;
+#if defined(HAVE_EPOLL)
+    int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd == -1) {
+        return -1;
+    }
+    raop_rtp->wakeup_rfd = efd;
+    raop_rtp->wakeup_wfd = efd;
+#elif defined(HAVE_POLL)
+    int fds[2];
+    if (pipe(fds) == -1) {
+        return -1;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    raop_rtp->wakeup_rfd = fds[0];
+    raop_rtp->wakeup_wfd = fds[1];
+#endif
+    return 0;
+}
+
+static void
+raop_rtp_destroy_wakeup(raop_rtp_t *raop_rtp)
+{
+#if defined(HAVE_EPOLL) || defined(HAVE_POLL)
+    if (raop_rtp->wakeup_rfd != -1) close(raop_rtp->wakeup_rfd);
+    if (raop_rtp->wakeup_wfd != -1 && raop_rtp->wakeup_wfd != raop_rtp->wakeup_rfd) close(raop_rtp->wakeup_wfd);
+#endif
+    raop_rtp->wakeup_rfd = -1;
+    raop_rtp->wakeup_wfd = -1;
+}
+
+/* 通知音频线程处理volume,flush,metadata,stop等事件 */
+static void
+raop_rtp_wakeup(raop_rtp_t *raop_rtp)
+{
+#if defined(HAVE_EPOLL)
+    uint64_t one = 1;
+    if (raop_rtp->wakeup_wfd != -1) {
+        /* 计数满了说明线程还没读,也就不需要再唤醒 */
+        (void) !write(raop_rtp->wakeup_wfd, &one, sizeof(one));
+    }
+#elif defined(HAVE_POLL)
+    unsigned char one = 1;
+    if (raop_rtp->wakeup_wfd != -1) {
+        /* pipe满了说明线程还没读,也就不需要再唤醒 */
+        (void) !write(raop_rtp->wakeup_wfd, &one, sizeof(one));
+    }
+#endif
+}
+
+static void
+raop_rtp_drain_wakeup(raop_rtp_t *raop_rtp)
+{
+#if defined(HAVE_EPOLL)
+    uint64_t value;
+    (void) !read(raop_rtp->wakeup_rfd, &value, sizeof(value));
+#elif defined(HAVE_POLL)
+    unsigned char buf[64];
+    while (read(raop_rtp->wakeup_rfd, buf, sizeof(buf)) > 0);
+#endif
+}
+
 raop_rtp_t *
-raop_rtp_init(logger_t *logger, raop_callbacks_t *callbacks, const unsigned char *remote, int remotelen,
-               const unsigned char *aeskey, const unsigned char *aesiv, const unsigned char *ecdh_secret, unsigned short timing_rport)
+raop_rtp_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp, raop_pool_t *pool, const unsigned char *remote, int remotelen,
+               const unsigned char *aeskey, const unsigned char *aesiv, const unsigned char *ecdh_secret)
 {
     raop_rtp_t *raop_rtp;
 
     assert(logger);
     assert(callbacks);
+    assert(ntp);
+    assert(pool);
 
     raop_rtp = calloc(1, sizeof(raop_rtp_t));
     if (!raop_rtp) {
         return NULL;
     }
     raop_rtp->logger = logger;
-    raop_rtp->timing_rport = timing_rport;
+    raop_rtp->ntp = ntp;
+    raop_rtp->pool = pool;
+    raop_rtp->conceal_method = -1;
 
     memcpy(&raop_rtp->callbacks, callbacks, sizeof(raop_callbacks_t));
-    raop_rtp->buffer = raop_buffer_init(logger, aeskey, aesiv, ecdh_secret);
+    raop_rtp->buffer = raop_pool_get_buffer(pool);
     if (!raop_rtp->buffer) {
         free(raop_rtp);
         return NULL;
     }
+    raop_buffer_set_key(raop_rtp->buffer, aeskey, aesiv, ecdh_secret);
     if (raop_rtp_parse_remote(raop_rtp, remote, remotelen) < 0) {
+        raop_pool_put_buffer(pool, raop_rtp->buffer);
 		free(raop_rtp);
 		return NULL;
 	}
+    raop_rtp->packets = malloc(RAOP_RTP_BATCH_SIZE * sizeof(raop_rtp_packet_t));
+    if (!raop_rtp->packets) {
+        raop_pool_put_buffer(pool, raop_rtp->buffer);
+        free(raop_rtp);
+        return NULL;
+    }
+    raop_rtp->clock = rtp_clock_init(44100);
+    raop_rtp->gain = pcm_gain_init(1);
+    if (!raop_rtp->clock || !raop_rtp->gain) {
+        raop_pool_put_buffer(pool, raop_rtp->buffer);
+        rtp_clock_destroy(raop_rtp->clock);
+        pcm_gain_destroy(raop_rtp->gain);
+        free(raop_rtp->packets);
+        free(raop_rtp);
+        return NULL;
+    }
+    raop_rtp->gain_mode = RAOP_AUDIO_GAIN_DITHER;
+    raop_rtp->format = PCM_FORMAT_S16;
+    raop_rtp->channels = 2;
+#ifdef HAVE_RECVMMSG
+    for (int i = 0; i < RAOP_RTP_BATCH_SIZE; i++) {
+        raop_rtp->iovecs[i].iov_base = raop_rtp->packets[i].data;
+        raop_rtp->iovecs[i].iov_len = RAOP_RTP_SLOT_LEN;
+    }
+#endif
 
     raop_rtp->running = 0;
     raop_rtp->joined = 1;
     raop_rtp->flush = NO_FLUSH;
+    raop_rtp->ring_flush = NO_FLUSH;
+
+    if (raop_rtp_init_wakeup(raop_rtp) < 0) {
+        logger_log(logger, LOGGER_WARNING, "raop_rtp wakeup fd init failed, falling back to polling");
+    }
 
     MUTEX_CREATE(raop_rtp->run_mutex);
-    //MUTEX_CREATE(raop_rtp->time_mutex);
-    //COND_CREATE(raop_rtp->time_cond);
+    MUTEX_CREATE(raop_rtp->decoder_mutex);
+    COND_CREATE(raop_rtp->decoder_cond);
+    MUTEX_CREATE(raop_rtp->stats_mutex);
+    MUTEX_CREATE(raop_rtp->buffer_mutex);
     return raop_rtp;
 }
 
@@ -177,9 +470,15 @@ raop_rtp_destroy(raop_rtp_t *raop_rtp)
     if (raop_rtp) {
         raop_rtp_stop(raop_rtp);
         MUTEX_DESTROY(raop_rtp->run_mutex);
-        //MUTEX_DESTROY(raop_rtp->time_mutex);
-        //COND_DESTROY(raop_rtp->time_cond);
-        raop_buffer_destroy(raop_rtp->buffer);
+        MUTEX_DESTROY(raop_rtp->decoder_mutex);
+        COND_DESTROY(raop_rtp->decoder_cond);
+        MUTEX_DESTROY(raop_rtp->stats_mutex);
+        MUTEX_DESTROY(raop_rtp->buffer_mutex);
+        raop_pool_put_buffer(raop_rtp->pool, raop_rtp->buffer);
+        rtp_clock_destroy(raop_rtp->clock);
+        pcm_gain_destroy(raop_rtp->gain);
+        raop_rtp_destroy_wakeup(raop_rtp);
+        free(raop_rtp->packets);
         free(raop_rtp->metadata);
         free(raop_rtp->coverart);
         free(raop_rtp->dacp_id);
@@ -188,74 +487,300 @@ raop_rtp_destroy(raop_rtp_t *raop_rtp)
     }
 }
 
+/* 每个区间一个0x55重传请求,Linux下一次sendmmsg发出 */
 static int
-raop_rtp_resend_callback(void *opaque, unsigned short seqnum, unsigned short count)
+raop_rtp_resend_callback(void *opaque, const raop_resend_range_t *ranges, int count)
 {
     raop_rtp_t *raop_rtp = opaque;
-    unsigned char packet[8];
+    unsigned char packets[RAOP_BUFFER_MAX_RESEND_RANGES][8];
     unsigned short ourseqnum;
-    struct sockaddr *addr;
+    struct sockaddr_storage saddr;
     socklen_t addrlen;
     int ret;
 
-    addr = (struct sockaddr *)&raop_rtp->control_saddr;
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    memcpy(&saddr, &raop_rtp->control_saddr, sizeof(saddr));
     addrlen = raop_rtp->control_saddr_len;
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
 
-    logger_log(raop_rtp->logger, LOGGER_DEBUG, "Got resend request %d %d", seqnum, count);
-    ourseqnum = raop_rtp->control_seqnum++;
-
-    /* Fill the request buffer */
-    packet[0] = 0x80;
-    packet[1] = 0x55|0x80;
-    packet[2] = (ourseqnum >> 8);
-    packet[3] =  ourseqnum;
-    packet[4] = (seqnum >> 8);
-    packet[5] =  seqnum;
-    packet[6] = (count >> 8);
-    packet[7] =  count;
+    for (int i = 0; i < count; i++) {
+        unsigned char *packet = packets[i];
+        logger_log(raop_rtp->logger, LOGGER_DEBUG, "Got resend request %d %d", ranges[i].seqnum, ranges[i].count);
+        ourseqnum = raop_rtp->control_seqnum++;
+
+        /* Fill the request buffer */
+        packet[0] = 0x80;
+        packet[1] = 0x55|0x80;
+        packet[2] = (ourseqnum >> 8);
+        packet[3] =  ourseqnum;
+        packet[4] = (ranges[i].seqnum >> 8);
+        packet[5] =  ranges[i].seqnum;
+        packet[6] = (ranges[i].count >> 8);
+        packet[7] =  ranges[i].count;
+    }
 
-    ret = sendto(raop_rtp->csock, (const char *)packet, sizeof(packet), 0, addr, addrlen);
-    if (ret == -1) {
-        logger_log(raop_rtp->logger, LOGGER_WARNING, "Resend failed: %d", SOCKET_GET_ERROR());
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[RAOP_BUFFER_MAX_RESEND_RANGES];
+    struct iovec iovecs[RAOP_BUFFER_MAX_RESEND_RANGES];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < count; i++) {
+        iovecs[i].iov_base = packets[i];
+        iovecs[i].iov_len = sizeof(packets[i]);
+        msgs[i].msg_hdr.msg_name = &saddr;
+        msgs[i].msg_hdr.msg_namelen = addrlen;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    ret = sendmmsg(raop_rtp->csock, msgs, count, 0);
+    if (ret < count) {
+        logger_log(raop_rtp->logger, LOGGER_WARNING, "Resend failed: %d/%d sent, %d", ret, count, SOCKET_GET_ERROR());
+    }
+#else
+    for (int i = 0; i < count; i++) {
+        ret = sendto(raop_rtp->csock, (const char *)packets[i], sizeof(packets[i]), 0, (struct sockaddr *)&saddr, addrlen);
+        if (ret == -1) {
+            logger_log(raop_rtp->logger, LOGGER_WARNING, "Resend failed: %d", SOCKET_GET_ERROR());
+        }
     }
+#endif
 
     return 0;
 }
 
 static int
-raop_rtp_init_sockets(raop_rtp_t *raop_rtp, int use_ipv6, int use_udp)
+raop_rtp_init_sockets(raop_rtp_t *raop_rtp, int use_udp)
 {
-    int csock = -1, tsock = -1, dsock = -1;
-    unsigned short cport = 0, tport = 0, dport = 0;
+    int csock = -1, dsock = -1;
+    unsigned short cport = 0, dport = 0;
 
     assert(raop_rtp);
 
-    csock = netutils_init_socket(&cport, use_ipv6, 1);
-    tsock = netutils_init_socket(&tport, use_ipv6, 1);
-    dsock = netutils_init_socket(&dport, use_ipv6, 1);
+    csock = raop_pool_get_socket(raop_rtp->pool, 1, &cport);
+    dsock = raop_pool_get_socket(raop_rtp->pool, 1, &dport);
 
-    if (csock == -1 || tsock == -1 || dsock == -1) {
+    if (csock == -1 || dsock == -1) {
         goto sockets_cleanup;
     }
 
+    /* 内核接收时间戳不含接收线程的调度延迟 */
+    if (netutils_enable_rx_timestamp(csock) < 0 || netutils_enable_rx_timestamp(dsock) < 0) {
+        logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp kernel rx timestamps not available");
+    }
+
     /* Set socket descriptors */
     raop_rtp->csock = csock;
-    raop_rtp->tsock = tsock;
     raop_rtp->dsock = dsock;
 
     /* Set port values */
     raop_rtp->control_lport = cport;
-    raop_rtp->timing_lport = tport;
     raop_rtp->data_lport = dport;
     return 0;
 
     sockets_cleanup:
     if (csock != -1) closesocket(csock);
-    if (tsock != -1) closesocket(tsock);
     if (dsock != -1) closesocket(dsock);
     return -1;
 }
 
+/* pull模式下buffer同时被接收线程和应用的读取线程使用 */
+static void
+raop_rtp_lock_buffer(raop_rtp_t *raop_rtp)
+{
+    if (raop_rtp->pull) {
+        MUTEX_LOCK(raop_rtp->buffer_mutex);
+    }
+}
+
+static void
+raop_rtp_unlock_buffer(raop_rtp_t *raop_rtp)
+{
+    if (raop_rtp->pull) {
+        MUTEX_UNLOCK(raop_rtp->buffer_mutex);
+    }
+}
+
+/* 数据不连续时清空转换的历史,pull模式下重新确定读取滞后的目标 */
+static void
+raop_rtp_reset_resampler(raop_rtp_t *raop_rtp)
+{
+    if (!raop_rtp->resampler) {
+        return;
+    }
+    pcm_resampler_reset(raop_rtp->resampler);
+    if (raop_rtp->pull) {
+        pcm_resampler_set_drift(raop_rtp->resampler, 0.0);
+        raop_rtp->drift_count = 0;
+        raop_rtp->drift_integral = 0.0;
+    }
+}
+
+/* 用拟合的映射计算timestamp对应的发送端时间,再换算到本地时钟,和视频pts一致 */
+static uint64_t
+raop_rtp_timestamp_to_pts(raop_rtp_t *raop_rtp, unsigned int timestamp)
+{
+    uint64_t remote_time = rtp_clock_get_time(raop_rtp->clock, timestamp);
+    if (remote_time == 0) {
+        return 0;
+    }
+    return raop_ntp_convert_remote_time(raop_rtp->ntp, remote_time);
+}
+
+/**
+ * 所有采样的绝对值都不超过threshold时返回1
+ * 记录最大值和最小值,最后和threshold比较,-32768的绝对值不会溢出
+ */
+static int
+raop_rtp_is_silent(const short *pcm, int count, int threshold)
+{
+    int max = 0;
+    int min = 0;
+    int i = 0;
+
+    if (threshold < 0) {
+        return 0;
+    }
+    if (threshold > 32767) {
+        return 1;
+    }
+#if defined(RAOP_RTP_HAVE_SSE2)
+    /* 每次8个采样,饱和比较都是有符号16位 */
+    __m128i vmax = _mm_setzero_si128();
+    __m128i vmin = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (pcm + i));
+        vmax = _mm_max_epi16(vmax, x);
+        vmin = _mm_min_epi16(vmin, x);
+    }
+    /* 对半折叠到最低的16位 */
+    vmax = _mm_max_epi16(vmax, _mm_srli_si128(vmax, 8));
+    vmin = _mm_min_epi16(vmin, _mm_srli_si128(vmin, 8));
+    vmax = _mm_max_epi16(vmax, _mm_srli_si128(vmax, 4));
+    vmin = _mm_min_epi16(vmin, _mm_srli_si128(vmin, 4));
+    vmax = _mm_max_epi16(vmax, _mm_srli_si128(vmax, 2));
+    vmin = _mm_min_epi16(vmin, _mm_srli_si128(vmin, 2));
+    max = (short) _mm_cvtsi128_si32(vmax);
+    min = (short) _mm_cvtsi128_si32(vmin);
+#elif defined(RAOP_RTP_HAVE_NEON)
+    int16x8_t vmax = vdupq_n_s16(0);
+    int16x8_t vmin = vdupq_n_s16(0);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(pcm + i);
+        vmax = vmaxq_s16(vmax, x);
+        vmin = vminq_s16(vmin, x);
+    }
+#if defined(__aarch64__)
+    max = vmaxvq_s16(vmax);
+    min = vminvq_s16(vmin);
+#else
+    int16x4_t hmax = vpmax_s16(vget_low_s16(vmax), vget_high_s16(vmax));
+    int16x4_t hmin = vpmin_s16(vget_low_s16(vmin), vget_high_s16(vmin));
+    hmax = vpmax_s16(hmax, hmax);
+    hmin = vpmin_s16(hmin, hmin);
+    hmax = vpmax_s16(hmax, hmax);
+    hmin = vpmin_s16(hmin, hmin);
+    max = vget_lane_s16(hmax, 0);
+    min = vget_lane_s16(hmin, 0);
+#endif
+#endif
+    /* 剩下不满8个的采样 */
+    for (; i < count; i++) {
+        max = pcm[i] > max ? pcm[i] : max;
+        min = pcm[i] < min ? pcm[i] : min;
+    }
+    return max <= threshold && min >= -threshold;
+}
+
+/* 一段静音结束,EVENT模式下回调一次 */
+static void
+raop_rtp_end_silence(raop_rtp_t *raop_rtp, void *cb_data)
+{
+    if (raop_rtp->silence_samples == 0) {
+        return;
+    }
+    if (raop_rtp->silence_mode == RAOP_AUDIO_SILENCE_EVENT && raop_rtp->callbacks.audio_silence) {
+        raop_rtp->callbacks.audio_silence(raop_rtp->callbacks.cls, cb_data,
+                                          raop_rtp_timestamp_to_pts(raop_rtp, raop_rtp->silence_timestamp),
+                                          raop_rtp->silence_samples);
+    }
+    raop_rtp->silence_samples = 0;
+}
+
+static void
+raop_rtp_flush_buffer(raop_rtp_t *raop_rtp, void *cb_data, int next_seq)
+{
+    raop_rtp_lock_buffer(raop_rtp);
+    raop_buffer_flush(raop_rtp->buffer, next_seq);
+    raop_rtp->pull_started = 0;
+    raop_rtp->pull_data = NULL;
+    raop_rtp->pull_samples = 0;
+    raop_rtp_reset_resampler(raop_rtp);
+    raop_rtp_unlock_buffer(raop_rtp);
+    /* 攒着没回调的帧也一起丢弃,进行中的静音先回调再清零 */
+    raop_rtp->batch_count = 0;
+    raop_rtp->batch_samples = 0;
+    raop_rtp_end_silence(raop_rtp, cb_data);
+    if (raop_rtp->callbacks.audio_flush) {
+        raop_rtp->callbacks.audio_flush(raop_rtp->callbacks.cls, cb_data);
+    }
+}
+
+/* 接收线程调用,把包放入解码队列,队列满时丢弃 */
+static int
+raop_rtp_ring_push(raop_rtp_t *raop_rtp, int type, int value, const unsigned char *data, int len, uint64_t arrival)
+{
+    packet_ring_entry_t *entry;
+    if (type != RAOP_RTP_RING_FLUSH && raop_rtp->ring_flush != NO_FLUSH) {
+        /* 挂起的flush必须排在之后的包前面,放不进去时这个包也放不进去 */
+        if (raop_rtp_ring_push(raop_rtp, RAOP_RTP_RING_FLUSH, raop_rtp->ring_flush, NULL, 0, arrival) < 0) {
+            return -1;
+        }
+        raop_rtp->ring_flush = NO_FLUSH;
+    }
+    entry = packet_ring_write_begin(raop_rtp->ring);
+    if (!entry || len > packet_ring_slot_size(raop_rtp->ring)) {
+        MUTEX_LOCK(raop_rtp->stats_mutex);
+        raop_rtp->stats.queue_drops++;
+        MUTEX_UNLOCK(raop_rtp->stats_mutex);
+        return -1;
+    }
+    entry->type = type;
+    entry->value = value;
+    entry->len = len;
+    entry->time_us = arrival;
+    if (len > 0) {
+        memcpy(entry->data, data, len);
+    }
+    packet_ring_write_commit(raop_rtp->ring);
+    return 0;
+}
+
+/* 尝试把挂起的flush放入队列 */
+static void
+raop_rtp_push_pending_flush(raop_rtp_t *raop_rtp)
+{
+    if (raop_rtp->ring_flush == NO_FLUSH) {
+        return;
+    }
+    if (raop_rtp_ring_push(raop_rtp, RAOP_RTP_RING_FLUSH, raop_rtp->ring_flush, NULL, 0, timeutils_cached_us()) == 0) {
+        raop_rtp->ring_flush = NO_FLUSH;
+    }
+}
+
+static void
+raop_rtp_signal_decoder(raop_rtp_t *raop_rtp)
+{
+    int depth = packet_ring_depth(raop_rtp->ring);
+    MUTEX_LOCK(raop_rtp->stats_mutex);
+    if (depth > raop_rtp->stats.queue_max_depth) {
+        raop_rtp->stats.queue_max_depth = depth;
+    }
+    MUTEX_UNLOCK(raop_rtp->stats_mutex);
+
+    MUTEX_LOCK(raop_rtp->decoder_mutex);
+    COND_SIGNAL(raop_rtp->decoder_cond);
+    MUTEX_UNLOCK(raop_rtp->decoder_mutex);
+}
+
 static int
 raop_rtp_process_events(raop_rtp_t *raop_rtp, void *cb_data)
 {
@@ -326,9 +851,16 @@ raop_rtp_process_events(raop_rtp_t *raop_rtp, void *cb_data)
 
     /* Handle flush if requested */
     if (flush != NO_FLUSH) {
-        raop_buffer_flush(raop_rtp->buffer, flush);
-        if (raop_rtp->callbacks.audio_flush) {
-            raop_rtp->callbacks.audio_flush(raop_rtp->callbacks.cls, cb_data);
+        /* flush之后时间戳不连续 */
+        raop_rtp->jitter_valid = 0;
+        if (raop_rtp->ring) {
+            /* buffer属于解码线程,由解码线程按顺序处理flush */
+            /* 队列满时先挂起,不能和数据包一起丢掉,新的flush覆盖旧的 */
+            raop_rtp->ring_flush = flush;
+            raop_rtp_push_pending_flush(raop_rtp);
+            raop_rtp_signal_decoder(raop_rtp);
+        } else {
+            raop_rtp_flush_buffer(raop_rtp, cb_data, flush);
         }
     }
 
@@ -364,209 +896,957 @@ raop_rtp_process_events(raop_rtp_t *raop_rtp, void *cb_data)
     }
     return 0;
 }
-/* 目前用不到先注释 */
-//static THREAD_RETVAL
-//raop_rtp_thread_time(void *arg)
-//{
-//    raop_rtp_t *raop_rtp = arg;
-//    assert(raop_rtp);
-//    struct sockaddr_storage saddr;
-//    socklen_t saddrlen;
-//    unsigned char packet[128];
-//    unsigned int packetlen;
-//    unsigned char time[32]={0x80,0xd2,0x00,0x07,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
-//            ,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
-//    };
-//    uint64_t base = now_us();
-//    uint64_t rec_pts = 0;
-//    while (1) {
-//        MUTEX_LOCK(raop_rtp->run_mutex);
-//        if (!raop_rtp->running) {
-//            MUTEX_UNLOCK(raop_rtp->run_mutex);
-//            break;
-//        }
-//        MUTEX_UNLOCK(raop_rtp->run_mutex);
-//        uint64_t send_time = now_us() - base + rec_pts;
-//
-//        byteutils_put_timeStamp(time, 24, send_time);
-//        logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_time send time 32 bytes, port = %d", raop_rtp->timing_rport);
-//        struct sockaddr_in *addr = (struct sockaddr_in *)&raop_rtp->remote_saddr;
-//        addr->sin_port = htons(raop_rtp->timing_rport);
-//        int sendlen = sendto(raop_rtp->tsock, (char *)time, sizeof(time), 0, (struct sockaddr *) &raop_rtp->remote_saddr, raop_rtp->remote_saddr_len);
-//        logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_time sendlen = %d", sendlen);
-//
-//        saddrlen = sizeof(saddr);
-//        packetlen = recvfrom(raop_rtp->tsock, (char *)packet, sizeof(packet), 0,
-//                             (struct sockaddr *)&saddr, &saddrlen);
-//        int type_t = packet[1] & ~0x80;
-//        logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_time receive time type_t 0x%02x, packetlen = %d", type_t, packetlen);
-//        if (type_t == 0x53) {
-//
-//        }
-//        /* 9-16 NTP请求报文离开发送端时发送端的本地时间。  T1 */
-//        uint64_t Origin_Timestamp = byteutils_read_timeStamp(packet, 8);
-//        /* 17-24 NTP请求报文到达接收端时接收端的本地时间。 T2 */
-//        uint64_t Receive_Timestamp = byteutils_read_timeStamp(packet, 16);
-//        /* 25-32 Transmit Timestamp：应答报文离开应答者时应答者的本地时间。 T3 */
-//        uint64_t Transmit_Timestamp = byteutils_read_timeStamp(packet, 24);
-//
-//        //logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_time Transmit_Timestamp = %llu", Transmit_Timestamp);
-//
-//        /* FIXME: 先简单这样写吧 */
-//        rec_pts = Receive_Timestamp;
-//
-//#ifdef _WIN32
-//        MUTEX_LOCK(raop_rtp->time_mutex);
-//        WaitForSingleObject(&raop_rtp->time_cond, 3000);
-//        MUTEX_UNLOCK(raop_rtp->time_mutex);
-//#else
-//        struct timeval now;
-//        struct timespec outtime;
-//        MUTEX_LOCK(raop_rtp->time_mutex);
-//        gettimeofday(&now, NULL);
-//        outtime.tv_sec = now.tv_sec + 3;
-//        outtime.tv_nsec = now.tv_usec * 1000;
-//        int ret = pthread_cond_timedwait(&raop_rtp->time_cond, &raop_rtp->time_mutex, &outtime);
-//        MUTEX_UNLOCK(raop_rtp->time_mutex);
-//#endif
-//
-//    }
-//
-//    logger_log(raop_rtp->logger, LOGGER_INFO, "Exiting UDP raop_rtp_thread_time thread");
-//    return 0;
-//}
+/**
+ * 从sock批量收包到raop_rtp->packets,返回收到的包数,出错返回-1
+ * Linux下使用recvmmsg一次收取,其他平台退化为逐个recvfrom
+ */
+static int
+raop_rtp_recv_batch(raop_rtp_t *raop_rtp, int sock)
+{
+    int count = 0;
+#ifdef HAVE_RECVMMSG
+    for (int i = 0; i < RAOP_RTP_BATCH_SIZE; i++) {
+        struct msghdr *hdr = &raop_rtp->msgs[i].msg_hdr;
+        memset(hdr, 0, sizeof(*hdr));
+        hdr->msg_name = &raop_rtp->packets[i].saddr;
+        hdr->msg_namelen = sizeof(raop_rtp->packets[i].saddr);
+        hdr->msg_iov = &raop_rtp->iovecs[i];
+        hdr->msg_iovlen = 1;
+        hdr->msg_control = raop_rtp->packets[i].control;
+        hdr->msg_controllen = sizeof(raop_rtp->packets[i].control);
+    }
+    count = recvmmsg(sock, raop_rtp->msgs, RAOP_RTP_BATCH_SIZE, MSG_DONTWAIT, NULL);
+    if (count < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    for (int i = 0; i < count; i++) {
+        raop_rtp_packet_t *packet = &raop_rtp->packets[i];
+        uint64_t timestamp = netutils_get_rx_timestamp(&raop_rtp->msgs[i].msg_hdr);
+        packet->saddrlen = raop_rtp->msgs[i].msg_hdr.msg_namelen;
+        packet->len = raop_rtp->msgs[i].msg_len;
+        packet->arrival = timestamp ? timeutils_realtime_to_monotonic_us(timestamp) : timeutils_cached_us();
+        if (raop_rtp->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            logger_log(raop_rtp->logger, LOGGER_WARNING, "raop_rtp_recv_batch dropped truncated packet");
+            packet->len = 0;
+        }
+    }
+#else
+    while (count < RAOP_RTP_BATCH_SIZE) {
+        raop_rtp_packet_t *packet = &raop_rtp->packets[count];
+        int flags = 0;
+        int saddrlen = sizeof(packet->saddr);
+        uint64_t timestamp;
+#ifdef MSG_DONTWAIT
+        /* 第一个包select已经确认可读,后面的包不能阻塞 */
+        flags = count ? MSG_DONTWAIT : 0;
+#endif
+        packet->len = netutils_recvfrom_timestamp(sock, packet->data, sizeof(packet->data), flags,
+                                                  &packet->saddr, &saddrlen, &timestamp);
+        if (packet->len < 0) {
+            if (count == 0) {
+                return -1;
+            }
+            break;
+        }
+        packet->saddrlen = saddrlen;
+        packet->arrival = timestamp ? timeutils_realtime_to_monotonic_us(timestamp) : timeutils_cached_us();
+        count++;
+#ifndef MSG_DONTWAIT
+        break;
+#endif
+    }
+#endif
+    return count;
+}
+
+static void
+raop_rtp_handle_sync(raop_rtp_t *raop_rtp, unsigned char *packet)
+{
+    /**
+     * packetlen = 20
+     * bytes	description
+        8	RTP header without SSRC
+        8	current NTP time
+        4	RTP timestamp for the next audio packet
+     */
+    uint64_t ntp_time = timeutils_ntp_to_us(byteutils_read_ntp(packet, 8));
+    unsigned int rtp_timestamp = (packet[4] << 24) | (packet[5] << 16) |
+            (packet[6] << 8) | packet[7];
+    unsigned int next_timestamp = (packet[16] << 24) | (packet[17] << 16) |
+            (packet[18] << 8) | packet[19];
+    //logger_log(raop_rtp->logger, LOGGER_DEBUG, "rtp audio ntp time = %llu", ntp_time);
+    //logger_log(raop_rtp->logger, LOGGER_DEBUG, "rtp audio rtp_timestamp = %u", rtp_timestamp);
+    //logger_log(raop_rtp->logger, LOGGER_DEBUG, "rtp audio next_timestamp = %u", next_timestamp);
+    /* ntp_time和rtp_timestamp 用于音画同步,加入拟合而不是直接替换,pts不会在sync包到达时跳变 */
+    raop_rtp_lock_buffer(raop_rtp);
+    rtp_clock_add_sync(raop_rtp->clock, rtp_timestamp, ntp_time);
+    raop_rtp_unlock_buffer(raop_rtp);
+}
+
+/**
+ * push模式下按发送端采样率的漂移和发送端时钟相对本地时钟的漂移调整转换比例,
+ * 每个本地的秒输出正好output_rate个采样
+ */
+static void
+raop_rtp_update_clock_drift(raop_rtp_t *raop_rtp, uint64_t now)
+{
+    int clock_drift = 0;
+
+    if (!raop_rtp->resampler || now - raop_rtp->drift_time < RAOP_RTP_DRIFT_INTERVAL) {
+        return;
+    }
+    raop_rtp->drift_time = now;
+    if (!raop_ntp_get_stats(raop_rtp->ntp, NULL, NULL, &clock_drift)) {
+        clock_drift = 0;
+    }
+    pcm_resampler_set_drift(raop_rtp->resampler, rtp_clock_get_drift_ppm(raop_rtp->clock) + clock_drift);
+}
+
+/**
+ * pull模式下读取的节奏由输出设备的时钟决定,比发送端慢时读取的滞后增大,buffer越积越多,
+ * 这时让每个输出采样消耗更多的输入,PI控制把滞后保持在开始时的水平
+ */
+static void
+raop_rtp_update_pull_drift(raop_rtp_t *raop_rtp, unsigned int timestamp)
+{
+    uint64_t pts = raop_rtp_timestamp_to_pts(raop_rtp, timestamp);
+    double lag, error;
+
+    if (!raop_rtp->resampler || pts == 0) {
+        return;
+    }
+    lag = (double) (int64_t) (raop_ntp_get_local_time(raop_rtp->ntp) - pts);
+    if (raop_rtp->drift_count < RAOP_RTP_DRIFT_SETTLE) {
+        raop_rtp->drift_count++;
+        raop_rtp->drift_lag = raop_rtp->drift_count == 1 ? lag : raop_rtp->drift_lag + (lag - raop_rtp->drift_lag) / raop_rtp->drift_count;
+        raop_rtp->drift_target = raop_rtp->drift_lag;
+        return;
+    }
+    raop_rtp->drift_lag += (lag - raop_rtp->drift_lag) / RAOP_RTP_DRIFT_SMOOTH;
+    error = raop_rtp->drift_lag - raop_rtp->drift_target;
+    raop_rtp->drift_integral += error * RAOP_RTP_DRIFT_KI;
+    if (raop_rtp->drift_integral > PCM_RESAMPLER_MAX_DRIFT) {
+        raop_rtp->drift_integral = PCM_RESAMPLER_MAX_DRIFT;
+    } else if (raop_rtp->drift_integral < -PCM_RESAMPLER_MAX_DRIFT) {
+        raop_rtp->drift_integral = -PCM_RESAMPLER_MAX_DRIFT;
+    }
+    pcm_resampler_set_drift(raop_rtp->resampler, error * RAOP_RTP_DRIFT_KP + raop_rtp->drift_integral);
+}
+
+/* 把解码的一帧转换到输出采样率写到out,timestamp改为第一个输出采样对应的时间 */
+static const void *
+raop_rtp_resample(raop_rtp_t *raop_rtp, const void *audiobuf, int *audiobuflen, unsigned int *timestamp, short *out)
+{
+    int delay = pcm_resampler_get_delay(raop_rtp->resampler);
+    int frames = pcm_resampler_process(raop_rtp->resampler, audiobuf, *audiobuflen / (2 * sizeof(short)),
+                                       out, raop_rtp->max_frame_len / 2);
+    *audiobuflen = frames * 2 * sizeof(short);
+    *timestamp -= delay;
+    return out;
+}
+
+/**
+ * 到达间隔抖动,RFC 3550 6.4.1: J += (|D| - J) / 16
+ * D是相邻两个包的到达间隔和时间戳间隔之差,超过1秒认为是发送端暂停或者跳转,重新开始
+ */
+static void
+raop_rtp_update_jitter(raop_rtp_t *raop_rtp, const unsigned char *packet, uint64_t arrival)
+{
+    unsigned int timestamp = (packet[4] << 24) | (packet[5] << 16) | (packet[6] << 8) | packet[7];
+
+    if (raop_rtp->jitter_valid) {
+        int64_t d = (int64_t) (arrival - raop_rtp->jitter_arrival) -
+                    timeutils_rtp_to_us((int32_t) (timestamp - raop_rtp->jitter_timestamp), 44100);
+        if (d < 0) {
+            d = -d;
+        }
+        if (d < 1000000) {
+            raop_rtp->jitter += (unsigned int) d - ((raop_rtp->jitter + 8) >> 4);
+        }
+    }
+    raop_rtp->jitter_valid = 1;
+    raop_rtp->jitter_arrival = arrival;
+    raop_rtp->jitter_timestamp = timestamp;
+}
+
+/* 音频包放入buffer,解密解码在出队时进行 */
+static void
+raop_rtp_queue_audio(raop_rtp_t *raop_rtp, unsigned char *data, int datalen, uint64_t arrival)
+{
+    raop_rtp_lock_buffer(raop_rtp);
+    int ret = raop_buffer_queue(raop_rtp->buffer, data, datalen, arrival, &raop_rtp->callbacks);
+    raop_rtp_unlock_buffer(raop_rtp);
+    assert(ret >= 0);
+    MUTEX_LOCK(raop_rtp->stats_mutex);
+    raop_rtp->stats.packets++;
+    MUTEX_UNLOCK(raop_rtp->stats_mutex);
+}
+
+static void
+raop_rtp_report_stats(raop_rtp_t *raop_rtp, void *cb_data)
+{
+    audio_stats_struct stats;
+    uint64_t now = timeutils_monotonic_us();
+
+    if (!raop_rtp->callbacks.audio_stats) {
+        return;
+    }
+    if (raop_rtp->stats_time == 0) {
+        raop_rtp->stats_time = now;
+        return;
+    }
+    if (now - raop_rtp->stats_time < RAOP_RTP_STATS_INTERVAL) {
+        return;
+    }
+    raop_rtp->stats_time = now;
+
+    MUTEX_LOCK(raop_rtp->stats_mutex);
+    raop_rtp->stats.queue_depth = raop_rtp->ring ? packet_ring_depth(raop_rtp->ring) : 0;
+    raop_rtp->stats.queue_wait_avg_us = raop_rtp->queue_wait_count ? (unsigned int) (raop_rtp->queue_wait_sum / raop_rtp->queue_wait_count) : 0;
+    raop_rtp->stats.decode_avg_us = raop_rtp->decode_count ? (unsigned int) (raop_rtp->decode_sum / raop_rtp->decode_count) : 0;
+    raop_rtp->stats.deliver_avg_us = raop_rtp->deliver_count ? (unsigned int) (raop_rtp->deliver_sum / raop_rtp->deliver_count) : 0;
+    memcpy(&stats, &raop_rtp->stats, sizeof(stats));
+    /* 耗时类统计每个周期重新开始 */
+    raop_rtp->stats.queue_max_depth = 0;
+    raop_rtp->stats.queue_wait_max_us = 0;
+    raop_rtp->stats.decode_max_us = 0;
+    raop_rtp->stats.deliver_max_us = 0;
+    MUTEX_UNLOCK(raop_rtp->stats_mutex);
+    raop_rtp->queue_wait_sum = raop_rtp->decode_sum = raop_rtp->deliver_sum = 0;
+    raop_rtp->queue_wait_count = raop_rtp->decode_count = raop_rtp->deliver_count = 0;
+
+    raop_rtp_lock_buffer(raop_rtp);
+    raop_buffer_get_resend_stats(raop_rtp->buffer, &stats);
+    stats.buffer_depth = raop_buffer_get_depth(raop_rtp->buffer);
+    stats.rtp_drift_ppm = rtp_clock_get_drift_ppm(raop_rtp->clock);
+    if (raop_rtp->resampler) {
+        stats.output_drift_ppm = (int) pcm_resampler_get_drift(raop_rtp->resampler);
+    }
+    raop_rtp_unlock_buffer(raop_rtp);
+    if (raop_rtp->pcm_pool) {
+        pcm_pool_get_stats(raop_rtp->pcm_pool, &stats.pool_frames, &stats.pool_in_use, &stats.pool_max_in_use);
+    }
+    stats.clock_synced = raop_ntp_get_stats(raop_rtp->ntp, &stats.clock_offset_us, &stats.clock_rtt_us, &stats.clock_drift_ppm);
+
+    raop_rtp->callbacks.audio_stats(raop_rtp->callbacks.cls, cb_data, &stats);
+}
+
+/* 固定每批帧数时最早的帧最多多等的时间,单位是44100Hz的采样数 */
+static unsigned int
+raop_rtp_batch_hold(unsigned int batch_frames)
+{
+    if (batch_frames > RAOP_RTP_MAX_BATCH_FRAMES) {
+        batch_frames = RAOP_RTP_MAX_BATCH_FRAMES;
+    }
+    return batch_frames > 1 ? (batch_frames - 1) * (RAOP_RTP_MAX_FRAME_LEN / 2) : 0;
+}
 
+/* 距离buffer中下一帧播放时间,下次重传请求或攒着的帧最晚回调时间的ms数,都没有时返回-1 */
+static int
+raop_rtp_buffer_timeout(raop_rtp_t *raop_rtp)
+{
+    uint64_t deadline, resend_deadline;
+    uint64_t now;
+    unsigned int playout_delay;
+    raop_rtp_lock_buffer(raop_rtp);
+    /* pull模式下播放时间由读取方决定 */
+    deadline = raop_rtp->pull ? 0 : raop_buffer_get_deadline(raop_rtp->buffer);
+    resend_deadline = raop_buffer_get_resend_deadline(raop_rtp->buffer);
+    playout_delay = raop_buffer_get_playout_delay(raop_rtp->buffer);
+    raop_rtp_unlock_buffer(raop_rtp);
+    /* 抖动余量随包到达变化,给RECORD应答使用 */
+    MUTEX_LOCK(raop_rtp->stats_mutex);
+    raop_rtp->playout_delay = playout_delay;
+    MUTEX_UNLOCK(raop_rtp->stats_mutex);
+    if (raop_rtp->control_rport != 0 && resend_deadline != 0 &&
+        (deadline == 0 || resend_deadline < deadline)) {
+        deadline = resend_deadline;
+    }
+    if (raop_rtp->batch_count > 0 && (deadline == 0 || raop_rtp->batch_deadline < deadline)) {
+        deadline = raop_rtp->batch_deadline;
+    }
+    if (deadline == 0) {
+        return -1;
+    }
+    now = timeutils_monotonic_us();
+    if (deadline <= now) {
+        return 0;
+    }
+    return (int) ((deadline - now + 999) / 1000);
+}
+
+static void
+raop_rtp_record_deliver(raop_rtp_t *raop_rtp, unsigned int elapsed, int frames)
+{
+    raop_rtp->deliver_sum += elapsed;
+    raop_rtp->deliver_count++;
+    MUTEX_LOCK(raop_rtp->stats_mutex);
+    raop_rtp->stats.frames += frames;
+    if (elapsed > raop_rtp->stats.deliver_max_us) {
+        raop_rtp->stats.deliver_max_us = elapsed;
+    }
+    MUTEX_UNLOCK(raop_rtp->stats_mutex);
+}
+
+static void
+raop_rtp_deliver_batch(raop_rtp_t *raop_rtp, void *cb_data)
+{
+    pcm_batch_struct batch;
+    uint64_t start;
+
+    if (raop_rtp->batch_count == 0) {
+        return;
+    }
+    batch.data = raop_rtp->batch_data;
+    batch.frame_count = raop_rtp->batch_count;
+    batch.frame_len = raop_rtp->batch_lens[0];
+    for (int i = 1; i < raop_rtp->batch_count; i++) {
+        if (raop_rtp->batch_lens[i] != batch.frame_len) {
+            batch.frame_len = 0;
+            break;
+        }
+    }
+    batch.frame_lens = raop_rtp->batch_lens;
+    batch.data_len = raop_rtp->batch_samples * raop_rtp->channels;
+    batch.pts = raop_rtp->batch_pts;
+    batch.format = raop_rtp->format;
+    batch.channels = raop_rtp->channels;
+    batch.planar = raop_rtp->planar;
+    start = timeutils_monotonic_us();
+    raop_rtp->callbacks.audio_process_batch(raop_rtp->callbacks.cls, cb_data, &batch);
+    raop_rtp_record_deliver(raop_rtp, (unsigned int) (timeutils_monotonic_us() - start), raop_rtp->batch_count);
+    raop_rtp->batch_count = 0;
+    raop_rtp->batch_samples = 0;
+}
+
+/* 交错的16位双声道写到out的第offset帧,不需要转换格式时直接拷贝 */
+static void
+raop_rtp_convert(raop_rtp_t *raop_rtp, const short *in, int frames, void *out, int offset, int out_frames)
+{
+    if (raop_rtp->convert) {
+        pcm_convert_process(raop_rtp->convert, in, frames, out, offset, out_frames);
+    } else {
+        memcpy((short *) out + offset * 2, in, frames * 2 * sizeof(short));
+    }
+}
+
+/* 把一帧转换到批量回调的缓存,攒够帧数时回调,转换采样率后各帧长度可以不同 */
+static void
+raop_rtp_batch_frame(raop_rtp_t *raop_rtp, void *cb_data, const void *audiobuf, int audiobuflen, unsigned int timestamp)
+{
+    int frames = audiobuflen / (2 * sizeof(short));
+    int limit = raop_rtp->batch_frames ? raop_rtp->batch_frames : RAOP_RTP_MAX_BATCH_FRAMES;
+
+    if (frames > raop_rtp->max_frame_len / 2) {
+        frames = raop_rtp->max_frame_len / 2;
+    }
+    if (raop_rtp->batch_count == 0) {
+        raop_rtp->batch_deadline = timeutils_monotonic_us() +
+                timeutils_rtp_to_us(raop_rtp_batch_hold(raop_rtp->batch_frames), 44100);
+    }
+    raop_rtp_convert(raop_rtp, audiobuf, frames,
+                     raop_rtp->batch_data + raop_rtp->batch_samples * raop_rtp->frame_bytes, 0, frames);
+    raop_rtp->batch_pts[raop_rtp->batch_count] = raop_rtp_timestamp_to_pts(raop_rtp, timestamp);
+    raop_rtp->batch_lens[raop_rtp->batch_count] = frames * raop_rtp->channels;
+    raop_rtp->batch_samples += frames;
+    raop_rtp->batch_count++;
+    if (raop_rtp->batch_count >= limit) {
+        raop_rtp_deliver_batch(raop_rtp, cb_data);
+    }
+}
+
+/* 运行中修改的目标延迟在持有buffer的线程中生效,没有修改时不加锁 */
+static void
+raop_rtp_apply_latency(raop_rtp_t *raop_rtp)
+{
+    unsigned int latency_ms;
+
+    if (!ATOMIC_LOAD_ACQUIRE(&raop_rtp->latency_changed)) {
+        return;
+    }
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    latency_ms = raop_rtp->latency ? raop_rtp->latency : RAOP_BUFFER_DEFAULT_LATENCY;
+    ATOMIC_STORE_RELEASE(&raop_rtp->latency_changed, 0);
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp_lock_buffer(raop_rtp);
+    raop_buffer_set_latency(raop_rtp->buffer, latency_ms);
+    raop_rtp_unlock_buffer(raop_rtp);
+}
+
+/* 取出buffer中所有到了播放时间的帧回调出去,再处理到期的重传请求 */
+static void
+raop_rtp_process_audio(raop_rtp_t *raop_rtp, void *cb_data)
+{
+    int no_resend = (raop_rtp->control_rport == 0);/* false */
+    const void *audiobuf;
+    int audiobuflen;
+    unsigned int timestamp;
+    uint64_t start = timeutils_monotonic_us();
+    raop_rtp_apply_latency(raop_rtp);
+    if (raop_rtp->pull) {
+        /* 出队由raop_rtp_read完成,这里只处理重传 */
+        if (!no_resend) {
+            MUTEX_LOCK(raop_rtp->buffer_mutex);
+            raop_buffer_handle_resends(raop_rtp->buffer, start, raop_rtp_resend_callback, raop_rtp);
+            MUTEX_UNLOCK(raop_rtp->buffer_mutex);
+        }
+        raop_rtp_report_stats(raop_rtp, cb_data);
+        return;
+    }
+    raop_rtp_update_clock_drift(raop_rtp, start);
+    /* Decode all frames in queue */
+    while (1) {
+        pcm_frame_t *frame = NULL;
+        if (raop_rtp->pcm_pool) {
+            frame = pcm_pool_get(raop_rtp->pcm_pool);
+        }
+        audiobuf = raop_buffer_dequeue(raop_rtp->buffer, start, frame ? pcm_frame_data(frame) : NULL, &audiobuflen, &timestamp);
+        if (!audiobuf) {
+            if (frame) {
+                pcm_frame_release(frame);
+            }
+            break;
+        }
+        if (raop_rtp->pcm_pool && !frame) {
+            /* 应用持有的帧太多,这一帧只能在回调中拷贝 */
+            MUTEX_LOCK(raop_rtp->stats_mutex);
+            raop_rtp->stats.pool_exhausted++;
+            MUTEX_UNLOCK(raop_rtp->stats_mutex);
+        }
+        unsigned int elapsed = (unsigned int) (timeutils_monotonic_us() - start);
+        raop_rtp->decode_sum += elapsed;
+        raop_rtp->decode_count++;
+        MUTEX_LOCK(raop_rtp->stats_mutex);
+        if (elapsed > raop_rtp->stats.decode_max_us) {
+            raop_rtp->stats.decode_max_us = elapsed;
+        }
+        MUTEX_UNLOCK(raop_rtp->stats_mutex);
+        if (raop_rtp->silence_mode != RAOP_AUDIO_SILENCE_OFF &&
+            raop_rtp_is_silent(audiobuf, audiobuflen / sizeof(short), raop_rtp->silence_threshold)) {
+            if (raop_rtp->silence_samples == 0) {
+                /* 静音之前攒着的帧先回调,保持顺序 */
+                if (raop_rtp->batch_data) {
+                    raop_rtp_deliver_batch(raop_rtp, cb_data);
+                }
+                /* 静音的帧不经过转换,之后的数据和历史不连续 */
+                raop_rtp_reset_resampler(raop_rtp);
+                raop_rtp->silence_timestamp = timestamp;
+            }
+            raop_rtp->silence_samples += audiobuflen / (2 * sizeof(short));
+            MUTEX_LOCK(raop_rtp->stats_mutex);
+            raop_rtp->stats.silent_frames++;
+            MUTEX_UNLOCK(raop_rtp->stats_mutex);
+            if (frame) {
+                pcm_frame_release(frame);
+            }
+            start = timeutils_monotonic_us();
+            continue;
+        }
+        raop_rtp_end_silence(raop_rtp, cb_data);
+        if (raop_rtp->resampler) {
+            audiobuf = raop_rtp_resample(raop_rtp, audiobuf, &audiobuflen, &timestamp,
+                                         frame ? pcm_frame_data(frame) : raop_rtp->resample_buf);
+            if (audiobuflen == 0) {
+                if (frame) {
+                    pcm_frame_release(frame);
+                }
+                start = timeutils_monotonic_us();
+                continue;
+            }
+        }
+        if (raop_rtp->gain_mode != RAOP_AUDIO_GAIN_OFF) {
+            pcm_gain_apply(raop_rtp->gain, (short *) audiobuf, audiobuflen / sizeof(short));
+        }
+        if (raop_rtp->batch_data) {
+            raop_rtp_batch_frame(raop_rtp, cb_data, audiobuf, audiobuflen, timestamp);
+            start = timeutils_monotonic_us();
+            continue;
+        }
+        pcm_data_struct pcm_data;
+        pcm_data.frames = audiobuflen / (2 * sizeof(short));
+        if (raop_rtp->convert) {
+            /* 池中的帧后半部分留给转换的结果,回调的数据仍然在帧中 */
+            void *out = frame ? (void *) (pcm_frame_data(frame) + raop_rtp->max_frame_len) : raop_rtp->convert_buf;
+            pcm_convert_process(raop_rtp->convert, audiobuf, pcm_data.frames, out, 0, pcm_data.frames);
+            pcm_data.data = out;
+        } else {
+            pcm_data.data = (void *) audiobuf;
+        }
+        //modified by huanggang 20190617
+        pcm_data.data_len = pcm_data.frames * raop_rtp->frame_bytes;//960;
+        //end modify
+        pcm_data.pts = raop_rtp_timestamp_to_pts(raop_rtp, timestamp);
+        pcm_data.frame = frame;
+        pcm_data.format = raop_rtp->format;
+        pcm_data.channels = raop_rtp->channels;
+        pcm_data.planar = raop_rtp->planar;
+        start = timeutils_monotonic_us();
+        raop_rtp->callbacks.audio_process(raop_rtp->callbacks.cls, cb_data, &pcm_data);
+        if (frame) {
+            pcm_frame_release(frame);
+        }
+        elapsed = (unsigned int) (timeutils_monotonic_us() - start);
+        start += elapsed;
+        raop_rtp_record_deliver(raop_rtp, elapsed, 1);
+    }
+    /* 每批帧数固定时,攒着的帧到了最晚时间也要回调,流结束时最后不满一批的帧不会一直留着 */
+    if (raop_rtp->batch_data && raop_rtp->batch_count > 0 &&
+        (raop_rtp->batch_frames == 0 || start >= raop_rtp->batch_deadline)) {
+        raop_rtp_deliver_batch(raop_rtp, cb_data);
+        start = timeutils_monotonic_us();
+    }
+    /* Handle possible resend requests */
+    if (!no_resend) {
+        raop_buffer_handle_resends(raop_rtp->buffer, start, raop_rtp_resend_callback, raop_rtp);
+    }
+    raop_rtp_report_stats(raop_rtp, cb_data);
+}
+
+/**
+ * pipeline模式下的解码线程,从队列中取包解密解码并回调
+ */
 static THREAD_RETVAL
-raop_rtp_thread_udp(void *arg)
+raop_rtp_thread_decoder(void *arg)
 {
     raop_rtp_t *raop_rtp = arg;
-    logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_udp");
-    unsigned char packet[RAOP_PACKET_LEN];
-    unsigned int packetlen;
-    struct sockaddr_storage saddr;
-    socklen_t saddrlen;
+    packet_ring_entry_t *entry;
     assert(raop_rtp);
-    void *cb_data = raop_rtp->callbacks.audio_init(raop_rtp->callbacks.cls);
-    while(1) {
-        fd_set rfds;
-        struct timeval tv;
-        int nfds, ret;
-
-        /* Check if we are still running and process callbacks */
-        if (raop_rtp_process_events(raop_rtp, cb_data)) {
+    logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_decoder");
+    while (1) {
+        int running;
+
+        MUTEX_LOCK(raop_rtp->decoder_mutex);
+        while (raop_rtp->decoder_running && packet_ring_depth(raop_rtp->ring) == 0) {
+            /* 没有新包时等到下一帧的播放时间 */
+            int timeout_ms = raop_rtp_buffer_timeout(raop_rtp);
+            if (timeout_ms == 0) {
+                break;
+            } else if (timeout_ms < 0) {
+                COND_WAIT(raop_rtp->decoder_cond, raop_rtp->decoder_mutex);
+            } else {
+                COND_TIMEDWAIT(raop_rtp->decoder_cond, raop_rtp->decoder_mutex, timeout_ms);
+            }
+        }
+        running = raop_rtp->decoder_running;
+        MUTEX_UNLOCK(raop_rtp->decoder_mutex);
+        if (!running) {
             break;
         }
 
-        /* Set timeout value to 5ms */
-        tv.tv_sec = 0;
-        tv.tv_usec = 5000;
+        while ((entry = packet_ring_read_begin(raop_rtp->ring))) {
+            unsigned int wait = (unsigned int) (timeutils_monotonic_us() - entry->time_us);
+            raop_rtp->queue_wait_sum += wait;
+            raop_rtp->queue_wait_count++;
+            MUTEX_LOCK(raop_rtp->stats_mutex);
+            if (wait > raop_rtp->stats.queue_wait_max_us) {
+                raop_rtp->stats.queue_wait_max_us = wait;
+            }
+            MUTEX_UNLOCK(raop_rtp->stats_mutex);
+
+            switch (entry->type) {
+                case RAOP_RTP_RING_DATA:
+                    raop_rtp_queue_audio(raop_rtp, entry->data, entry->len, entry->time_us);
+                    break;
+                case RAOP_RTP_RING_SYNC:
+                    raop_rtp_handle_sync(raop_rtp, entry->data);
+                    break;
+                case RAOP_RTP_RING_FLUSH:
+                    raop_rtp_flush_buffer(raop_rtp, raop_rtp->cb_data, entry->value);
+                    break;
+            }
+            packet_ring_read_commit(raop_rtp->ring);
+        }
+        raop_rtp_process_audio(raop_rtp, raop_rtp->cb_data);
+    }
+    logger_log(raop_rtp->logger, LOGGER_INFO, "Exiting raop_rtp_thread_decoder thread");
+    return 0;
+}
+
+static void
+raop_rtp_handle_control(raop_rtp_t *raop_rtp, raop_rtp_packet_t *rtp_packet)
+{
+    unsigned char *packet = rtp_packet->data;
+    int packetlen = rtp_packet->len;
+
+    if (packetlen < 4) {
+        return;
+    }
+    /* pipeline模式下重传请求在解码线程发出,需要加锁 */
+    if (rtp_packet->saddrlen != raop_rtp->control_saddr_len ||
+        memcmp(&raop_rtp->control_saddr, &rtp_packet->saddr, rtp_packet->saddrlen)) {
+        MUTEX_LOCK(raop_rtp->run_mutex);
+        memcpy(&raop_rtp->control_saddr, &rtp_packet->saddr, rtp_packet->saddrlen);
+        raop_rtp->control_saddr_len = rtp_packet->saddrlen;
+        MUTEX_UNLOCK(raop_rtp->run_mutex);
+    }
+    int type_c = packet[1] & ~0x80;
+    logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_udp type_c 0x%02x, packetlen = %d", type_c, packetlen);
+    if (type_c == 0x56) {
+        /* 处理重传的包，去除头部4个字节 */
+        if (raop_rtp->ring) {
+            raop_rtp_ring_push(raop_rtp, RAOP_RTP_RING_DATA, 0, packet+4, packetlen-4, rtp_packet->arrival);
+        } else {
+            raop_rtp_queue_audio(raop_rtp, packet+4, packetlen-4, rtp_packet->arrival);
+        }
+    } else if (type_c == 0x54 && packetlen >= 20) {
+        if (raop_rtp->ring) {
+            /* 同步信息由解码线程使用,按顺序放入队列 */
+            raop_rtp_ring_push(raop_rtp, RAOP_RTP_RING_SYNC, 0, packet, packetlen, rtp_packet->arrival);
+        } else {
+            raop_rtp_handle_sync(raop_rtp, packet);
+        }
+    } else {
+        logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_udp unknown packet");
+    }
+}
+
+/**
+ * 等待csock,dsock可读或者有事件唤醒,timeout_ms < 0 表示一直等待
+ * epfd只在epoll模式下使用,返回RAOP_RTP_EVENT_*的组合,出错返回-1
+ */
+static int
+raop_rtp_wait(raop_rtp_t *raop_rtp, int epfd, int timeout_ms)
+{
+    int events = 0;
+#if defined(HAVE_EPOLL)
+    struct epoll_event ready[3];
+    int nfds;
+    if (raop_rtp->wakeup_rfd == -1 && (timeout_ms < 0 || timeout_ms > 5)) {
+        /* 没有唤醒fd,同样退化为5ms轮询 */
+        timeout_ms = 5;
+    }
+    nfds = epoll_wait(epfd, ready, 3, timeout_ms);
+    if (nfds == -1) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    for (int i = 0; i < nfds; i++) {
+        events |= ready[i].data.u32;
+    }
+#elif defined(HAVE_POLL)
+    struct pollfd pfds[3];
+    int n = 0;
+    pfds[n].fd = raop_rtp->csock;
+    pfds[n++].events = POLLIN;
+    pfds[n].fd = raop_rtp->dsock;
+    pfds[n++].events = POLLIN;
+    if (raop_rtp->wakeup_rfd != -1) {
+        pfds[n].fd = raop_rtp->wakeup_rfd;
+        pfds[n++].events = POLLIN;
+    } else if (timeout_ms < 0 || timeout_ms > 5) {
+        timeout_ms = 5;
+    }
+    int ret = poll(pfds, n, timeout_ms);
+    if (ret == -1) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    if (pfds[0].revents) events |= RAOP_RTP_EVENT_CONTROL;
+    if (pfds[1].revents) events |= RAOP_RTP_EVENT_DATA;
+    if (n == 3 && pfds[2].revents) events |= RAOP_RTP_EVENT_WAKEUP;
+#else
+    /* 没有可用的唤醒fd,退化为5ms轮询 */
+    fd_set rfds;
+    struct timeval tv;
+    int nfds, ret;
+    if (timeout_ms < 0 || timeout_ms > 5) {
+        timeout_ms = 5;
+    }
+    tv.tv_sec = 0;
+    tv.tv_usec = timeout_ms * 1000;
+
+    nfds = raop_rtp->csock+1;
+    if (raop_rtp->dsock >= nfds)
+        nfds = raop_rtp->dsock+1;
+    FD_ZERO(&rfds);
+    FD_SET(raop_rtp->csock, &rfds);
+    FD_SET(raop_rtp->dsock, &rfds);
+    ret = select(nfds, &rfds, NULL, NULL, &tv);
+    if (ret == -1) {
+        return -1;
+    }
+    if (FD_ISSET(raop_rtp->csock, &rfds)) events |= RAOP_RTP_EVENT_CONTROL;
+    if (FD_ISSET(raop_rtp->dsock, &rfds)) events |= RAOP_RTP_EVENT_DATA;
+#endif
+    if (raop_rtp->wakeup_rfd == -1) {
+        /* 没有唤醒fd时每次都检查事件 */
+        events |= RAOP_RTP_EVENT_WAKEUP;
+    }
+    return events;
+}
 
-        /* Get the correct nfds value */
-        nfds = raop_rtp->csock+1;
-        if (raop_rtp->dsock >= nfds)
-            nfds = raop_rtp->dsock+1;
+#if defined(HAVE_EPOLL)
+static int
+raop_rtp_create_epoll(raop_rtp_t *raop_rtp)
+{
+    struct epoll_event ev;
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd == -1) {
+        return -1;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = RAOP_RTP_EVENT_CONTROL;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, raop_rtp->csock, &ev) == -1) goto epoll_cleanup;
+    ev.data.u32 = RAOP_RTP_EVENT_DATA;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, raop_rtp->dsock, &ev) == -1) goto epoll_cleanup;
+    if (raop_rtp->wakeup_rfd != -1) {
+        ev.data.u32 = RAOP_RTP_EVENT_WAKEUP;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, raop_rtp->wakeup_rfd, &ev) == -1) goto epoll_cleanup;
+    }
+    return epfd;
 
-        /* Set rfds and call select */
-        FD_ZERO(&rfds);
-        FD_SET(raop_rtp->csock, &rfds);
-        FD_SET(raop_rtp->dsock, &rfds);
+    epoll_cleanup:
+    close(epfd);
+    return -1;
+}
+#endif
 
+static THREAD_RETVAL
+raop_rtp_thread_udp(void *arg)
+{
+    raop_rtp_t *raop_rtp = arg;
+    logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_udp");
+    assert(raop_rtp);
+    void *cb_data = raop_rtp->callbacks.audio_init(raop_rtp->callbacks.cls);
+    int epfd = -1;
+#if defined(HAVE_EPOLL)
+    epfd = raop_rtp_create_epoll(raop_rtp);
+    if (epfd == -1) {
+        logger_log(raop_rtp->logger, LOGGER_ERR, "raop_rtp_thread_udp epoll init failed");
+        raop_rtp->callbacks.audio_destroy(raop_rtp->callbacks.cls, cb_data);
+        return 0;
+    }
+#endif
+    raop_rtp->cb_data = cb_data;
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    if (raop_rtp->latency) {
+        raop_buffer_set_latency(raop_rtp->buffer, raop_rtp->latency);
+    }
+    ATOMIC_STORE_RELEASE(&raop_rtp->latency_changed, 0);
+    if (raop_rtp->conceal_method >= 0) {
+        raop_buffer_set_conceal_method(raop_rtp->buffer, raop_rtp->conceal_method);
+    }
+    pcm_gain_set_dither(raop_rtp->gain, raop_rtp->gain_mode == RAOP_AUDIO_GAIN_DITHER);
+    if (raop_rtp->pull && !raop_rtp->callbacks.audio_pull_init) {
+        logger_log(raop_rtp->logger, LOGGER_WARNING, "raop_rtp_thread_udp audio_pull_init not set, using audio_process");
+        raop_rtp->pull = 0;
+    }
+    unsigned int output_rate = raop_rtp->output_rate;
+    int format = raop_rtp->format, channels = raop_rtp->channels, planar = raop_rtp->planar;
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp->max_frame_len = RAOP_RTP_MAX_FRAME_LEN;
+    raop_rtp->pull_step = (uint64_t) 1 << 32;
+    raop_rtp->drift_time = 0;
+    raop_rtp->drift_count = 0;
+    raop_rtp->drift_integral = 0.0;
+    if (output_rate && output_rate != 44100) {
+        raop_rtp->resampler = pcm_resampler_init(44100, output_rate);
+        if (raop_rtp->resampler) {
+            raop_rtp->max_frame_len = 2 * pcm_resampler_max_output(raop_rtp->resampler, RAOP_RTP_MAX_FRAME_LEN / 2);
+            raop_rtp->resample_buf = malloc(raop_rtp->max_frame_len * sizeof(short));
+            raop_rtp->pull_step = (uint64_t) ((double) 44100 / output_rate * 4294967296.0 + 0.5);
+        }
+        if (!raop_rtp->resampler || !raop_rtp->resample_buf) {
+            logger_log(raop_rtp->logger, LOGGER_WARNING, "raop_rtp_thread_udp resampler init failed, output at 44100");
+            pcm_resampler_destroy(raop_rtp->resampler);
+            raop_rtp->resampler = NULL;
+            free(raop_rtp->resample_buf);
+            raop_rtp->resample_buf = NULL;
+            raop_rtp->max_frame_len = RAOP_RTP_MAX_FRAME_LEN;
+            raop_rtp->pull_step = (uint64_t) 1 << 32;
+        }
+    }
+    raop_rtp->frame_bytes = 2 * sizeof(short);
+    raop_rtp->convert = pcm_convert_init(format, channels, planar);
+    if (raop_rtp->convert && !pcm_convert_is_identity(raop_rtp->convert)) {
+        raop_rtp->frame_bytes = pcm_convert_frame_bytes(raop_rtp->convert);
+        raop_rtp->convert_buf = malloc(raop_rtp->max_frame_len / 2 * raop_rtp->frame_bytes);
+    }
+    if (!raop_rtp->convert || pcm_convert_is_identity(raop_rtp->convert) || !raop_rtp->convert_buf) {
+        if (!raop_rtp->convert || !pcm_convert_is_identity(raop_rtp->convert)) {
+            logger_log(raop_rtp->logger, LOGGER_WARNING, "raop_rtp_thread_udp format %d/%d/%d not available, using s16 stereo",
+                       format, channels, planar);
+        }
+        pcm_convert_destroy(raop_rtp->convert);
+        raop_rtp->convert = NULL;
+        free(raop_rtp->convert_buf);
+        raop_rtp->convert_buf = NULL;
+        raop_rtp->frame_bytes = 2 * sizeof(short);
+        format = PCM_FORMAT_S16;
+        channels = 2;
+        planar = 0;
+    }
+    raop_rtp->format = format;
+    raop_rtp->channels = channels;
+    raop_rtp->planar = channels == 2 && planar;
+    if (!raop_rtp->pull && raop_rtp->callbacks.audio_process_batch) {
+        if (raop_rtp->batch_frames > RAOP_RTP_MAX_BATCH_FRAMES) {
+            raop_rtp->batch_frames = RAOP_RTP_MAX_BATCH_FRAMES;
+        }
+        raop_rtp->batch_count = 0;
+        raop_rtp->batch_samples = 0;
+        raop_rtp->batch_data = malloc(RAOP_RTP_MAX_BATCH_FRAMES * (raop_rtp->max_frame_len / 2) * raop_rtp->frame_bytes);
+        raop_rtp->batch_pts = malloc(RAOP_RTP_MAX_BATCH_FRAMES * sizeof(uint64_t));
+        raop_rtp->batch_lens = malloc(RAOP_RTP_MAX_BATCH_FRAMES * sizeof(int));
+        if (!raop_rtp->batch_data || !raop_rtp->batch_pts || !raop_rtp->batch_lens) {
+            logger_log(raop_rtp->logger, LOGGER_WARNING, "raop_rtp_thread_udp batch buffer alloc failed, using audio_process");
+            free(raop_rtp->batch_data);
+            free(raop_rtp->batch_pts);
+            free(raop_rtp->batch_lens);
+            raop_rtp->batch_data = NULL;
+            raop_rtp->batch_pts = NULL;
+            raop_rtp->batch_lens = NULL;
+        }
+    }
+    raop_rtp->silence_samples = 0;
+    raop_rtp->jitter_valid = 0;
+    raop_rtp->jitter = 0;
+    MUTEX_LOCK(raop_rtp->stats_mutex);
+    raop_rtp->playout_delay = 0;
+    MUTEX_UNLOCK(raop_rtp->stats_mutex);
+    raop_rtp_lock_buffer(raop_rtp);
+    rtp_clock_reset(raop_rtp->clock);
+    raop_rtp_unlock_buffer(raop_rtp);
+    if (!raop_rtp->pull && !raop_rtp->batch_data) {
+        /* 需要转换格式时每帧后面再留出转换结果的空间 */
+        int convert_len = raop_rtp->convert ? (raop_rtp->max_frame_len / 2 * raop_rtp->frame_bytes + 1) / 2 : 0;
+        raop_rtp->pcm_pool = pcm_pool_init(raop_rtp->max_frame_len + convert_len, RAOP_RTP_PCM_POOL_SIZE);
+        if (!raop_rtp->pcm_pool) {
+            logger_log(raop_rtp->logger, LOGGER_WARNING, "raop_rtp_thread_udp pcm pool init failed");
+        }
+    }
+    if (raop_rtp->pull) {
+        raop_rtp->pull_started = 0;
+        raop_rtp->pull_data = NULL;
+        raop_rtp->pull_samples = 0;
+        /* 读取方需要连续的数据,不做静音检测 */
+        raop_rtp->silence_mode = RAOP_AUDIO_SILENCE_OFF;
+        raop_rtp->callbacks.audio_pull_init(raop_rtp->callbacks.cls, cb_data, raop_rtp);
+    } else if (raop_rtp->pipeline) {
+        raop_rtp->ring = packet_ring_init(RAOP_RTP_RING_SIZE, RAOP_RTP_SLOT_LEN);
+        raop_rtp->ring_flush = NO_FLUSH;
+        if (raop_rtp->ring) {
+            raop_rtp->decoder_running = 1;
+            THREAD_CREATE(raop_rtp->decoder_thread, raop_rtp_thread_decoder, raop_rtp);
+        } else {
+            logger_log(raop_rtp->logger, LOGGER_WARNING, "raop_rtp_thread_udp ring init failed, decoding in receive thread");
+        }
+    }
+    if (raop_rtp->callbacks.audio_session_init) {
+        raop_rtp->callbacks.audio_session_init(raop_rtp->callbacks.cls, cb_data, raop_rtp);
+    }
+    /* 启动时先处理一次已经设置的事件 */
+    int events = RAOP_RTP_EVENT_WAKEUP;
+    timeutils_update_cached_us();
+    while(1) {
+        if (events & RAOP_RTP_EVENT_WAKEUP) {
+            if (raop_rtp->wakeup_rfd != -1) {
+                raop_rtp_drain_wakeup(raop_rtp);
+            }
+            /* Check if we are still running and process callbacks */
+            if (raop_rtp_process_events(raop_rtp, cb_data)) {
+                break;
+            }
+        }
 
-        ret = select(nfds, &rfds, NULL, NULL, &tv);
-        if (ret == 0) {
-            /* Timeout happened */
-            continue;
-        } else if (ret == -1) {
+        /* 没有数据和事件时休眠到下一帧的播放时间 */
+        if (raop_rtp->ring) {
+            /* 有挂起的flush时每5ms重试一次,等解码线程腾出位置 */
+            raop_rtp_push_pending_flush(raop_rtp);
+            events = raop_rtp_wait(raop_rtp, epfd, raop_rtp->ring_flush != NO_FLUSH ? 5 : -1);
+        } else {
+            events = raop_rtp_wait(raop_rtp, epfd, raop_rtp_buffer_timeout(raop_rtp));
+        }
+        if (events == -1) {
             /* FIXME: Error happened */
             break;
         }
+        /* 这一轮收到的包共用一个到达时间 */
+        timeutils_update_cached_us();
 
-        if (FD_ISSET(raop_rtp->csock, &rfds)) {
-           saddrlen = sizeof(saddr);
-           packetlen = recvfrom(raop_rtp->csock, (char *)packet, sizeof(packet), 0,
-                                (struct sockaddr *)&saddr, &saddrlen);
-
-            memcpy(&raop_rtp->control_saddr, &saddr, saddrlen);
-            raop_rtp->control_saddr_len = saddrlen;
-            int type_c = packet[1] & ~0x80;
-            logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_udp type_c 0x%02x, packetlen = %d", type_c, packetlen);
-            if (type_c == 0x56) {
-                /* 处理重传的包，去除头部4个字节 */
-                int ret = raop_buffer_queue(raop_rtp->buffer, packet+4, packetlen-4, &raop_rtp->callbacks);
-                assert(ret >= 0);
-            } else if (type_c == 0x54) {
-                /**
-                 * packetlen = 20
-                 * bytes	description
-                    8	RTP header without SSRC
-                    8	current NTP time
-                    4	RTP timestamp for the next audio packet
-                 */
-                uint64_t ntp_time = byteutils_read_timeStamp(packet, 8);
-                unsigned int rtp_timestamp = (packet[4] << 24) | (packet[5] << 16) |
-                        (packet[6] << 8) | packet[7];
-                unsigned int next_timestamp = (packet[16] << 24) | (packet[17] << 16) |
-                        (packet[18] << 8) | packet[19];
-                //logger_log(raop_rtp->logger, LOGGER_DEBUG, "rtp audio ntp time = %llu", ntp_time);
-                //logger_log(raop_rtp->logger, LOGGER_DEBUG, "rtp audio rtp_timestamp = %u", rtp_timestamp);
-                //logger_log(raop_rtp->logger, LOGGER_DEBUG, "rtp audio next_timestamp = %u", next_timestamp);
-                /* ntp_time和rtp_timestamp 用于音画同步 */
-                raop_rtp->sync_time = ntp_time - OFFSET_1900_TO_1970 * 1000000;
-                raop_rtp->sync_timestamp = rtp_timestamp;
-            } else {
-                logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_udp unknown packet");
+        if (events & RAOP_RTP_EVENT_CONTROL) {
+            int count = raop_rtp_recv_batch(raop_rtp, raop_rtp->csock);
+            for (int i = 0; i < count; i++) {
+                raop_rtp_handle_control(raop_rtp, &raop_rtp->packets[i]);
             }
         }
-        if (FD_ISSET(raop_rtp->dsock, &rfds)) {
-            // logger_log(raop_rtp->logger, LOGGER_INFO, "Would have data packet in queue");
-            /* 这里接收音频数据 */
-            saddrlen = sizeof(saddr);
-            packetlen = recvfrom(raop_rtp->dsock, (char *)packet, sizeof(packet), 0,
-                                 (struct sockaddr *)&saddr, &saddrlen);
-            /* rtp payload type */
-            int type_d = packet[1] & ~0x80;
-            // logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_udp type_d 0x%02x, packetlen = %d", type_d, packetlen);
-
-            /* 出现len=16 如果没有发时间的话 */
-            if (packetlen >= 12) {
-                int no_resend = (raop_rtp->control_rport == 0);/* false */
-                int buf_ret;
-                const void *audiobuf;
-                int audiobuflen;
-                unsigned int timestamp;
-                buf_ret = raop_buffer_queue(raop_rtp->buffer, packet, packetlen, &raop_rtp->callbacks);
-                assert(buf_ret >= 0);
-                /* Decode all frames in queue */
-                while ((audiobuf = raop_buffer_dequeue(raop_rtp->buffer, &audiobuflen, &timestamp, no_resend))) {
-                    pcm_data_struct pcm_data;
-                    //modified by huanggang 20190617
-                    pcm_data.data_len = audiobuflen;//960;
-                    //end modify
-                    pcm_data.data = audiobuf;
-                    /* 根据sync_time和sync_timestamp计算timestamp对应的pts */
-                    pcm_data.pts = (uint64_t) (timestamp - raop_rtp->sync_timestamp) * 1000000 / 44100 + raop_rtp->sync_time;
-                    raop_rtp->callbacks.audio_process(raop_rtp->callbacks.cls, cb_data, &pcm_data);
+        if (events & RAOP_RTP_EVENT_DATA) {
+            /* 这里接收音频数据,一次收取一批 */
+            int count = raop_rtp_recv_batch(raop_rtp, raop_rtp->dsock);
+            for (int i = 0; i < count; i++) {
+                raop_rtp_packet_t *packet = &raop_rtp->packets[i];
+                /* 出现len=16 如果没有发时间的话 */
+                if (packet->len < 12) {
+                    continue;
                 }
-                /* Handle possible resend requests */
-                if (!no_resend) {
-                    raop_buffer_handle_resends(raop_rtp->buffer, raop_rtp_resend_callback, raop_rtp);
+                raop_rtp_update_jitter(raop_rtp, packet->data, packet->arrival);
+                if (raop_rtp->ring) {
+                    raop_rtp_ring_push(raop_rtp, RAOP_RTP_RING_DATA, 0, packet->data, packet->len, packet->arrival);
+                } else {
+                    raop_rtp_queue_audio(raop_rtp, packet->data, packet->len, packet->arrival);
                 }
             }
-
+            if (count > 0) {
+                MUTEX_LOCK(raop_rtp->stats_mutex);
+                raop_rtp->stats.jitter_us = raop_rtp->jitter >> 4;
+                MUTEX_UNLOCK(raop_rtp->stats_mutex);
+            }
+        }
+        if (!raop_rtp->ring) {
+            raop_rtp_process_audio(raop_rtp, cb_data);
         }
+        if (raop_rtp->ring && (events & (RAOP_RTP_EVENT_CONTROL | RAOP_RTP_EVENT_DATA))) {
+            /* 数据,重传和同步包都需要通知解码线程 */
+            raop_rtp_signal_decoder(raop_rtp);
+        }
+    }
+    if (raop_rtp->ring) {
+        /* 解码线程使用cb_data,必须在audio_destroy之前退出 */
+        MUTEX_LOCK(raop_rtp->decoder_mutex);
+        raop_rtp->decoder_running = 0;
+        COND_SIGNAL(raop_rtp->decoder_cond);
+        MUTEX_UNLOCK(raop_rtp->decoder_mutex);
+        THREAD_JOIN(raop_rtp->decoder_thread);
+        packet_ring_destroy(raop_rtp->ring);
+        raop_rtp->ring = NULL;
     }
+#if defined(HAVE_EPOLL)
+    close(epfd);
+#endif
+    /* 解码线程已经退出,结束时攒着的帧和还在进行的静音也要回调 */
+    if (raop_rtp->batch_data) {
+        raop_rtp_deliver_batch(raop_rtp, cb_data);
+    }
+    raop_rtp_end_silence(raop_rtp, cb_data);
+    free(raop_rtp->batch_data);
+    free(raop_rtp->batch_pts);
+    free(raop_rtp->batch_lens);
+    raop_rtp->batch_data = NULL;
+    raop_rtp->batch_pts = NULL;
+    raop_rtp->batch_lens = NULL;
+    /* 应用还持有的帧在最后一次release时释放 */
+    pcm_pool_destroy(raop_rtp->pcm_pool);
+    raop_rtp->pcm_pool = NULL;
+    raop_rtp_lock_buffer(raop_rtp);
+    pcm_resampler_destroy(raop_rtp->resampler);
+    raop_rtp->resampler = NULL;
+    free(raop_rtp->resample_buf);
+    raop_rtp->resample_buf = NULL;
+    pcm_convert_destroy(raop_rtp->convert);
+    raop_rtp->convert = NULL;
+    free(raop_rtp->convert_buf);
+    raop_rtp->convert_buf = NULL;
+    raop_rtp_unlock_buffer(raop_rtp);
     logger_log(raop_rtp->logger, LOGGER_INFO, "Exiting UDP raop_rtp_thread_udp thread");
     raop_rtp->callbacks.audio_destroy(raop_rtp->callbacks.cls, cb_data);
     return 0;
 }
 
-/* 启动rtp服务,三个udp端口 */
+/* 启动rtp服务,control和data两个udp端口,timing端口由时钟同步服务提供 */
 void
 raop_rtp_start_audio(raop_rtp_t *raop_rtp, int use_udp, unsigned short control_rport,
-                     unsigned short *control_lport, unsigned short *timing_lport, unsigned short *data_lport)
+                     unsigned short *control_lport, unsigned short *data_lport)
 {
     logger_log(raop_rtp->logger, LOGGER_INFO, "raop_rtp_start_audio");
-    int use_ipv6 = 0;
 
     assert(raop_rtp);
 
@@ -578,24 +1858,19 @@ raop_rtp_start_audio(raop_rtp_t *raop_rtp, int use_udp, unsigned short control_r
 
     /* Initialize ports and sockets */
     raop_rtp->control_rport = control_rport;
-    if (raop_rtp->remote_saddr.ss_family == AF_INET6) {
-        use_ipv6 = 1;
-    }
-    use_ipv6 = 0;
-    if (raop_rtp_init_sockets(raop_rtp, use_ipv6, use_udp) < 0) {
+    /* 端口从会话资源池中取,都是ipv4 socket */
+    if (raop_rtp_init_sockets(raop_rtp, use_udp) < 0) {
         logger_log(raop_rtp->logger, LOGGER_INFO, "Initializing sockets failed");
         MUTEX_UNLOCK(raop_rtp->run_mutex);
         return;
     }
     if (control_lport) *control_lport = raop_rtp->control_lport;
-    if (timing_lport) *timing_lport = raop_rtp->timing_lport;
     if (data_lport) *data_lport = raop_rtp->data_lport;
     /* Create the thread and initialize running values */
     raop_rtp->running = 1;
     raop_rtp->joined = 0;
 
     THREAD_CREATE(raop_rtp->thread, raop_rtp_thread_udp, raop_rtp);
-    //THREAD_CREATE(raop_rtp->thread_time, raop_rtp_thread_time, raop_rtp);
     MUTEX_UNLOCK(raop_rtp->run_mutex);
 }
 
@@ -610,6 +1885,239 @@ raop_rtp_is_running(raop_rtp_t *raop_rtp)
     return running;
 }
 
+void
+raop_rtp_set_pipeline(raop_rtp_t *raop_rtp, int enabled)
+{
+    assert(raop_rtp);
+
+    /* 只在下次启动时生效 */
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    raop_rtp->pipeline = enabled;
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+}
+
+void
+raop_rtp_set_latency(raop_rtp_t *raop_rtp, unsigned int latency_ms)
+{
+    assert(raop_rtp);
+
+    /* 运行中修改时由处理线程在下次出队前设置到buffer */
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    raop_rtp->latency = latency_ms;
+    ATOMIC_STORE_RELEASE(&raop_rtp->latency_changed, 1);
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+    /* 没有ring时出队在接收线程,唤醒后不用等下一个包;有ring时解码线程在下一轮生效 */
+    raop_rtp_wakeup(raop_rtp);
+}
+
+void
+raop_rtp_set_conceal_method(raop_rtp_t *raop_rtp, int method)
+{
+    assert(raop_rtp);
+
+    /* 只在下次启动时生效 */
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    raop_rtp->conceal_method = method;
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+}
+
+void
+raop_rtp_set_pull(raop_rtp_t *raop_rtp, int enabled)
+{
+    assert(raop_rtp);
+
+    /* 只在下次启动时生效 */
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    raop_rtp->pull = enabled;
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+}
+
+/* 读出count个输出采样后推进pull_timestamp */
+static void
+raop_rtp_pull_advance(raop_rtp_t *raop_rtp, int count)
+{
+    uint64_t total = (uint64_t) count * raop_rtp->pull_step + raop_rtp->pull_frac;
+    raop_rtp->pull_timestamp += (unsigned int) (total >> 32);
+    raop_rtp->pull_frac = (uint32_t) total;
+}
+
+/**
+ * pull模式下由应用的输出设备回调调用,每次正好返回frames帧.
+ * 开始和缓冲读空之后先等第一帧到播放时间,之后由读取的节奏推进,缺包时做丢包补偿
+ */
+int
+raop_rtp_read(raop_rtp_t *raop_rtp, void *pcm, int frames, uint64_t *pts)
+{
+    int filled = 0;
+    int delivered = 0;
+    unsigned int first_timestamp = 0;
+
+    assert(raop_rtp);
+    assert(pcm);
+
+    if (!raop_rtp->pull || frames <= 0) {
+        return -1;
+    }
+    MUTEX_LOCK(raop_rtp->buffer_mutex);
+    while (filled < frames) {
+        int count;
+        if (raop_rtp->pull_samples == 0) {
+            const void *audiobuf;
+            int audiobuflen;
+            unsigned int timestamp;
+            uint64_t now = raop_rtp->pull_started ? UINT64_MAX : timeutils_monotonic_us();
+            audiobuf = raop_buffer_dequeue(raop_rtp->buffer, now, NULL, &audiobuflen, &timestamp);
+            if (!audiobuf) {
+                /* 缓冲读空了,剩下的用静音补齐,重新等待预缓冲 */
+                raop_rtp->pull_started = 0;
+                raop_rtp_reset_resampler(raop_rtp);
+                if (raop_rtp->convert) {
+                    pcm_convert_silence(raop_rtp->convert, pcm, filled, frames - filled, frames);
+                } else {
+                    memset((short *) pcm + filled * 2, 0, (frames - filled) * 2 * sizeof(short));
+                }
+                if (filled == 0) {
+                    first_timestamp = raop_rtp->pull_timestamp;
+                }
+                raop_rtp_pull_advance(raop_rtp, frames - filled);
+                break;
+            }
+            raop_rtp->pull_started = 1;
+            if (raop_rtp->resampler) {
+                raop_rtp_update_pull_drift(raop_rtp, timestamp);
+                audiobuf = raop_rtp_resample(raop_rtp, audiobuf, &audiobuflen, &timestamp, raop_rtp->resample_buf);
+            }
+            /* 每帧按自己的时间戳重新对齐,转换比例的微调不会累积成pts的误差 */
+            raop_rtp->pull_timestamp = timestamp;
+            raop_rtp->pull_frac = 0;
+            if (raop_rtp->gain_mode != RAOP_AUDIO_GAIN_OFF) {
+                pcm_gain_apply(raop_rtp->gain, (short *) audiobuf, audiobuflen / sizeof(short));
+            }
+            raop_rtp->pull_data = audiobuf;
+            raop_rtp->pull_samples = audiobuflen / sizeof(short);
+            delivered++;
+        }
+        count = raop_rtp->pull_samples / 2;
+        if (count > frames - filled) {
+            count = frames - filled;
+        }
+        if (filled == 0) {
+            first_timestamp = raop_rtp->pull_timestamp;
+        }
+        raop_rtp_convert(raop_rtp, raop_rtp->pull_data, count, pcm, filled, frames);
+        raop_rtp->pull_data += count * 2;
+        raop_rtp->pull_samples -= count * 2;
+        raop_rtp_pull_advance(raop_rtp, count);
+        filled += count;
+    }
+    if (pts) {
+        *pts = raop_rtp_timestamp_to_pts(raop_rtp, first_timestamp);
+    }
+    MUTEX_UNLOCK(raop_rtp->buffer_mutex);
+
+    if (delivered) {
+        MUTEX_LOCK(raop_rtp->stats_mutex);
+        raop_rtp->stats.frames += delivered;
+        MUTEX_UNLOCK(raop_rtp->stats_mutex);
+    }
+    return frames;
+}
+
+void
+raop_rtp_set_batch_frames(raop_rtp_t *raop_rtp, unsigned int frames)
+{
+    assert(raop_rtp);
+
+    /* 只在下次启动时生效 */
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    raop_rtp->batch_frames = frames;
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+}
+
+void
+raop_rtp_set_output_rate(raop_rtp_t *raop_rtp, unsigned int rate)
+{
+    assert(raop_rtp);
+
+    /* 只在下次启动时生效 */
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    raop_rtp->output_rate = rate;
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+}
+
+void
+raop_rtp_set_format(raop_rtp_t *raop_rtp, int format, int channels, int planar)
+{
+    assert(raop_rtp);
+
+    /* 只在下次启动时生效 */
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    raop_rtp->format = format;
+    raop_rtp->channels = channels;
+    raop_rtp->planar = planar;
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+}
+
+void
+raop_rtp_set_gain(raop_rtp_t *raop_rtp, int mode)
+{
+    assert(raop_rtp);
+
+    /* 只在下次启动时生效 */
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    raop_rtp->gain_mode = mode;
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+}
+
+void
+raop_rtp_set_silence(raop_rtp_t *raop_rtp, int mode, int threshold)
+{
+    assert(raop_rtp);
+
+    /* 只在下次启动时生效 */
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    raop_rtp->silence_mode = mode;
+    raop_rtp->silence_threshold = threshold;
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+}
+
+/**
+ * 从收到包到输出pcm的延迟,单位是44100Hz的采样数
+ * 包括buffer的目标延迟和抖动余量,解码延迟,以及批量回调时攒帧的时间
+ */
+unsigned int
+raop_rtp_get_latency(raop_rtp_t *raop_rtp)
+{
+    unsigned int latency_ms;
+    unsigned int playout_delay;
+    unsigned int samples;
+
+    assert(raop_rtp);
+
+    MUTEX_LOCK(raop_rtp->stats_mutex);
+    playout_delay = raop_rtp->playout_delay;
+    MUTEX_UNLOCK(raop_rtp->stats_mutex);
+
+    MUTEX_LOCK(raop_rtp->run_mutex);
+    if (playout_delay == 0) {
+        /* 处理线程还没有运行,使用设置的目标延迟 */
+        latency_ms = raop_rtp->latency ? raop_rtp->latency : RAOP_BUFFER_DEFAULT_LATENCY;
+        if (latency_ms > RAOP_BUFFER_MAX_LATENCY) {
+            latency_ms = RAOP_BUFFER_MAX_LATENCY;
+        }
+        playout_delay = latency_ms * 1000;
+    }
+    samples = (unsigned int) ((uint64_t) playout_delay * 44100 / 1000000) + RAOP_RTP_DECODER_DELAY;
+    if (raop_rtp->conceal_method == RAOP_RTP_CONCEAL_INTERPOLATION) {
+        samples += RAOP_RTP_DECODER_DELAY;
+    }
+    if (!raop_rtp->pull && raop_rtp->callbacks.audio_process_batch) {
+        samples += raop_rtp_batch_hold(raop_rtp->batch_frames);
+    }
+    MUTEX_UNLOCK(raop_rtp->run_mutex);
+    return samples;
+}
+
 void
 raop_rtp_set_volume(raop_rtp_t *raop_rtp, float volume)
 {
@@ -621,11 +2129,13 @@ raop_rtp_set_volume(raop_rtp_t *raop_rtp, float volume)
         volume = -144.0f;
     }
 
-    /* Set volume in thread instead */
+    /* 增益直接更新,下一帧开始过渡,回调在线程中进行 */
+    pcm_gain_set_volume(raop_rtp->gain, volume);
     MUTEX_LOCK(raop_rtp->run_mutex);
     raop_rtp->volume = volume;
     raop_rtp->volume_changed = 1;
     MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp_wakeup(raop_rtp);
 }
 
 void
@@ -647,6 +2157,7 @@ raop_rtp_set_metadata(raop_rtp_t *raop_rtp, const char *data, int datalen)
     raop_rtp->metadata = metadata;
     raop_rtp->metadata_len = datalen;
     MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp_wakeup(raop_rtp);
 }
 
 void
@@ -668,6 +2179,7 @@ raop_rtp_set_coverart(raop_rtp_t *raop_rtp, const char *data, int datalen)
     raop_rtp->coverart = coverart;
     raop_rtp->coverart_len = datalen;
     MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp_wakeup(raop_rtp);
 }
 
 void
@@ -684,6 +2196,7 @@ raop_rtp_remote_control_id(raop_rtp_t *raop_rtp, const char *dacp_id, const char
     raop_rtp->dacp_id = strdup(dacp_id);
     raop_rtp->active_remote_header = strdup(active_remote_header);
     MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp_wakeup(raop_rtp);
 }
 
 void
@@ -698,6 +2211,7 @@ raop_rtp_set_progress(raop_rtp_t *raop_rtp, unsigned int start, unsigned int cur
     raop_rtp->progress_end = end;
     raop_rtp->progress_changed = 1;
     MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp_wakeup(raop_rtp);
 }
 
 void
@@ -709,6 +2223,7 @@ raop_rtp_flush(raop_rtp_t *raop_rtp, int next_seq)
     MUTEX_LOCK(raop_rtp->run_mutex);
     raop_rtp->flush = next_seq;
     MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp_wakeup(raop_rtp);
 }
 
 void
@@ -725,22 +2240,18 @@ raop_rtp_stop(raop_rtp_t *raop_rtp)
     }
     raop_rtp->running = 0;
     MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp_wakeup(raop_rtp);
 
     /* Join the thread */
     THREAD_JOIN(raop_rtp->thread);
 
-    //MUTEX_LOCK(raop_rtp->time_mutex);
-    //COND_SIGNAL(raop_rtp->time_cond);
-    //MUTEX_UNLOCK(raop_rtp->time_mutex);
-
-    //THREAD_JOIN(raop_rtp->thread_time);
-    
     if (raop_rtp->csock != -1) closesocket(raop_rtp->csock);
-    if (raop_rtp->tsock != -1) closesocket(raop_rtp->tsock);
     if (raop_rtp->dsock != -1) closesocket(raop_rtp->dsock);
 
     /* Flush buffer into initial state */
+    raop_rtp_lock_buffer(raop_rtp);
     raop_buffer_flush(raop_rtp->buffer, -1);
+    raop_rtp_unlock_buffer(raop_rtp);
 
     /* Mark thread as joined */
     MUTEX_LOCK(raop_rtp->run_mutex);
@@ -18,6 +18,8 @@
 /* For raop_callbacks_t */
 #include "raop.h"
 #include "logger.h"
+#include "raop_ntp.h"
+#include "raop_pool.h"
 
 #define RAOP_AESIV_LEN  16
 #define RAOP_AESKEY_LEN 16
@@ -29,12 +31,24 @@ typedef struct raop_rtp_s raop_rtp_t;
 typedef struct h264codec_s h264codec_t;
 
 
-raop_rtp_t *raop_rtp_init(logger_t *logger, raop_callbacks_t *callbacks, const unsigned char *remote, int remotelen,
-                           const unsigned char *aeskey, const unsigned char *aesiv, const unsigned char *ecdh_secret, unsigned short timing_rport);
+/* jitter buffer和socket从pool中取用,destroy时放回 */
+raop_rtp_t *raop_rtp_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp, raop_pool_t *pool, const unsigned char *remote, int remotelen,
+                           const unsigned char *aeskey, const unsigned char *aesiv, const unsigned char *ecdh_secret);
 
 void raop_rtp_start_audio(raop_rtp_t *raop_rtp, int use_udp, unsigned short control_rport,
-                     unsigned short *control_lport, unsigned short *timing_lport, unsigned short *data_lport);
+                     unsigned short *control_lport, unsigned short *data_lport);
 int raop_rtp_is_running(raop_rtp_t *raop_rtp);
+void raop_rtp_set_pipeline(raop_rtp_t *raop_rtp, int enabled);
+void raop_rtp_set_latency(raop_rtp_t *raop_rtp, unsigned int latency_ms);
+void raop_rtp_set_conceal_method(raop_rtp_t *raop_rtp, int method);
+void raop_rtp_set_pull(raop_rtp_t *raop_rtp, int enabled);
+void raop_rtp_set_batch_frames(raop_rtp_t *raop_rtp, unsigned int frames);
+void raop_rtp_set_silence(raop_rtp_t *raop_rtp, int mode, int threshold);
+void raop_rtp_set_gain(raop_rtp_t *raop_rtp, int mode);
+void raop_rtp_set_output_rate(raop_rtp_t *raop_rtp, unsigned int rate);
+void raop_rtp_set_format(raop_rtp_t *raop_rtp, int format, int channels, int planar);
+unsigned int raop_rtp_get_latency(raop_rtp_t *raop_rtp);
+int raop_rtp_read(raop_rtp_t *raop_rtp, void *pcm, int frames, uint64_t *pts);
 void raop_rtp_set_volume(raop_rtp_t *raop_rtp, float volume);
 void raop_rtp_set_metadata(raop_rtp_t *raop_rtp, const char *data, int datalen);
 void raop_rtp_set_coverart(raop_rtp_t *raop_rtp, const char *data, int datalen);
@@ -25,8 +25,10 @@
 #include "compat.h"
 #include "logger.h"
 #include "byteutils.h"
+#include "timeutils.h"
 #include "mirror_buffer.h"
 #include "stream.h"
+#include "raop_ntp.h"
 
 
 struct h264codec_s {
@@ -51,6 +53,10 @@ struct raop_rtp_mirror_s {
     mirror_buffer_t *buffer;
 
     raop_rtp_mirror_t *mirror;
+    /* 发送端的时钟同步服务,视频pts由它换算到本地时钟 */
+    raop_ntp_t *ntp;
+    /* 会话资源池,提供绑定好端口的socket */
+    raop_pool_t *pool;
     /* Remote address as sockaddr */
     struct sockaddr_storage remote_saddr;
     socklen_t remote_saddr_len;
@@ -62,18 +68,11 @@ struct raop_rtp_mirror_s {
 
     int flush;
     thread_handle_t thread_mirror;
-    thread_handle_t thread_time;
     mutex_handle_t run_mutex;
-
-    mutex_handle_t time_mutex;
-    cond_handle_t time_cond;
     /* MUTEX LOCKED VARIABLES END */
-    int mirror_data_sock, mirror_time_sock;
+    int mirror_data_sock;
 
     unsigned short mirror_data_lport;
-    // client ntp port
-    unsigned short mirror_timing_rport;
-    unsigned short mirror_timing_lport;
 };
 
 static int
@@ -104,20 +103,23 @@ raop_rtp_parse_remote(raop_rtp_mirror_t *raop_rtp_mirror, const unsigned char *r
 }
 
 #define NO_FLUSH (-42)
-raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, const unsigned char *remote, int remotelen,
-                                        const unsigned char *aeskey, const unsigned char *ecdh_secret, unsigned short timing_rport)
+raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp, raop_pool_t *pool, const unsigned char *remote, int remotelen,
+                                        const unsigned char *aeskey, const unsigned char *ecdh_secret)
 {
     raop_rtp_mirror_t *raop_rtp_mirror;
 
     assert(logger);
     assert(callbacks);
+    assert(ntp);
+    assert(pool);
 
     raop_rtp_mirror = calloc(1, sizeof(raop_rtp_mirror_t));
     if (!raop_rtp_mirror) {
         return NULL;
     }
     raop_rtp_mirror->logger = logger;
-    raop_rtp_mirror->mirror_timing_rport = timing_rport;
+    raop_rtp_mirror->ntp = ntp;
+    raop_rtp_mirror->pool = pool;
 
     memcpy(&raop_rtp_mirror->callbacks, callbacks, sizeof(raop_callbacks_t));
     raop_rtp_mirror->buffer = mirror_buffer_init(logger, aeskey, ecdh_secret);
@@ -134,8 +136,6 @@ raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *call
     raop_rtp_mirror->flush = NO_FLUSH;
 
     MUTEX_CREATE(raop_rtp_mirror->run_mutex);
-    MUTEX_CREATE(raop_rtp_mirror->time_mutex);
-    COND_CREATE(raop_rtp_mirror->time_cond);
     return raop_rtp_mirror;
 }
 
@@ -145,80 +145,6 @@ raop_rtp_init_mirror_aes(raop_rtp_mirror_t *raop_rtp_mirror, uint64_t streamConn
     mirror_buffer_init_aes(raop_rtp_mirror->buffer, streamConnectionID);
 }
 
-/**
- * ntp
- */
-static THREAD_RETVAL
-raop_rtp_mirror_thread_time(void *arg)
-{
-    raop_rtp_mirror_t *raop_rtp_mirror = arg;
-    assert(raop_rtp_mirror);
-    struct sockaddr_storage saddr;
-    socklen_t saddrlen;
-    unsigned char packet[128];
-    unsigned int packetlen;
-    int first = 0;
-    unsigned char time[48]={35,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-    uint64_t base = now_us();
-    uint64_t rec_pts = 0;
-    while (1) {
-        MUTEX_LOCK(raop_rtp_mirror->run_mutex);
-        if (!raop_rtp_mirror->running) {
-            MUTEX_UNLOCK(raop_rtp_mirror->run_mutex);
-            break;
-        }
-        MUTEX_UNLOCK(raop_rtp_mirror->run_mutex);
-        uint64_t send_time = now_us() - base + rec_pts;
-
-        byteutils_put_timeStamp(time, 40, send_time);
-        logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "raop_rtp_mirror_thread_time send time 48 bytes, port = %d", raop_rtp_mirror->mirror_timing_rport);
-        struct sockaddr_in *addr = (struct sockaddr_in *)&raop_rtp_mirror->remote_saddr;
-        addr->sin_port = htons(raop_rtp_mirror->mirror_timing_rport);
-        int sendlen = sendto(raop_rtp_mirror->mirror_time_sock, (char *)time, sizeof(time), 0, (struct sockaddr *) &raop_rtp_mirror->remote_saddr, raop_rtp_mirror->remote_saddr_len);
-        logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "raop_rtp_mirror_thread_time sendlen = %d", sendlen);
-
-        saddrlen = sizeof(saddr);
-        packetlen = recvfrom(raop_rtp_mirror->mirror_time_sock, (char *)packet, sizeof(packet), 0,
-                             (struct sockaddr *)&saddr, &saddrlen);
-        logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "raop_rtp_mirror_thread_time receive time packetlen = %d", packetlen);
-        /* 16-24 系统时钟最后一次被设定或更新的时间。 */
-        uint64_t Reference_Timestamp = byteutils_read_timeStamp(packet, 16);
-        /* 24-32 NTP请求报文离开发送端时发送端的本地时间。  T1 */
-        uint64_t Origin_Timestamp = byteutils_read_timeStamp(packet, 24);
-        /* 32-40 NTP请求报文到达接收端时接收端的本地时间。 T2 */
-        uint64_t Receive_Timestamp = byteutils_read_timeStamp(packet, 32);
-        /* 40-48 Transmit Timestamp：应答报文离开应答者时应答者的本地时间。 T3 */
-        uint64_t Transmit_Timestamp = byteutils_read_timeStamp(packet, 40);
-        /* FIXME: 先简单这样写吧 */
-        rec_pts = Transmit_Timestamp;
-        //logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "raop_rtp_mirror_thread_time Transmit_Timestamp = %llu", Transmit_Timestamp);
-        if (first == 0) {
-            first++;
-        } else {
-
-#ifdef _WIN32
-            MUTEX_LOCK(raop_rtp_mirror->time_mutex);
-            //modified by huanggang 20190617
-            WaitForSingleObject(raop_rtp_mirror->time_cond, 3000);
-            //end modify
-            MUTEX_UNLOCK(raop_rtp_mirror->time_mutex);
-#else
-            struct timeval now;
-            struct timespec outtime;
-            MUTEX_LOCK(raop_rtp_mirror->time_mutex);
-            gettimeofday(&now, NULL);
-            outtime.tv_sec = now.tv_sec + 3;
-            outtime.tv_nsec = now.tv_usec * 1000;
-            int ret = pthread_cond_timedwait(&raop_rtp_mirror->time_cond, &raop_rtp_mirror->time_mutex, &outtime);
-            MUTEX_UNLOCK(raop_rtp_mirror->time_mutex);
-#endif
-
-
-        }
-    }
-    logger_log(raop_rtp_mirror->logger, LOGGER_INFO, "Exiting UDP raop_rtp_mirror_thread_time thread");
-    return 0;
-}
 //#define DUMP_H264
 
 #define RAOP_PACKET_LEN 32768
@@ -332,8 +258,8 @@ raop_rtp_mirror_thread(void *arg)
 //                    } else {
 //                        pts =  ntptopts(payloadntp) - pts_base;
 //                    }
-                    /* 直接回调packet中的time，用于同步音频 */
-                    pts =  ntptopts(payloadntp);
+                    /* packet中是发送端的ntp时间,换算到本地时钟,和音频pts在同一时基 */
+                    pts = raop_ntp_convert_remote_time(raop_rtp_mirror->ntp, timeutils_ntp_to_us(payloadntp));
                     /* 这里是加密的数据 */
                     unsigned char* payload_in = malloc(payloadsize);
                     unsigned char* payload = malloc(payloadsize);
@@ -511,11 +437,8 @@ raop_rtp_mirror_thread(void *arg)
 }
 
 void
-raop_rtp_start_mirror(raop_rtp_mirror_t *raop_rtp_mirror, int use_udp, unsigned short * mirror_timing_lport,
-                      unsigned short *mirror_data_lport)
+raop_rtp_start_mirror(raop_rtp_mirror_t *raop_rtp_mirror, int use_udp, unsigned short *mirror_data_lport)
 {
-    int use_ipv6 = 0;
-
     assert(raop_rtp_mirror);
 
     MUTEX_LOCK(raop_rtp_mirror->run_mutex);
@@ -523,16 +446,12 @@ raop_rtp_start_mirror(raop_rtp_mirror_t *raop_rtp_mirror, int use_udp, unsigned
         MUTEX_UNLOCK(raop_rtp_mirror->run_mutex);
         return;
     }
-    if (raop_rtp_mirror->remote_saddr.ss_family == AF_INET6) {
-        use_ipv6 = 1;
-    }
-    use_ipv6 = 0;
-    if (raop_rtp_init_mirror_sockets(raop_rtp_mirror, use_ipv6) < 0) {
+    /* 端口从会话资源池中取,都是ipv4 socket */
+    if (raop_rtp_init_mirror_sockets(raop_rtp_mirror) < 0) {
         logger_log(raop_rtp_mirror->logger, LOGGER_INFO, "Initializing sockets failed");
         MUTEX_UNLOCK(raop_rtp_mirror->run_mutex);
         return;
     }
-    if (mirror_timing_lport) *mirror_timing_lport = raop_rtp_mirror->mirror_timing_lport;
     if (mirror_data_lport) *mirror_data_lport = raop_rtp_mirror->mirror_data_lport;
 
     /* Create the thread and initialize running values */
@@ -540,7 +459,6 @@ raop_rtp_start_mirror(raop_rtp_mirror_t *raop_rtp_mirror, int use_udp, unsigned
     raop_rtp_mirror->joined = 0;
 
     THREAD_CREATE(raop_rtp_mirror->thread_mirror, raop_rtp_mirror_thread, raop_rtp_mirror);
-    THREAD_CREATE(raop_rtp_mirror->thread_time, raop_rtp_mirror_thread_time, raop_rtp_mirror);
     MUTEX_UNLOCK(raop_rtp_mirror->run_mutex);
 }
 
@@ -570,14 +488,7 @@ void raop_rtp_mirror_stop(raop_rtp_mirror_t *raop_rtp_mirror) {
 
     /* Join the thread */
     THREAD_JOIN(raop_rtp_mirror->thread_mirror);
-
-    MUTEX_LOCK(raop_rtp_mirror->time_mutex);
-    COND_SIGNAL(raop_rtp_mirror->time_cond);
-    MUTEX_UNLOCK(raop_rtp_mirror->time_mutex);
-
-    THREAD_JOIN(raop_rtp_mirror->thread_time);
     if (raop_rtp_mirror->mirror_data_sock != -1) closesocket(raop_rtp_mirror->mirror_data_sock);
-    if (raop_rtp_mirror->mirror_time_sock != -1) closesocket(raop_rtp_mirror->mirror_time_sock);
 
     /* Mark thread as joined */
     MUTEX_LOCK(raop_rtp_mirror->run_mutex);
@@ -589,23 +500,20 @@ void raop_rtp_mirror_destroy(raop_rtp_mirror_t *raop_rtp_mirror) {
     if (raop_rtp_mirror) {
         raop_rtp_mirror_stop(raop_rtp_mirror);
         MUTEX_DESTROY(raop_rtp_mirror->run_mutex);
-        MUTEX_DESTROY(raop_rtp_mirror->time_mutex);
-        COND_DESTROY(raop_rtp_mirror->time_cond);
         mirror_buffer_destroy(raop_rtp_mirror->buffer);
     }
 }
 
 static int
-raop_rtp_init_mirror_sockets(raop_rtp_mirror_t *raop_rtp_mirror, int use_ipv6)
+raop_rtp_init_mirror_sockets(raop_rtp_mirror_t *raop_rtp_mirror)
 {
-    int dsock = -1, tsock = -1;
-    unsigned short tport = 0, dport = 0;
+    int dsock = -1;
+    unsigned short dport = 0;
 
     assert(raop_rtp_mirror);
 
-    dsock = netutils_init_socket(&dport, use_ipv6, 0);
-    tsock = netutils_init_socket(&tport, use_ipv6, 1);
-    if (dsock == -1 || tsock == -1) {
+    dsock = raop_pool_get_socket(raop_rtp_mirror->pool, 0, &dport);
+    if (dsock == -1) {
         goto sockets_cleanup;
     }
 
@@ -616,15 +524,12 @@ raop_rtp_init_mirror_sockets(raop_rtp_mirror_t *raop_rtp_mirror, int use_ipv6)
 
     /* Set socket descriptors */
     raop_rtp_mirror->mirror_data_sock = dsock;
-    raop_rtp_mirror->mirror_time_sock = tsock;
 
     /* Set port values */
     raop_rtp_mirror->mirror_data_lport = dport;
-    raop_rtp_mirror->mirror_timing_lport = tport;
     return 0;
 
     sockets_cleanup:
-    if (tsock != -1) closesocket(tsock);
     if (dsock != -1) closesocket(dsock);
     return -1;
 }
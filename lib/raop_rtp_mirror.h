@@ -18,18 +18,19 @@
 #include <stdint.h>
 #include "raop.h"
 #include "logger.h"
+#include "raop_ntp.h"
+#include "raop_pool.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
 typedef struct raop_rtp_mirror_s raop_rtp_mirror_t;
 typedef struct h264codec_s h264codec_t;
 
-raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, const unsigned char *remote, int remotelen,
-                                        const unsigned char *aeskey, const unsigned char *ecdh_secret, unsigned short timing_rport);
+raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp, raop_pool_t *pool, const unsigned char *remote, int remotelen,
+                                        const unsigned char *aeskey, const unsigned char *ecdh_secret);
 void raop_rtp_init_mirror_aes(raop_rtp_mirror_t *raop_rtp_mirror, uint64_t streamConnectionID);
-void raop_rtp_start_mirror(raop_rtp_mirror_t *raop_rtp_mirror, int use_udp, unsigned short * mirror_timing_lport,
-                      unsigned short *mirror_data_lport);
-static int raop_rtp_init_mirror_sockets(raop_rtp_mirror_t *raop_rtp_mirror, int use_ipv6);
+void raop_rtp_start_mirror(raop_rtp_mirror_t *raop_rtp_mirror, int use_udp, unsigned short *mirror_data_lport);
+static int raop_rtp_init_mirror_sockets(raop_rtp_mirror_t *raop_rtp_mirror);
 int raop_rtp_mirror_is_running(raop_rtp_mirror_t *raop_rtp_mirror);
 void raop_rtp_mirror_stop(raop_rtp_mirror_t *raop_rtp_mirror);
 void raop_rtp_mirror_destroy(raop_rtp_mirror_t *raop_rtp_mirror);
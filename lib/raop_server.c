@@ -45,7 +45,7 @@ audio_destroy(void *cls, void *opaque)
     audio_session_t *session = (audio_session_t *)opaque;
     free(session);
 }
-// 处理音量变化
+// 音量已经在库内处理,这里只记录当前音量
 static void
 audio_set_volume(void *cls, void *opaque, float volume)
 {
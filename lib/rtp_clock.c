@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "rtp_clock.h"
+
+/* 拟合窗口,sync包大约每秒一个 */
+#define RTP_CLOCK_WINDOW 16
+/* 窗口跨度小于这个值(us)时只拟合截距,斜率用标称值 */
+#define RTP_CLOCK_MIN_SPAN 2000000
+/* sync包和拟合直线的偏差超过这个值(us)时重新开始 */
+#define RTP_CLOCK_MAX_RESIDUAL 20000
+/* 漂移的上限,超出时认为拟合不可信 */
+#define RTP_CLOCK_MAX_DRIFT 0.001
+
+struct rtp_clock_s {
+    /* 标称的每个采样的us数 */
+    double nominal;
+
+    /* 展开成64位的rtp时间戳和对应的发送端时间 */
+    int64_t ext[RTP_CLOCK_WINDOW];
+    uint64_t time[RTP_CLOCK_WINDOW];
+    int count;
+    int index;
+    int64_t last_ext;
+
+    /* 拟合结果:time = ref_time + slope * (ext - ref_ext) */
+    int64_t ref_ext;
+    uint64_t ref_time;
+    double slope;
+};
+
+rtp_clock_t *
+rtp_clock_init(unsigned int rate)
+{
+    rtp_clock_t *clock;
+
+    assert(rate > 0);
+
+    clock = calloc(1, sizeof(rtp_clock_t));
+    if (!clock) {
+        return NULL;
+    }
+    clock->nominal = 1000000.0 / rate;
+    rtp_clock_reset(clock);
+    return clock;
+}
+
+void
+rtp_clock_reset(rtp_clock_t *clock)
+{
+    clock->count = 0;
+    clock->index = 0;
+    clock->slope = clock->nominal;
+}
+
+/* 以最近的sync为参考把32位时间戳展开,前后各2^31个采样内都正确 */
+static int64_t
+rtp_clock_extend(rtp_clock_t *clock, unsigned int timestamp)
+{
+    if (clock->count == 0) {
+        return timestamp;
+    }
+    return clock->last_ext + (int32_t) (timestamp - (unsigned int) clock->last_ext);
+}
+
+static uint64_t
+rtp_clock_predict(rtp_clock_t *clock, int64_t ext)
+{
+    return clock->ref_time + (int64_t) (clock->slope * (double) (ext - clock->ref_ext));
+}
+
+/* 以最新的点为原点做最小二乘,避免大数相减损失精度 */
+static void
+rtp_clock_fit(rtp_clock_t *clock)
+{
+    int newest = (clock->index + RTP_CLOCK_WINDOW - 1) % RTP_CLOCK_WINDOW;
+    int64_t ext0 = clock->ext[newest];
+    uint64_t time0 = clock->time[newest];
+    int64_t min_ext = ext0;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, n = clock->count;
+    double slope = clock->nominal, intercept;
+    int i;
+
+    for (i = 0; i < clock->count; i++) {
+        double x = (double) (clock->ext[i] - ext0);
+        double y = (double) (int64_t) (clock->time[i] - time0);
+        if (clock->ext[i] < min_ext) {
+            min_ext = clock->ext[i];
+        }
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    if ((double) (ext0 - min_ext) * clock->nominal >= RTP_CLOCK_MIN_SPAN && n * sxx - sx * sx > 0) {
+        slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+        if (slope > clock->nominal * (1 + RTP_CLOCK_MAX_DRIFT) ||
+            slope < clock->nominal * (1 - RTP_CLOCK_MAX_DRIFT)) {
+            slope = clock->nominal;
+        }
+    }
+    /* 直线过重心 */
+    intercept = (sy - slope * sx) / n;
+
+    clock->slope = slope;
+    clock->ref_ext = ext0;
+    clock->ref_time = time0 + (int64_t) intercept;
+}
+
+void
+rtp_clock_add_sync(rtp_clock_t *clock, unsigned int timestamp, uint64_t time)
+{
+    int64_t ext = rtp_clock_extend(clock, timestamp);
+
+    if (clock->count > 0) {
+        int64_t residual = (int64_t) (time - rtp_clock_predict(clock, ext));
+        if (residual > RTP_CLOCK_MAX_RESIDUAL || residual < -RTP_CLOCK_MAX_RESIDUAL) {
+            rtp_clock_reset(clock);
+            ext = timestamp;
+        }
+    }
+    clock->last_ext = ext;
+    clock->ext[clock->index] = ext;
+    clock->time[clock->index] = time;
+    clock->index = (clock->index + 1) % RTP_CLOCK_WINDOW;
+    if (clock->count < RTP_CLOCK_WINDOW) {
+        clock->count++;
+    }
+    rtp_clock_fit(clock);
+}
+
+uint64_t
+rtp_clock_get_time(rtp_clock_t *clock, unsigned int timestamp)
+{
+    if (clock->count == 0) {
+        return 0;
+    }
+    return rtp_clock_predict(clock, rtp_clock_extend(clock, timestamp));
+}
+
+int
+rtp_clock_get_drift_ppm(rtp_clock_t *clock)
+{
+    return (int) ((clock->nominal / clock->slope - 1) * 1000000);
+}
+
+void
+rtp_clock_destroy(rtp_clock_t *clock)
+{
+    free(clock);
+}
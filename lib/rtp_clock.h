@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * rtp时间戳到发送端时钟的映射
+ * 对最近若干个sync包的(rtp时间戳,发送端时间)做线性拟合,得到平滑的时间线和采样率的漂移,
+ * 每个sync包只让拟合直线小幅调整,pts不会在sync包到达时跳变
+ * 和拟合直线偏差过大的sync包认为是发送端时间线不连续,丢弃历史重新开始
+ * 非线程安全,由调用者加锁
+ */
+
+#ifndef RTP_CLOCK_H
+#define RTP_CLOCK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rtp_clock_s rtp_clock_t;
+
+rtp_clock_t *rtp_clock_init(unsigned int rate);
+void rtp_clock_reset(rtp_clock_t *clock);
+/* time是sync包中发送端的时间,from 1970 us */
+void rtp_clock_add_sync(rtp_clock_t *clock, unsigned int timestamp, uint64_t time);
+/* timestamp对应的发送端时间,还没有sync时返回0 */
+uint64_t rtp_clock_get_time(rtp_clock_t *clock, unsigned int timestamp);
+/* 发送端采样率相对标称值的偏差 ppm,正数表示发送端偏快 */
+int rtp_clock_get_drift_ppm(rtp_clock_t *clock);
+void rtp_clock_destroy(rtp_clock_t *clock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RTP_CLOCK_H
@@ -30,10 +30,90 @@ typedef struct {
     int height;
 } h264_decode_struct;
 
+/* 带引用计数的pcm帧,见pcm_pool.h */
+typedef struct pcm_frame_s pcm_frame_t;
+
+/* 回调的pcm采样格式,float的范围是[-1, 1) */
+#define PCM_FORMAT_S16 0
+#define PCM_FORMAT_S32 1
+#define PCM_FORMAT_F32 2
+
 typedef struct {
-    short *data;
+    /* 格式见format,channels和planar,默认是交错的16位双声道 */
+    void *data;
+    /* data的字节数 */
     int data_len;
     /* from 1970 us */
     uint64_t pts;
+    /* 不为NULL时data在frame中,回调里pcm_frame_retain之后可以在回调返回后继续使用,用完pcm_frame_release */
+    pcm_frame_t *frame;
+    /* 每个声道的采样数,planar时第c个声道从第c * frames个采样开始 */
+    int frames;
+    int format;
+    int channels;
+    int planar;
 } pcm_data_struct;
+
+/* 多帧pcm一起回调,data中的帧依次连续存放,planar时每帧内部分声道存放 */
+typedef struct {
+    void *data;
+    /* data中采样的总数,包括所有声道 */
+    int data_len;
+    int frame_count;
+    /* 每帧采样的个数,包括所有声道,转换采样率时各帧长度可能不同,此时为0 */
+    int frame_len;
+    /* 每帧采样的个数,包括所有声道,帧在data中依次相连 */
+    int *frame_lens;
+    /* 每帧的pts,from 1970 us */
+    uint64_t *pts;
+    int format;
+    int channels;
+    int planar;
+} pcm_batch_struct;
+
+/* 音频链路统计,耗时类的值统计的是上一个上报周期 */
+typedef struct {
+    /* 接收线程到解码线程的队列,只在pipeline模式下有效 */
+    int queue_depth;
+    int queue_max_depth;
+    unsigned int queue_drops;
+    /* 包在队列中等待的时间 us */
+    unsigned int queue_wait_avg_us;
+    unsigned int queue_wait_max_us;
+    /* 解密和解码耗时 us */
+    unsigned int decode_avg_us;
+    unsigned int decode_max_us;
+    /* audio_process回调耗时 us */
+    unsigned int deliver_avg_us;
+    unsigned int deliver_max_us;
+    /* 累计收到的包和回调的帧 */
+    unsigned int packets;
+    unsigned int frames;
+    /* 累计请求重传的包,重传恢复的包,到播放时间仍未恢复而放弃的包 */
+    unsigned int resend_requested;
+    unsigned int resend_recovered;
+    unsigned int resend_abandoned;
+    /* 重传的平滑往返时间 us,0表示还没有测到 */
+    unsigned int resend_rtt_us;
+    /* jitter buffer中已经收到,等待播放的包数 */
+    int buffer_depth;
+    /* pcm帧池:已分配的帧数,正在使用的帧数,使用帧数的最大值,池用完时退回拷贝的次数 */
+    int pool_frames;
+    int pool_in_use;
+    int pool_max_in_use;
+    unsigned int pool_exhausted;
+    /* 累计检测到的静音帧 */
+    unsigned int silent_frames;
+    /* 时钟同步:是否已同步,发送端减本地的偏移 us,所用交换的往返延迟 us(pts误差不超过它的一半),频率漂移 ppm */
+    int clock_synced;
+    int64_t clock_offset_us;
+    unsigned int clock_rtt_us;
+    int clock_drift_ppm;
+    /* sync包拟合出的发送端采样率偏差 ppm,正数表示发送端偏快 */
+    int rtp_drift_ppm;
+    /* 数据包到达间隔的抖动 us(RFC 3550),有内核接收时间戳时不含接收线程的调度延迟 */
+    unsigned int jitter_us;
+    /* 采样率转换当前的漂移补偿 ppm,没有转换时为0 */
+    int output_drift_ppm;
+} audio_stats_struct;
 #endif //AIRPLAYSERVER_STREAM_H
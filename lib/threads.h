@@ -37,12 +37,28 @@ typedef HANDLE mutex_handle_t;
 typedef HANDLE cond_handle_t;
 #define COND_CREATE(handle) handle = CreateEvent(NULL, TRUE, FALSE, NULL)
 #define COND_SIGNAL(handle) SetEvent(handle)
+#define COND_WAIT(handle, mutex) do {\
+	ReleaseMutex(mutex);\
+	WaitForSingleObject(handle, INFINITE);\
+	ResetEvent(handle);\
+	WaitForSingleObject(mutex, INFINITE);\
+} while(0)
+#define COND_TIMEDWAIT(handle, mutex, ms) do {\
+	ReleaseMutex(mutex);\
+	WaitForSingleObject(handle, ms);\
+	ResetEvent(handle);\
+	WaitForSingleObject(mutex, INFINITE);\
+} while(0)
 #define COND_DESTROY(handle) CloseHandle(handle)
 
+#define ATOMIC_LOAD_ACQUIRE(ptr) InterlockedCompareExchange((volatile LONG *)(ptr), 0, 0)
+#define ATOMIC_STORE_RELEASE(ptr, value) InterlockedExchange((volatile LONG *)(ptr), (LONG)(value))
+
 #else /* Use pthread library */
 
 #include <pthread.h>
 #include <unistd.h>
+#include <time.h>
 
 #define sleepms(x) usleep((x)*1000)
 
@@ -64,8 +80,20 @@ typedef pthread_cond_t cond_handle_t;
 
 #define COND_CREATE(handle) pthread_cond_init(&(handle), NULL)
 #define COND_SIGNAL(handle) pthread_cond_signal(&(handle))
+#define COND_WAIT(handle, mutex) pthread_cond_wait(&(handle), &(mutex))
+#define COND_TIMEDWAIT(handle, mutex, ms) do {\
+	struct timespec _ts;\
+	clock_gettime(CLOCK_REALTIME, &_ts);\
+	_ts.tv_sec += (ms) / 1000;\
+	_ts.tv_nsec += ((ms) % 1000) * 1000000L;\
+	if (_ts.tv_nsec >= 1000000000L) { _ts.tv_sec++; _ts.tv_nsec -= 1000000000L; }\
+	pthread_cond_timedwait(&(handle), &(mutex), &_ts);\
+} while(0)
 #define COND_DESTROY(handle) pthread_cond_destroy(&(handle))
 
+#define ATOMIC_LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE_RELEASE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+
 #endif
 
 #endif /* THREADS_H */
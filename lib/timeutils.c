@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <time.h>
+#include "timeutils.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#if defined(_MSC_VER)
+#define TIMEUTILS_THREAD_LOCAL __declspec(thread)
+#else
+#define TIMEUTILS_THREAD_LOCAL __thread
+#endif
+
+static TIMEUTILS_THREAD_LOCAL uint64_t cached_us;
+
+#ifdef _WIN32
+/* FILETIME是from 1601的100ns */
+#define FILETIME_TO_1970 116444736000000000ULL
+
+static uint64_t
+timeutils_filetime()
+{
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    return (((uint64_t) ft.dwHighDateTime << 32) | ft.dwLowDateTime) - FILETIME_TO_1970;
+}
+
+static LONGLONG
+timeutils_qpc_freq()
+{
+    static LONGLONG freq = 0;
+    if (freq == 0) {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        freq = f.QuadPart;
+    }
+    return freq;
+}
+
+uint64_t timeutils_monotonic_ns() {
+    LARGE_INTEGER counter;
+    LONGLONG freq = timeutils_qpc_freq();
+    QueryPerformanceCounter(&counter);
+    return (uint64_t) (counter.QuadPart / freq) * 1000000000 +
+           (uint64_t) (counter.QuadPart % freq) * 1000000000 / freq;
+}
+
+uint64_t timeutils_realtime_ns() {
+    return timeutils_filetime() * 100;
+}
+
+uint64_t timeutils_monotonic_us() {
+    LARGE_INTEGER counter;
+    LONGLONG freq = timeutils_qpc_freq();
+    QueryPerformanceCounter(&counter);
+    return (uint64_t) (counter.QuadPart / freq) * 1000000 +
+           (uint64_t) (counter.QuadPart % freq) * 1000000 / freq;
+}
+
+uint64_t timeutils_realtime_us() {
+    return timeutils_filetime() / 10;
+}
+#else
+uint64_t timeutils_monotonic_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000 + (uint64_t) time.tv_nsec;
+}
+
+uint64_t timeutils_realtime_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_REALTIME, &time);
+    return (uint64_t) time.tv_sec * 1000000000 + (uint64_t) time.tv_nsec;
+}
+
+/* tv_nsec只需要32位除法,不从ns换算 */
+uint64_t timeutils_monotonic_us() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000 + (uint64_t) (time.tv_nsec / 1000);
+}
+
+uint64_t timeutils_realtime_us() {
+    struct timespec time;
+    clock_gettime(CLOCK_REALTIME, &time);
+    return (uint64_t) time.tv_sec * 1000000 + (uint64_t) (time.tv_nsec / 1000);
+}
+#endif
+
+uint64_t timeutils_update_cached_us() {
+    cached_us = timeutils_monotonic_us();
+    return cached_us;
+}
+
+uint64_t timeutils_cached_us() {
+    return cached_us;
+}
+
+uint64_t timeutils_realtime_to_monotonic_us(uint64_t realtime_us) {
+    uint64_t monotonic = timeutils_monotonic_us();
+    uint64_t realtime = timeutils_realtime_us();
+    /* 真实时钟被往回调整过时无法换算,当作刚刚到达 */
+    if (realtime_us >= realtime || realtime - realtime_us >= monotonic) {
+        return monotonic;
+    }
+    return monotonic - (realtime - realtime_us);
+}
+
+uint64_t timeutils_ntp_to_us(uint64_t ntp) {
+    uint64_t seconds = (ntp >> 32) - TIMEUTILS_NTP_EPOCH_OFFSET;
+    return seconds * 1000000 + (((ntp & 0xffffffff) * 1000000) >> 32);
+}
+
+uint64_t timeutils_us_to_ntp(uint64_t us) {
+    /* 用浮点乘法求秒数再修正余数,避免64位除法 */
+    uint64_t seconds = (uint64_t) ((double) us * 0.000001);
+    int64_t rest = (int64_t) (us - seconds * 1000000);
+    if (rest < 0) {
+        seconds--;
+        rest += 1000000;
+    } else if (rest >= 1000000) {
+        seconds++;
+        rest -= 1000000;
+    }
+    /* 2^48 / 10^6 = 281474976.71 */
+    uint64_t fraction = ((uint64_t) rest * 281474977) >> 16;
+    if (fraction > 0xffffffff) {
+        fraction = 0xffffffff;
+    }
+    return ((seconds + TIMEUTILS_NTP_EPOCH_OFFSET) << 32) | fraction;
+}
+
+int64_t timeutils_rtp_to_us(int32_t ticks, unsigned int rate) {
+    return (int64_t) ((double) ticks * 1000000 / rate);
+}
+
+int32_t timeutils_us_to_rtp(int64_t us, unsigned int rate) {
+    return (int32_t) ((double) us * rate / 1000000);
+}
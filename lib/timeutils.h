@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2019 dsafa22, All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/**
+ * 时间基准:单调时钟和真实时钟,以及NTP 32.32,RTP采样数和us之间的换算
+ * 单调时钟用于计算耗时和截止时间,真实时钟(from 1970)只用于和发送端交换时间
+ * 换算不使用64位整数除法,32位平台上不会调用耗时的除法库函数
+ */
+
+#ifndef TIMEUTILS_H
+#define TIMEUTILS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* NTP从1900开始,us从1970开始 */
+#define TIMEUTILS_NTP_EPOCH_OFFSET 2208988800ULL
+
+uint64_t timeutils_monotonic_ns();
+uint64_t timeutils_realtime_ns();
+uint64_t timeutils_monotonic_us();
+uint64_t timeutils_realtime_us();
+
+/**
+ * 热循环里使用的缓存时间,每个线程各自缓存
+ * timeutils_update_cached_us读取单调时钟并缓存,timeutils_cached_us返回本线程上次缓存的值
+ */
+uint64_t timeutils_update_cached_us();
+uint64_t timeutils_cached_us();
+
+/* 真实时钟的时间点(比如内核接收时间戳)换算成单调时钟,按当前两个时钟的差换算,不晚于当前时间 */
+uint64_t timeutils_realtime_to_monotonic_us(uint64_t realtime_us);
+
+/* NTP 32.32(from 1900)和us(from 1970)互相换算 */
+uint64_t timeutils_ntp_to_us(uint64_t ntp);
+uint64_t timeutils_us_to_ntp(uint64_t us);
+/* ticks是有符号的采样差,rate是采样率 */
+int64_t timeutils_rtp_to_us(int32_t ticks, unsigned int rate);
+int32_t timeutils_us_to_rtp(int64_t us, unsigned int rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TIMEUTILS_H
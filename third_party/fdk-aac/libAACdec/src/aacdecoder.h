@@ -406,13 +406,12 @@ AAC_DECODER_ERROR CAacDecoder_AncDataGet(CAncData *ancData, int index,
                                          unsigned char **ptr, int *size);
 
 /* initialization of aac decoder */
-LINKSPEC_H HANDLE_AACDECODER CAacDecoder_Open(TRANSPORT_TYPE bsFormat);
+HANDLE_AACDECODER CAacDecoder_Open(TRANSPORT_TYPE bsFormat);
 
 /* Initialization of channel elements */
-LINKSPEC_H AAC_DECODER_ERROR CAacDecoder_Init(HANDLE_AACDECODER self,
-                                              const CSAudioSpecificConfig *asc,
-                                              UCHAR configMode,
-                                              UCHAR *configChanged);
+AAC_DECODER_ERROR CAacDecoder_Init(HANDLE_AACDECODER self,
+                                   const CSAudioSpecificConfig *asc,
+                                   UCHAR configMode, UCHAR *configChanged);
 /*!
   \brief Decodes one aac frame
 
@@ -426,40 +425,39 @@ LINKSPEC_H AAC_DECODER_ERROR CAacDecoder_Init(HANDLE_AACDECODER self,
 
   \return  error status
 */
-LINKSPEC_H AAC_DECODER_ERROR CAacDecoder_DecodeFrame(
+AAC_DECODER_ERROR CAacDecoder_DecodeFrame(
     HANDLE_AACDECODER self, const UINT flags, FIXP_PCM *pTimeData,
     const INT timeDataSize, const int timeDataChannelOffset);
 
 /* Free config dependent AAC memory */
-LINKSPEC_H AAC_DECODER_ERROR CAacDecoder_FreeMem(HANDLE_AACDECODER self,
-                                                 const int subStreamIndex);
+AAC_DECODER_ERROR CAacDecoder_FreeMem(HANDLE_AACDECODER self,
+                                      const int subStreamIndex);
 
 /* Prepare crossfade for USAC DASH IPF config change */
-LINKSPEC_H AAC_DECODER_ERROR CAacDecoder_PrepareCrossFade(
+AAC_DECODER_ERROR CAacDecoder_PrepareCrossFade(
     const INT_PCM *pTimeData, INT_PCM **pTimeDataFlush, const INT numChannels,
     const INT frameSize, const INT interleaved);
 
 /* Apply crossfade for USAC DASH IPF config change */
-LINKSPEC_H AAC_DECODER_ERROR CAacDecoder_ApplyCrossFade(
+AAC_DECODER_ERROR CAacDecoder_ApplyCrossFade(
     INT_PCM *pTimeData, INT_PCM **pTimeDataFlush, const INT numChannels,
     const INT frameSize, const INT interleaved);
 
 /* Set flush and build up mode */
-LINKSPEC_H AAC_DECODER_ERROR CAacDecoder_CtrlCFGChange(HANDLE_AACDECODER self,
-                                                       UCHAR flushStatus,
-                                                       SCHAR flushCnt,
-                                                       UCHAR buildUpStatus,
-                                                       SCHAR buildUpCnt);
+AAC_DECODER_ERROR CAacDecoder_CtrlCFGChange(HANDLE_AACDECODER self,
+                                            UCHAR flushStatus, SCHAR flushCnt,
+                                            UCHAR buildUpStatus,
+                                            SCHAR buildUpCnt);
 
 /* Parse preRoll Extension Payload */
-LINKSPEC_H AAC_DECODER_ERROR CAacDecoder_PreRollExtensionPayloadParse(
+AAC_DECODER_ERROR CAacDecoder_PreRollExtensionPayloadParse(
     HANDLE_AACDECODER self, UINT *numPrerollAU, UINT *prerollAUOffset,
     UINT *prerollAULength);
 
 /* Destroy aac decoder */
-LINKSPEC_H void CAacDecoder_Close(HANDLE_AACDECODER self);
+void CAacDecoder_Close(HANDLE_AACDECODER self);
 
 /* get streaminfo handle from decoder */
-LINKSPEC_H CStreamInfo *CAacDecoder_GetStreamInfo(HANDLE_AACDECODER self);
+CStreamInfo *CAacDecoder_GetStreamInfo(HANDLE_AACDECODER self);
 
 #endif /* #ifndef AACDECODER_H */
@@ -110,8 +110,11 @@ amm-info@iis.fraunhofer.de
 #define LDFB_HEADROOM 2
 
 #if defined(__arm__)
+#elif defined(__x86__)
+#include "x86/ldfiltbank_x86.cpp"
 #endif
 
+#if !defined(FUNCTION_multE2_DinvF_fdk)
 static void multE2_DinvF_fdk(FIXP_PCM *output, FIXP_DBL *x, const FIXP_WTB *fb,
                              FIXP_DBL *z, const int N) {
   int i;
@@ -207,6 +210,7 @@ static void multE2_DinvF_fdk(FIXP_PCM *output, FIXP_DBL *x, const FIXP_WTB *fb,
 #endif
   }
 }
+#endif /* FUNCTION_multE2_DinvF_fdk */
 
 int InvMdctTransformLowDelay_fdk(FIXP_DBL *mdctData, const int mdctData_e,
                                  FIXP_PCM *output, FIXP_DBL *fs_buffer,
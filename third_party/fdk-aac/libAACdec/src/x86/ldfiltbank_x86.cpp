@@ -0,0 +1,260 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/**************************** AAC decoder library ******************************
+
+   Author(s):
+
+   Description: low delay filterbank windowing for x86 with SSE2
+
+*******************************************************************************/
+
+#include "x86/simd_x86.h"
+
+#if defined(FDK_X86_SSE2) && defined(WINDOWTABLE_16BIT) && \
+    (SAMPLE_BITS == 16) && ((DFRACT_BITS - SAMPLE_BITS - LDFB_HEADROOM) > 0)
+
+#define FUNCTION_multE2_DinvF_fdk
+
+/* 4 window coefficients as FIXP_DBL */
+static FDK_FORCEINLINE __m128i ldfb_x86_loadWin(const FIXP_WTB *p) {
+  return _mm_unpacklo_epi16(_mm_setzero_si128(),
+                            _mm_loadl_epi64((const __m128i *)p));
+}
+
+static FDK_FORCEINLINE __m128i ldfb_x86_reverse(__m128i a) {
+  return _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+/* SATURATE_RIGHT_SHIFT() of 4 values, the saturation is done by the packing */
+static FDK_FORCEINLINE void ldfb_x86_storePCM(FIXP_PCM *p, __m128i v,
+                                              __m128i rnd, int shift) {
+  v = _mm_srai_epi32(_mm_add_epi32(v, rnd), shift);
+  _mm_storel_epi64((__m128i *)p, _mm_packs_epi32(v, v));
+}
+
+/*
+  Same as the generic multE2_DinvF_fdk(): all iterations of the loops are
+  independent, the vector loops do 4 of them at once and the remaining ones are
+  done by the scalar loops.
+*/
+static void multE2_DinvF_fdk(FIXP_PCM *output, FIXP_DBL *x, const FIXP_WTB *fb,
+                             FIXP_DBL *z, const int N) {
+  int i;
+
+  /*  scale for FIXP_DBL -> INT_PCM conversion. */
+  const int scale = (DFRACT_BITS - SAMPLE_BITS) - LDFB_HEADROOM;
+  const int shift0 = -WTS0 - 1 + scale;
+  const int shift1 = -WTS1 - 1 + scale;
+  const FIXP_DBL rnd_val_wts0 = (FIXP_DBL)(1 << (shift0 - 1));
+  const FIXP_DBL rnd_val_wts1 = (FIXP_DBL)(1 << (shift1 - 1));
+  const __m128i rnd0 = _mm_set1_epi32(rnd_val_wts0);
+  const __m128i rnd1 = _mm_set1_epi32(rnd_val_wts1);
+
+  i = 0;
+  for (; i + 4 <= N / 4; i += 4) {
+    __m128i z0, z1, z2, tmp;
+
+    z2 = _mm_loadu_si128((__m128i *)&x[N / 2 + i]);
+    z0 = FDK_mm_mulhi_epi32(_mm_loadu_si128((__m128i *)&z[N / 2 + i]),
+                            ldfb_x86_loadWin(&fb[2 * N + i]));
+    z0 = _mm_add_epi32(z2, _mm_srai_epi32(z0, -WTS2 - 1));
+
+    z1 = FDK_mm_mulhi_epi32(_mm_loadu_si128((__m128i *)&z[N + i]),
+                            ldfb_x86_loadWin(&fb[2 * N + N / 2 + i]));
+    z1 = _mm_add_epi32(
+        ldfb_x86_reverse(_mm_loadu_si128((__m128i *)&x[N / 2 - 4 - i])),
+        _mm_srai_epi32(z1, -WTS2 - 1));
+    _mm_storeu_si128((__m128i *)&z[N / 2 + i], z1);
+
+    tmp = _mm_add_epi32(
+        FDK_mm_mulhi_epi32(z1, ldfb_x86_reverse(ldfb_x86_loadWin(
+                                   &fb[N + N / 2 - 4 - i]))),
+        FDK_mm_mulhi_epi32(_mm_loadu_si128((__m128i *)&z[i]),
+                           ldfb_x86_loadWin(&fb[N + N / 2 + i])));
+    ldfb_x86_storePCM(&output[N * 3 / 4 - 4 - i], ldfb_x86_reverse(tmp), rnd1,
+                      shift1);
+
+    _mm_storeu_si128((__m128i *)&z[i], z0);
+    _mm_storeu_si128((__m128i *)&z[N + i], z2);
+  }
+  for (; i < N / 4; i++) {
+    FIXP_DBL z0, z2, tmp;
+
+    z2 = x[N / 2 + i];
+    z0 = z2 + (fMultDiv2(z[N / 2 + i], fb[2 * N + i]) >> (-WTS2 - 1));
+
+    z[N / 2 + i] = x[N / 2 - 1 - i] +
+                   (fMultDiv2(z[N + i], fb[2 * N + N / 2 + i]) >> (-WTS2 - 1));
+
+    tmp = (fMultDiv2(z[N / 2 + i], fb[N + N / 2 - 1 - i]) +
+           fMultDiv2(z[i], fb[N + N / 2 + i]));
+
+    output[(N * 3 / 4 - 1 - i)] = (FIXP_PCM)SATURATE_RIGHT_SHIFT(
+        tmp + rnd_val_wts1, shift1, PCM_OUT_BITS);
+
+    z[i] = z0;
+    z[N + i] = z2;
+  }
+
+  for (; i + 4 <= N / 2; i += 4) {
+    __m128i z0, z1, z2, zi, tmp0, tmp1;
+
+    z2 = _mm_loadu_si128((__m128i *)&x[N / 2 + i]);
+    z0 = FDK_mm_mulhi_epi32(_mm_loadu_si128((__m128i *)&z[N / 2 + i]),
+                            ldfb_x86_loadWin(&fb[2 * N + i]));
+    z0 = _mm_add_epi32(z2, _mm_srai_epi32(z0, -WTS2 - 1));
+
+    z1 = FDK_mm_mulhi_epi32(_mm_loadu_si128((__m128i *)&z[N + i]),
+                            ldfb_x86_loadWin(&fb[2 * N + N / 2 + i]));
+    z1 = _mm_add_epi32(
+        ldfb_x86_reverse(_mm_loadu_si128((__m128i *)&x[N / 2 - 4 - i])),
+        _mm_srai_epi32(z1, -WTS2 - 1));
+    _mm_storeu_si128((__m128i *)&z[N / 2 + i], z1);
+
+    zi = _mm_loadu_si128((__m128i *)&z[i]);
+    tmp0 = _mm_add_epi32(
+        FDK_mm_mulhi_epi32(
+            z1, ldfb_x86_reverse(ldfb_x86_loadWin(&fb[N / 2 - 4 - i]))),
+        FDK_mm_mulhi_epi32(zi, ldfb_x86_loadWin(&fb[N / 2 + i])));
+    tmp1 = _mm_add_epi32(
+        FDK_mm_mulhi_epi32(z1, ldfb_x86_reverse(ldfb_x86_loadWin(
+                                   &fb[N + N / 2 - 4 - i]))),
+        FDK_mm_mulhi_epi32(zi, ldfb_x86_loadWin(&fb[N + N / 2 + i])));
+    ldfb_x86_storePCM(&output[i - N / 4], tmp0, rnd0, shift0);
+    ldfb_x86_storePCM(&output[N * 3 / 4 - 4 - i], ldfb_x86_reverse(tmp1), rnd1,
+                      shift1);
+
+    _mm_storeu_si128((__m128i *)&z[i], z0);
+    _mm_storeu_si128((__m128i *)&z[N + i], z2);
+  }
+  for (; i < N / 2; i++) {
+    FIXP_DBL z0, z2, tmp0, tmp1;
+
+    z2 = x[N / 2 + i];
+    z0 = z2 + (fMultDiv2(z[N / 2 + i], fb[2 * N + i]) >> (-WTS2 - 1));
+
+    z[N / 2 + i] = x[N / 2 - 1 - i] +
+                   (fMultDiv2(z[N + i], fb[2 * N + N / 2 + i]) >> (-WTS2 - 1));
+
+    tmp0 = (fMultDiv2(z[N / 2 + i], fb[N / 2 - 1 - i]) +
+            fMultDiv2(z[i], fb[N / 2 + i]));
+    tmp1 = (fMultDiv2(z[N / 2 + i], fb[N + N / 2 - 1 - i]) +
+            fMultDiv2(z[i], fb[N + N / 2 + i]));
+
+    output[(i - N / 4)] = (FIXP_PCM)SATURATE_RIGHT_SHIFT(
+        tmp0 + rnd_val_wts0, shift0, PCM_OUT_BITS);
+    output[(N * 3 / 4 - 1 - i)] = (FIXP_PCM)SATURATE_RIGHT_SHIFT(
+        tmp1 + rnd_val_wts1, shift1, PCM_OUT_BITS);
+
+    z[i] = z0;
+    z[N + i] = z2;
+  }
+
+  /* Exchange quarter parts of x to bring them in the "right" order */
+  i = 0;
+  for (; i + 4 <= N / 4; i += 4) {
+    __m128i tmp0 = FDK_mm_mulhi_epi32(_mm_loadu_si128((__m128i *)&z[i]),
+                                      ldfb_x86_loadWin(&fb[N / 2 + i]));
+    ldfb_x86_storePCM(&output[N * 3 / 4 + i], tmp0, rnd0, shift0);
+  }
+  for (; i < N / 4; i++) {
+    FIXP_DBL tmp0 = fMultDiv2(z[i], fb[N / 2 + i]);
+
+    output[(N * 3 / 4 + i)] = (FIXP_PCM)SATURATE_RIGHT_SHIFT(
+        tmp0 + rnd_val_wts0, shift0, PCM_OUT_BITS);
+  }
+}
+
+#endif /* FDK_X86_SSE2 */
@@ -0,0 +1,456 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/******************* Library for basic calculation routines ********************
+
+   Author(s):
+
+   Description: SSE2/AVX2 vector types for the x86 kernels
+
+*******************************************************************************/
+
+#if !defined(SIMD_X86_H)
+#define SIMD_X86_H
+
+#include "common_fix.h"
+
+/*
+  FIXP_DBL_V4 (SSE2) and FIXP_DBL_V8 (AVX2) hold 4 or 8 FIXP_DBL values and
+  provide the operators and fMult()/fMultDiv2() overloads used by the scalar
+  kernels, so the vector kernels can use the very same arithmetic and stay bit
+  exact. SSE2 is the x86-64 baseline and is used unconditionally, the AVX2 code
+  is compiled for that target only and selected at runtime with
+  FDK_x86_hasAVX2(). Define FDK_X86_NO_SIMD to build the generic C path or
+  FDK_X86_NO_AVX2 to build the SSE2 kernels only.
+*/
+
+#if defined(__x86__) && !defined(FDK_X86_NO_SIMD) &&                    \
+    (defined(__SSE2__) || defined(_M_X64) ||                             \
+     (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define FDK_X86_SSE2
+#endif
+
+#if defined(FDK_X86_SSE2)
+
+#include <emmintrin.h>
+
+#if !defined(FDK_X86_NO_AVX2) &&                                     \
+    (defined(__AVX2__) || defined(_MSC_VER) || defined(__clang__) || \
+     (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC_MINOR__ >= 9))))
+#define FDK_X86_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+/* Functions between FDK_X86_AVX2_BEGIN and FDK_X86_AVX2_END may use AVX2 */
+#if defined(FDK_X86_AVX2)
+#if defined(__AVX2__) || defined(_MSC_VER)
+#define FDK_X86_AVX2_BEGIN
+#define FDK_X86_AVX2_END
+#elif defined(__clang__)
+#define FDK_X86_AVX2_BEGIN                                                   \
+  _Pragma(                                                                   \
+      "clang attribute push(__attribute__((target(\"avx2\"))), apply_to = " \
+      "function)")
+#define FDK_X86_AVX2_END _Pragma("clang attribute pop")
+#else
+#define FDK_X86_AVX2_BEGIN \
+  _Pragma("GCC push_options") _Pragma("GCC target(\"avx2\")")
+#define FDK_X86_AVX2_END _Pragma("GCC pop_options")
+#endif
+#endif /* FDK_X86_AVX2 */
+
+/* #############################################################################
+ */
+
+static inline int FDK_x86_detectAVX2(void) {
+#if !defined(FDK_X86_AVX2)
+  return 0;
+#elif defined(__AVX2__)
+  return 1;
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) return 0;
+  __cpuid(info, 1);
+  /* OSXSAVE and AVX, then check that the OS saves the ymm registers */
+  if ((info[2] & 0x18000000) != 0x18000000) return 0;
+  if ((_xgetbv(0) & 6) != 6) return 0;
+  __cpuidex(info, 7, 0);
+  return (info[1] >> 5) & 1;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+}
+
+/* Result of the CPU detection, evaluated once */
+inline int FDK_x86_hasAVX2(void) {
+  static const int hasAVX2 = FDK_x86_detectAVX2();
+  return hasAVX2;
+}
+
+/* #############################################################################
+ */
+
+struct FIXP_DBL_V4 {
+  __m128i v;
+};
+
+static FDK_FORCEINLINE FIXP_DBL_V4 FIXP_DBL_V4_make(__m128i v) {
+  FIXP_DBL_V4 r;
+  r.v = v;
+  return r;
+}
+
+/* Signed 32x32 multiplication returning the upper 32 bits, i.e. the exact
+ * vector counterpart of fixmuldiv2_DD() */
+static FDK_FORCEINLINE __m128i FDK_mm_mulhi_epi32(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  __m128i even = _mm_srli_epi64(_mm_mul_epi32(a, b), 32);
+  __m128i odd = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_blend_epi16(even, odd, 0xCC);
+#else
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  __m128i hi =
+      _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 3, 1)),
+                         _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 3, 1)));
+  /* turn the unsigned high word into the signed one */
+  hi = _mm_sub_epi32(hi, _mm_and_si128(_mm_srai_epi32(a, 31), b));
+  hi = _mm_sub_epi32(hi, _mm_and_si128(_mm_srai_epi32(b, 31), a));
+  return hi;
+#endif
+}
+
+static FDK_FORCEINLINE FIXP_DBL_V4 operator+(FIXP_DBL_V4 a, FIXP_DBL_V4 b) {
+  return FIXP_DBL_V4_make(_mm_add_epi32(a.v, b.v));
+}
+static FDK_FORCEINLINE FIXP_DBL_V4 operator-(FIXP_DBL_V4 a, FIXP_DBL_V4 b) {
+  return FIXP_DBL_V4_make(_mm_sub_epi32(a.v, b.v));
+}
+static FDK_FORCEINLINE FIXP_DBL_V4 operator-(FIXP_DBL_V4 a) {
+  return FIXP_DBL_V4_make(_mm_sub_epi32(_mm_setzero_si128(), a.v));
+}
+static FDK_FORCEINLINE FIXP_DBL_V4 operator>>(FIXP_DBL_V4 a, int s) {
+  return FIXP_DBL_V4_make(_mm_srai_epi32(a.v, s));
+}
+static FDK_FORCEINLINE FIXP_DBL_V4 operator<<(FIXP_DBL_V4 a, int s) {
+  return FIXP_DBL_V4_make(_mm_slli_epi32(a.v, s));
+}
+static FDK_FORCEINLINE FIXP_DBL_V4 &operator+=(FIXP_DBL_V4 &a, FIXP_DBL_V4 b) {
+  a = a + b;
+  return a;
+}
+static FDK_FORCEINLINE FIXP_DBL_V4 &operator-=(FIXP_DBL_V4 &a, FIXP_DBL_V4 b) {
+  a = a - b;
+  return a;
+}
+
+static FDK_FORCEINLINE FIXP_DBL_V4 fMultDiv2(FIXP_DBL_V4 a, FIXP_DBL_V4 b) {
+  return FIXP_DBL_V4_make(FDK_mm_mulhi_epi32(a.v, b.v));
+}
+static FDK_FORCEINLINE FIXP_DBL_V4 fMultDiv2(FIXP_DBL_V4 a, FIXP_DBL b) {
+  return FIXP_DBL_V4_make(FDK_mm_mulhi_epi32(a.v, _mm_set1_epi32(b)));
+}
+static FDK_FORCEINLINE FIXP_DBL_V4 fMultDiv2(FIXP_DBL_V4 a, FIXP_SGL b) {
+  return fMultDiv2(a, FX_SGL2FX_DBL(b));
+}
+static FDK_FORCEINLINE FIXP_DBL_V4 fMult(FIXP_DBL_V4 a, FIXP_SGL b) {
+  return fMultDiv2(a, b) << 1;
+}
+
+static FDK_FORCEINLINE void cplxMultDiv2(FIXP_DBL_V4 *c_Re, FIXP_DBL_V4 *c_Im,
+                                         const FIXP_DBL_V4 a_Re,
+                                         const FIXP_DBL_V4 a_Im,
+                                         const FIXP_SPK w) {
+  *c_Re = fMultDiv2(a_Re, w.v.re) - fMultDiv2(a_Im, w.v.im);
+  *c_Im = fMultDiv2(a_Re, w.v.im) + fMultDiv2(a_Im, w.v.re);
+}
+
+static FDK_FORCEINLINE void cplxMultDiv2(FIXP_DBL_V4 *c_Re, FIXP_DBL_V4 *c_Im,
+                                         const FIXP_DBL_V4 a_Re,
+                                         const FIXP_DBL_V4 a_Im,
+                                         const FIXP_DBL_V4 b_Re,
+                                         const FIXP_DBL_V4 b_Im) {
+  *c_Re = fMultDiv2(a_Re, b_Re) - fMultDiv2(a_Im, b_Im);
+  *c_Im = fMultDiv2(a_Re, b_Im) + fMultDiv2(a_Im, b_Re);
+}
+
+/* lane 0 of b, lanes 1..3 of a */
+static FDK_FORCEINLINE FIXP_DBL_V4 vInsertLane0(FIXP_DBL_V4 a, FIXP_DBL_V4 b) {
+  return FIXP_DBL_V4_make(_mm_castps_si128(
+      _mm_move_ss(_mm_castsi128_ps(a.v), _mm_castsi128_ps(b.v))));
+}
+
+/* Load 4 interleaved complex values into a real and an imaginary vector */
+static FDK_FORCEINLINE void vLoadCplx(const FIXP_DBL *p, FIXP_DBL_V4 *re,
+                                      FIXP_DBL_V4 *im) {
+  __m128 a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)p));
+  __m128 b = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(p + 4)));
+  re->v = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+  im->v = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+/* Store a real and an imaginary vector as 4 interleaved complex values */
+static FDK_FORCEINLINE void vStoreCplx(FIXP_DBL *p, const FIXP_DBL_V4 re,
+                                       const FIXP_DBL_V4 im) {
+  _mm_storeu_si128((__m128i *)p, _mm_unpacklo_epi32(re.v, im.v));
+  _mm_storeu_si128((__m128i *)(p + 4), _mm_unpackhi_epi32(re.v, im.v));
+}
+
+/*
+  x[2*m] and x[2*m+1] (m = 0..3) hold the real and imaginary parts of the
+  complex elements m for each of the lanes. Store the 4 complex elements of lane
+  k interleaved at p + k * stride, for the first "lanes" lanes.
+*/
+static FDK_FORCEINLINE void vStoreCplxTransposed(FIXP_DBL *p, const int stride,
+                                                 const FIXP_DBL_V4 *x,
+                                                 const int lanes) {
+  __m128i t0, t1, t2, t3;
+  __m128i re[4], im[4];
+  int k;
+
+  t0 = _mm_unpacklo_epi32(x[0].v, x[2].v);
+  t1 = _mm_unpacklo_epi32(x[4].v, x[6].v);
+  t2 = _mm_unpackhi_epi32(x[0].v, x[2].v);
+  t3 = _mm_unpackhi_epi32(x[4].v, x[6].v);
+  re[0] = _mm_unpacklo_epi64(t0, t1);
+  re[1] = _mm_unpackhi_epi64(t0, t1);
+  re[2] = _mm_unpacklo_epi64(t2, t3);
+  re[3] = _mm_unpackhi_epi64(t2, t3);
+
+  t0 = _mm_unpacklo_epi32(x[1].v, x[3].v);
+  t1 = _mm_unpacklo_epi32(x[5].v, x[7].v);
+  t2 = _mm_unpackhi_epi32(x[1].v, x[3].v);
+  t3 = _mm_unpackhi_epi32(x[5].v, x[7].v);
+  im[0] = _mm_unpacklo_epi64(t0, t1);
+  im[1] = _mm_unpackhi_epi64(t0, t1);
+  im[2] = _mm_unpacklo_epi64(t2, t3);
+  im[3] = _mm_unpackhi_epi64(t2, t3);
+
+  for (k = 0; k < lanes; k++) {
+    vStoreCplx(p + k * stride, FIXP_DBL_V4_make(re[k]),
+               FIXP_DBL_V4_make(im[k]));
+  }
+}
+
+/* #############################################################################
+ */
+
+#if defined(FDK_X86_AVX2)
+FDK_X86_AVX2_BEGIN
+
+struct FIXP_DBL_V8 {
+  __m256i v;
+};
+
+static FDK_FORCEINLINE FIXP_DBL_V8 FIXP_DBL_V8_make(__m256i v) {
+  FIXP_DBL_V8 r;
+  r.v = v;
+  return r;
+}
+
+static FDK_FORCEINLINE __m256i FDK_mm256_mulhi_epi32(__m256i a, __m256i b) {
+  __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(a, b), 32);
+  __m256i odd =
+      _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+  return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+static FDK_FORCEINLINE FIXP_DBL_V8 operator+(FIXP_DBL_V8 a, FIXP_DBL_V8 b) {
+  return FIXP_DBL_V8_make(_mm256_add_epi32(a.v, b.v));
+}
+static FDK_FORCEINLINE FIXP_DBL_V8 operator-(FIXP_DBL_V8 a, FIXP_DBL_V8 b) {
+  return FIXP_DBL_V8_make(_mm256_sub_epi32(a.v, b.v));
+}
+static FDK_FORCEINLINE FIXP_DBL_V8 operator-(FIXP_DBL_V8 a) {
+  return FIXP_DBL_V8_make(_mm256_sub_epi32(_mm256_setzero_si256(), a.v));
+}
+static FDK_FORCEINLINE FIXP_DBL_V8 operator>>(FIXP_DBL_V8 a, int s) {
+  return FIXP_DBL_V8_make(_mm256_srai_epi32(a.v, s));
+}
+static FDK_FORCEINLINE FIXP_DBL_V8 operator<<(FIXP_DBL_V8 a, int s) {
+  return FIXP_DBL_V8_make(_mm256_slli_epi32(a.v, s));
+}
+static FDK_FORCEINLINE FIXP_DBL_V8 &operator+=(FIXP_DBL_V8 &a, FIXP_DBL_V8 b) {
+  a = a + b;
+  return a;
+}
+static FDK_FORCEINLINE FIXP_DBL_V8 &operator-=(FIXP_DBL_V8 &a, FIXP_DBL_V8 b) {
+  a = a - b;
+  return a;
+}
+
+static FDK_FORCEINLINE FIXP_DBL_V8 fMultDiv2(FIXP_DBL_V8 a, FIXP_DBL_V8 b) {
+  return FIXP_DBL_V8_make(FDK_mm256_mulhi_epi32(a.v, b.v));
+}
+static FDK_FORCEINLINE FIXP_DBL_V8 fMultDiv2(FIXP_DBL_V8 a, FIXP_DBL b) {
+  return FIXP_DBL_V8_make(FDK_mm256_mulhi_epi32(a.v, _mm256_set1_epi32(b)));
+}
+static FDK_FORCEINLINE FIXP_DBL_V8 fMultDiv2(FIXP_DBL_V8 a, FIXP_SGL b) {
+  return fMultDiv2(a, FX_SGL2FX_DBL(b));
+}
+static FDK_FORCEINLINE FIXP_DBL_V8 fMult(FIXP_DBL_V8 a, FIXP_SGL b) {
+  return fMultDiv2(a, b) << 1;
+}
+
+static FDK_FORCEINLINE void cplxMultDiv2(FIXP_DBL_V8 *c_Re, FIXP_DBL_V8 *c_Im,
+                                         const FIXP_DBL_V8 a_Re,
+                                         const FIXP_DBL_V8 a_Im,
+                                         const FIXP_SPK w) {
+  *c_Re = fMultDiv2(a_Re, w.v.re) - fMultDiv2(a_Im, w.v.im);
+  *c_Im = fMultDiv2(a_Re, w.v.im) + fMultDiv2(a_Im, w.v.re);
+}
+
+static FDK_FORCEINLINE void cplxMultDiv2(FIXP_DBL_V8 *c_Re, FIXP_DBL_V8 *c_Im,
+                                         const FIXP_DBL_V8 a_Re,
+                                         const FIXP_DBL_V8 a_Im,
+                                         const FIXP_DBL_V8 b_Re,
+                                         const FIXP_DBL_V8 b_Im) {
+  *c_Re = fMultDiv2(a_Re, b_Re) - fMultDiv2(a_Im, b_Im);
+  *c_Im = fMultDiv2(a_Re, b_Im) + fMultDiv2(a_Im, b_Re);
+}
+
+static FDK_FORCEINLINE FIXP_DBL_V8 vInsertLane0(FIXP_DBL_V8 a, FIXP_DBL_V8 b) {
+  return FIXP_DBL_V8_make(_mm256_blend_epi32(a.v, b.v, 0x01));
+}
+
+static FDK_FORCEINLINE void vLoadCplx(const FIXP_DBL *p, FIXP_DBL_V8 *re,
+                                      FIXP_DBL_V8 *im) {
+  __m256 a = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)p));
+  __m256 b = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)(p + 8)));
+  /* shuffle_ps works per 128 bit lane, fix the order of the 64 bit pairs */
+  re->v = _mm256_permute4x64_epi64(
+      _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))),
+      _MM_SHUFFLE(3, 1, 2, 0));
+  im->v = _mm256_permute4x64_epi64(
+      _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))),
+      _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+static FDK_FORCEINLINE void vStoreCplx(FIXP_DBL *p, const FIXP_DBL_V8 re,
+                                       const FIXP_DBL_V8 im) {
+  __m256i lo = _mm256_unpacklo_epi32(re.v, im.v);
+  __m256i hi = _mm256_unpackhi_epi32(re.v, im.v);
+  _mm256_storeu_si256((__m256i *)p, _mm256_permute2x128_si256(lo, hi, 0x20));
+  _mm256_storeu_si256((__m256i *)(p + 8),
+                      _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+/* Same as the FIXP_DBL_V4 version, done as two halves of 4 lanes */
+static FDK_FORCEINLINE void vStoreCplxTransposed(FIXP_DBL *p, const int stride,
+                                                 const FIXP_DBL_V8 *x,
+                                                 const int lanes) {
+  FIXP_DBL_V4 lo[8], hi[8];
+  int m;
+
+  for (m = 0; m < 8; m++) {
+    lo[m].v = _mm256_castsi256_si128(x[m].v);
+    hi[m].v = _mm256_extracti128_si256(x[m].v, 1);
+  }
+  vStoreCplxTransposed(p, stride, lo, (lanes < 4) ? lanes : 4);
+  if (lanes > 4) {
+    vStoreCplxTransposed(p + 4 * stride, stride, hi, lanes - 4);
+  }
+}
+
+FDK_X86_AVX2_END
+#endif /* FDK_X86_AVX2 */
+
+#endif /* FDK_X86_SSE2 */
+
+#endif /* !defined(SIMD_X86_H) */
@@ -1776,6 +1776,10 @@ static inline void fft192(FIXP_DBL *pInput) {
 }
 #endif
 
+#if defined(__x86__)
+#include "x86/fft_x86.cpp"
+#endif
+
 #ifndef FUNCTION_fft240
 static inline void fft240(FIXP_DBL *pInput) {
   fftN2(FIXP_DBL, pInput, 240, 16, 15, fft_16, fft15, RotVectorReal240,
@@ -0,0 +1,252 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/******************* Library for basic calculation routines ********************
+
+   Author(s):
+
+   Description: dct_IV() pre and post twiddling for x86 with SSE2
+
+*******************************************************************************/
+
+#include "x86/simd_x86.h"
+
+#if defined(FDK_X86_SSE2)
+
+#define FUNCTION_dct_IV_func1
+#define FUNCTION_dct_IV_func2
+
+/* Real and imaginary part of 4 packed FIXP_SPK values as FIXP_DBL */
+static FDK_FORCEINLINE void dct_x86_splitTwiddle(__m128i w, FIXP_DBL_V4 *re,
+                                                 FIXP_DBL_V4 *im) {
+  re->v = _mm_slli_epi32(w, 16);
+  im->v = _mm_and_si128(w, _mm_set1_epi32((INT)0xFFFF0000));
+}
+
+static FDK_FORCEINLINE FIXP_DBL_V4 dct_x86_reverse(FIXP_DBL_V4 a) {
+  return FIXP_DBL_V4_make(_mm_shuffle_epi32(a.v, _MM_SHUFFLE(0, 1, 2, 3)));
+}
+
+/*
+  Pre twiddling of dct_IV(), same as the generic loop: i is M / 4, pDat_0 points
+  to pDat[0] and pDat_1 to pDat[L - 1]. Each vector iteration covers 4 pairs
+  from both ends of pDat.
+*/
+static void dct_IV_func1(int i, const FIXP_SPK *twiddle,
+                         FIXP_DBL *RESTRICT pDat_0, FIXP_DBL *RESTRICT pDat_1) {
+  int k;
+  const int n = i << 1; /* number of pairs */
+
+  pDat_1 -= 1; /* pDat[L - 2] */
+
+  for (k = 0; k + 4 <= n; k += 4) {
+    FIXP_DBL_V4 a1, a2, a3, a4, w0re, w0im, w1re, w1im;
+    FIXP_DBL_V4 accu1, accu2, accu3, accu4;
+    FIXP_DBL_V4 w0, w1;
+
+    vLoadCplx(&pDat_0[2 * k], &a2, &a3);
+    vLoadCplx(&pDat_1[-2 * (k + 3)], &a4, &a1);
+    a4 = dct_x86_reverse(a4);
+    a1 = dct_x86_reverse(a1);
+
+    vLoadCplx((const FIXP_DBL *)&twiddle[2 * k], &w0, &w1);
+    dct_x86_splitTwiddle(w0.v, &w0re, &w0im);
+    dct_x86_splitTwiddle(w1.v, &w1re, &w1im);
+
+    cplxMultDiv2(&accu1, &accu2, a1, a2, w0re, w0im);
+    cplxMultDiv2(&accu3, &accu4, a4, a3, w1re, w1im);
+
+    vStoreCplx(&pDat_0[2 * k], accu2, accu1);
+    vStoreCplx(&pDat_1[-2 * (k + 3)], dct_x86_reverse(accu4),
+               dct_x86_reverse(-accu3));
+  }
+
+  for (; k < n; k++) {
+    FIXP_DBL accu1, accu2, accu3, accu4;
+
+    accu1 = pDat_1[-2 * k + 1];
+    accu2 = pDat_0[2 * k];
+    accu3 = pDat_0[2 * k + 1];
+    accu4 = pDat_1[-2 * k];
+
+    cplxMultDiv2(&accu1, &accu2, accu1, accu2, twiddle[2 * k]);
+    cplxMultDiv2(&accu3, &accu4, accu4, accu3, twiddle[2 * k + 1]);
+
+    pDat_0[2 * k] = accu2;
+    pDat_0[2 * k + 1] = accu1;
+    pDat_1[-2 * k] = accu4;
+    pDat_1[-2 * k + 1] = -accu3;
+  }
+}
+
+/*
+  Post twiddling of dct_IV(), same as the generic loop: i is M / 4, pDat_0
+  points to pDat[0] and pDat_1 to pDat[L]. The generic loop carries two values
+  of the upper half into the next iteration, so the vector loop reads the upper
+  half of the next 4 iterations before it stores the current ones.
+*/
+static void dct_IV_func2(int i, const FIXP_SPK *twiddle,
+                         FIXP_DBL *RESTRICT pDat_0, FIXP_DBL *RESTRICT pDat_1,
+                         int inc) {
+  FIXP_DBL *RESTRICT pDat = pDat_0;
+  const int M = i << 2;
+  const int L = (int)(pDat_1 - pDat_0);
+  const FIXP_DBL dat0 = pDat[0], dat1 = pDat[1];
+  FIXP_DBL accu1, accu2, accu3, accu4;
+  FIXP_DBL_V4 hre, him;
+  int k = 1;
+
+  /* Sin and Cos values are 0.0f and 1.0f, stored at the end */
+  accu1 = pDat[L - 2];
+  accu2 = pDat[L - 1];
+
+  if (k + 4 <= (M >> 1)) {
+    vLoadCplx(&pDat[L - 2 * (k + 3)], &hre, &him);
+  }
+  for (; k + 4 <= (M >> 1); k += 4) {
+    FIXP_DBL_V4 lre, lim, are, aim, wre, wim;
+    FIXP_DBL_V4 x1, x2, y1, y2;
+
+    dct_x86_splitTwiddle(
+        _mm_set_epi32(twiddle[(k + 3) * inc].w, twiddle[(k + 2) * inc].w,
+                      twiddle[(k + 1) * inc].w, twiddle[k * inc].w),
+        &wre, &wim);
+
+    vLoadCplx(&pDat[2 * k], &lre, &lim);
+    are = dct_x86_reverse(hre);
+    aim = dct_x86_reverse(him);
+
+    cplxMultDiv2(&x1, &x2, are, aim, wre, wim);
+    cplxMultDiv2(&y1, &y2, lim, lre, wre, wim);
+
+    /* upper half of the next iterations, before it is overwritten */
+    accu1 = pDat[L - 2 * (k + 4)];
+    accu2 = pDat[L - 2 * (k + 4) + 1];
+    if (k + 8 <= (M >> 1)) {
+      vLoadCplx(&pDat[L - 2 * (k + 7)], &hre, &him);
+    }
+
+    vStoreCplx(&pDat[2 * k - 1], x1, y2);
+    vStoreCplx(&pDat[L - 1 - 2 * (k + 3)], dct_x86_reverse(-y1),
+               dct_x86_reverse(x2));
+  }
+
+  for (; k < (M >> 1); k++) {
+    FIXP_SPK twd = twiddle[k * inc];
+
+    cplxMultDiv2(&accu3, &accu4, accu1, accu2, twd);
+    pDat[2 * k - 1] = accu3;
+    pDat[L - 2 * k] = accu4;
+
+    cplxMultDiv2(&accu3, &accu4, pDat[2 * k + 1], pDat[2 * k], twd);
+
+    accu1 = pDat[L - 2 - 2 * k];
+    accu2 = pDat[L - 1 - 2 * k];
+
+    pDat[L - 1 - 2 * k] = -accu3;
+    pDat[2 * k] = accu4;
+  }
+
+  /* Last Sin and Cos value pair are the same */
+  accu1 = fMultDiv2(accu1, WTC(0x5a82799a));
+  accu2 = fMultDiv2(accu2, WTC(0x5a82799a));
+
+  pDat[M] = accu1 + accu2;
+  pDat[M - 1] = accu1 - accu2;
+
+  pDat[L - 1] = -(dat1 >> 1);
+  pDat[0] = (dat0 >> 1);
+}
+
+#endif /* FDK_X86_SSE2 */
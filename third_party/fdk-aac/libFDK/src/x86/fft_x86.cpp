@@ -0,0 +1,165 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/******************* Library for basic calculation routines ********************
+
+   Author(s):
+
+   Description: FFT for x86 with SSE2/AVX2
+
+*******************************************************************************/
+
+#include "x86/simd_x86.h"
+
+#if defined(FDK_X86_SSE2)
+
+/* Rotation vector of fft240 for the vector lanes: w[e - 1][2 * t] and
+ * w[e - 1][2 * t + 1] are the real and imaginary twiddle of element e in column
+ * t, zero for column 0 and the unused column 15 */
+typedef struct {
+  FIXP_DBL w[15][2 * 16];
+} FFT240_ROT_X86;
+
+static FFT240_ROT_X86 fft240_initRot(void) {
+  FFT240_ROT_X86 rot;
+  int t, e;
+
+  for (e = 1; e < 16; e++) {
+    for (t = 0; t < 16; t++) {
+      FIXP_DBL re = (FIXP_DBL)0, im = (FIXP_DBL)0;
+      if ((t > 0) && (t < 15)) {
+        re = FX_SGL2FX_DBL(RotVectorReal240[(t - 1) * 15 + (e - 1)]);
+        im = FX_SGL2FX_DBL(RotVectorImag240[(t - 1) * 15 + (e - 1)]);
+      }
+      rot.w[e - 1][2 * t] = re;
+      rot.w[e - 1][2 * t + 1] = im;
+    }
+  }
+  return rot;
+}
+
+static const FIXP_DBL (*fft240_getRot(void))[2 * 16] {
+  static const FFT240_ROT_X86 rot = fft240_initRot();
+  return rot.w;
+}
+
+namespace fft_x86_sse2 {
+typedef FIXP_DBL_V4 VEC;
+#include "fft_x86_vec.cpp"
+}  // namespace fft_x86_sse2
+
+#if defined(FDK_X86_AVX2)
+FDK_X86_AVX2_BEGIN
+namespace fft_x86_avx2 {
+typedef FIXP_DBL_V8 VEC;
+#include "fft_x86_vec.cpp"
+}  // namespace fft_x86_avx2
+FDK_X86_AVX2_END
+#endif /* FDK_X86_AVX2 */
+
+#define FUNCTION_fft240
+static inline void fft240(FIXP_DBL *pInput) {
+  C_AALLOC_SCRATCH_START(aDst, FIXP_DBL, 2 * 240)
+#if defined(FDK_X86_AVX2)
+  if (FDK_x86_hasAVX2()) {
+    fft_x86_avx2::fft240_vec(pInput, aDst, fft240_getRot());
+  } else
+#endif
+  {
+    fft_x86_sse2::fft240_vec(pInput, aDst, fft240_getRot());
+  }
+  C_AALLOC_SCRATCH_END(aDst, FIXP_DBL, 2 * 240)
+}
+
+#endif /* FDK_X86_SSE2 */
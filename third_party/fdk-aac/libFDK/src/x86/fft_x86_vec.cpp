@@ -0,0 +1,614 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/******************* Library for basic calculation routines ********************
+
+   Author(s):
+
+   Description: FFT kernels on FIXP_DBL vectors
+
+*******************************************************************************/
+
+/*
+  This file is included by fft_x86.cpp once per vector type VEC. The transforms
+  are copies of fft5(), fft15() and fft_16() from fft.cpp where every lane of
+  VEC computes an independent transform, with the same operations and therefore
+  bit exact results.
+*/
+
+#ifndef SUMDIFF_PIFOURTH_VEC
+#define SUMDIFF_PIFOURTH_VEC(diff, sum, a, b) \
+  {                                           \
+    VEC wa, wb;                               \
+    wa = fMultDiv2(a, W_PiFOURTH);            \
+    wb = fMultDiv2(b, W_PiFOURTH);            \
+    diff = wb - wa;                           \
+    sum = wb + wa;                            \
+  }
+#endif
+
+/* performs the FFT of length 5 according to the algorithm after winograd */
+static FDK_FORCEINLINE void fft5_vec(VEC *RESTRICT pDat) {
+  VEC r1, r2, r3, r4;
+  VEC s1, s2, s3, s4;
+  VEC t;
+
+  /* real part */
+  r1 = (pDat[2] + pDat[8]) >> 1;
+  r4 = (pDat[2] - pDat[8]) >> 1;
+  r3 = (pDat[4] + pDat[6]) >> 1;
+  r2 = (pDat[4] - pDat[6]) >> 1;
+  t = fMult((r1 - r3), C54);
+  r1 = r1 + r3;
+  pDat[0] = (pDat[0] >> 1) + r1;
+  /* Bit shift left because of the constant C55 which was scaled with the factor
+     0.5 because of the representation of the values as fracts */
+  r1 = pDat[0] + (fMultDiv2(r1, C55) << (2));
+  r3 = r1 - t;
+  r1 = r1 + t;
+  t = fMult((r4 + r2), C51);
+  /* Bit shift left because of the constant C55 which was scaled with the factor
+     0.5 because of the representation of the values as fracts */
+  r4 = t + (fMultDiv2(r4, C52) << (2));
+  r2 = t + fMult(r2, C53);
+
+  /* imaginary part */
+  s1 = (pDat[3] + pDat[9]) >> 1;
+  s4 = (pDat[3] - pDat[9]) >> 1;
+  s3 = (pDat[5] + pDat[7]) >> 1;
+  s2 = (pDat[5] - pDat[7]) >> 1;
+  t = fMult((s1 - s3), C54);
+  s1 = s1 + s3;
+  pDat[1] = (pDat[1] >> 1) + s1;
+  /* Bit shift left because of the constant C55 which was scaled with the factor
+     0.5 because of the representation of the values as fracts */
+  s1 = pDat[1] + (fMultDiv2(s1, C55) << (2));
+  s3 = s1 - t;
+  s1 = s1 + t;
+  t = fMult((s4 + s2), C51);
+  /* Bit shift left because of the constant C55 which was scaled with the factor
+     0.5 because of the representation of the values as fracts */
+  s4 = t + (fMultDiv2(s4, C52) << (2));
+  s2 = t + fMult(s2, C53);
+
+  /* combination */
+  pDat[2] = r1 + s2;
+  pDat[8] = r1 - s2;
+  pDat[4] = r3 - s4;
+  pDat[6] = r3 + s4;
+
+  pDat[3] = s1 - r2;
+  pDat[9] = s1 + r2;
+  pDat[5] = s3 + r4;
+  pDat[7] = s3 - r4;
+}
+
+/* Performs the FFT of length 15. It is split into FFTs of length 3 and
+ * length 5. */
+static FDK_FORCEINLINE void fft15_vec(VEC *pInput) {
+  VEC aDst[2 * N15];
+  VEC aDst1[2 * N15];
+  int i, k, l;
+
+  /* Sort input vector for fft's of length 3
+  input3(0:2)   = [input(0) input(5) input(10)];
+  input3(3:5)   = [input(3) input(8) input(13)];
+  input3(6:8)   = [input(6) input(11) input(1)];
+  input3(9:11)  = [input(9) input(14) input(4)];
+  input3(12:14) = [input(12) input(2) input(7)]; */
+  {
+    const VEC *pSrc = pInput;
+    VEC *RESTRICT pDst = aDst;
+    /* Merge 3 loops into one, skip call of fft3 */
+    for (i = 0, l = 0, k = 0; i < N5; i++, k += 6) {
+      pDst[k + 0] = pSrc[l];
+      pDst[k + 1] = pSrc[l + 1];
+      l += 2 * N5;
+      if (l >= (2 * N15)) l -= (2 * N15);
+
+      pDst[k + 2] = pSrc[l];
+      pDst[k + 3] = pSrc[l + 1];
+      l += 2 * N5;
+      if (l >= (2 * N15)) l -= (2 * N15);
+      pDst[k + 4] = pSrc[l];
+      pDst[k + 5] = pSrc[l + 1];
+      l += (2 * N5) + (2 * N3);
+      if (l >= (2 * N15)) l -= (2 * N15);
+
+      /* fft3 merged with shift right by 2 loop */
+      VEC r1, r2, r3;
+      VEC s1, s2;
+      /* real part */
+      r1 = pDst[k + 2] + pDst[k + 4];
+      r2 = fMult((pDst[k + 2] - pDst[k + 4]), C31);
+      s1 = pDst[k + 0];
+      pDst[k + 0] = (s1 + r1) >> 2;
+      r1 = s1 - (r1 >> 1);
+
+      /* imaginary part */
+      s1 = pDst[k + 3] + pDst[k + 5];
+      s2 = fMult((pDst[k + 3] - pDst[k + 5]), C31);
+      r3 = pDst[k + 1];
+      pDst[k + 1] = (r3 + s1) >> 2;
+      s1 = r3 - (s1 >> 1);
+
+      /* combination */
+      pDst[k + 2] = (r1 - s2) >> 2;
+      pDst[k + 4] = (r1 + s2) >> 2;
+      pDst[k + 3] = (s1 + r2) >> 2;
+      pDst[k + 5] = (s1 - r2) >> 2;
+    }
+  }
+  /* Sort input vector for fft's of length 5
+  input5(0:4)   = [output3(0) output3(3) output3(6) output3(9) output3(12)];
+  input5(5:9)   = [output3(1) output3(4) output3(7) output3(10) output3(13)];
+  input5(10:14) = [output3(2) output3(5) output3(8) output3(11) output3(14)]; */
+  /* Merge 2 loops into one, brings about 10% */
+  {
+    const VEC *pSrc = aDst;
+    VEC *RESTRICT pDst = aDst1;
+    for (i = 0, l = 0, k = 0; i < N3; i++, k += 10) {
+      l = 2 * i;
+      pDst[k + 0] = pSrc[l + 0];
+      pDst[k + 1] = pSrc[l + 1];
+      pDst[k + 2] = pSrc[l + 0 + (2 * N3)];
+      pDst[k + 3] = pSrc[l + 1 + (2 * N3)];
+      pDst[k + 4] = pSrc[l + 0 + (4 * N3)];
+      pDst[k + 5] = pSrc[l + 1 + (4 * N3)];
+      pDst[k + 6] = pSrc[l + 0 + (6 * N3)];
+      pDst[k + 7] = pSrc[l + 1 + (6 * N3)];
+      pDst[k + 8] = pSrc[l + 0 + (8 * N3)];
+      pDst[k + 9] = pSrc[l + 1 + (8 * N3)];
+      fft5_vec(&pDst[k]);
+    }
+  }
+  /* Sort output vector of length 15
+  output = [out5(0)  out5(6)  out5(12) out5(3)  out5(9)
+            out5(10) out5(1)  out5(7)  out5(13) out5(4)
+            out5(5)  out5(11) out5(2)  out5(8)  out5(14)]; */
+  /* optimize clumsy loop, brings about 5% */
+  {
+    const VEC *pSrc = aDst1;
+    VEC *RESTRICT pDst = pInput;
+    for (i = 0, l = 0, k = 0; i < N3; i++, k += 10) {
+      pDst[k + 0] = pSrc[l];
+      pDst[k + 1] = pSrc[l + 1];
+      l += (2 * N6);
+      if (l >= (2 * N15)) l -= (2 * N15);
+      pDst[k + 2] = pSrc[l];
+      pDst[k + 3] = pSrc[l + 1];
+      l += (2 * N6);
+      if (l >= (2 * N15)) l -= (2 * N15);
+      pDst[k + 4] = pSrc[l];
+      pDst[k + 5] = pSrc[l + 1];
+      l += (2 * N6);
+      if (l >= (2 * N15)) l -= (2 * N15);
+      pDst[k + 6] = pSrc[l];
+      pDst[k + 7] = pSrc[l + 1];
+      l += (2 * N6);
+      if (l >= (2 * N15)) l -= (2 * N15);
+      pDst[k + 8] = pSrc[l];
+      pDst[k + 9] = pSrc[l + 1];
+      l += 2; /* no modulo check needed, it cannot occur */
+    }
+  }
+}
+
+static FDK_FORCEINLINE void fft_16_vec(VEC *RESTRICT x) {
+  VEC vr, ur;
+  VEC vr2, ur2;
+  VEC vr3, ur3;
+  VEC vr4, ur4;
+  VEC vi, ui;
+  VEC vi2, ui2;
+  VEC vi3, ui3;
+
+  vr = (x[0] >> 1) + (x[16] >> 1);       /* Re A + Re B */
+  ur = (x[1] >> 1) + (x[17] >> 1);       /* Im A + Im B */
+  vi = (x[8] SHIFT_A) + (x[24] SHIFT_A); /* Re C + Re D */
+  ui = (x[9] SHIFT_A) + (x[25] SHIFT_A); /* Im C + Im D */
+  x[0] = vr + (vi SHIFT_B);              /* Re A' = ReA + ReB +ReC + ReD */
+  x[1] = ur + (ui SHIFT_B);              /* Im A' = sum of imag values */
+
+  vr2 = (x[4] >> 1) + (x[20] >> 1); /* Re A + Re B */
+  ur2 = (x[5] >> 1) + (x[21] >> 1); /* Im A + Im B */
+
+  x[4] = vr - (vi SHIFT_B); /* Re C' = -(ReC+ReD) + (ReA+ReB) */
+  x[5] = ur - (ui SHIFT_B); /* Im C' = -Im C -Im D +Im A +Im B */
+  vr -= x[16];              /* Re A - Re B */
+  vi = (vi SHIFT_B)-x[24];  /* Re C - Re D */
+  ur -= x[17];              /* Im A - Im B */
+  ui = (ui SHIFT_B)-x[25];  /* Im C - Im D */
+
+  vr3 = (x[2] >> 1) + (x[18] >> 1); /* Re A + Re B */
+  ur3 = (x[3] >> 1) + (x[19] >> 1); /* Im A + Im B */
+
+  x[2] = ui + vr; /* Re B' = Im C - Im D  + Re A - Re B */
+  x[3] = ur - vi; /* Im B'= -Re C + Re D + Im A - Im B */
+
+  vr4 = (x[6] >> 1) + (x[22] >> 1); /* Re A + Re B */
+  ur4 = (x[7] >> 1) + (x[23] >> 1); /* Im A + Im B */
+
+  x[6] = vr - ui; /* Re D' = -Im C + Im D + Re A - Re B */
+  x[7] = vi + ur; /* Im D'= Re C - Re D + Im A - Im B */
+
+  vi2 = (x[12] SHIFT_A) + (x[28] SHIFT_A); /* Re C + Re D */
+  ui2 = (x[13] SHIFT_A) + (x[29] SHIFT_A); /* Im C + Im D */
+  x[8] = vr2 + (vi2 SHIFT_B);              /* Re A' = ReA + ReB +ReC + ReD */
+  x[9] = ur2 + (ui2 SHIFT_B);              /* Im A' = sum of imag values */
+  x[12] = vr2 - (vi2 SHIFT_B);             /* Re C' = -(ReC+ReD) + (ReA+ReB) */
+  x[13] = ur2 - (ui2 SHIFT_B);             /* Im C' = -Im C -Im D +Im A +Im B */
+  vr2 -= x[20];                            /* Re A - Re B */
+  ur2 -= x[21];                            /* Im A - Im B */
+  vi2 = (vi2 SHIFT_B)-x[28];               /* Re C - Re D */
+  ui2 = (ui2 SHIFT_B)-x[29];               /* Im C - Im D */
+
+  vi = (x[10] SHIFT_A) + (x[26] SHIFT_A); /* Re C + Re D */
+  ui = (x[11] SHIFT_A) + (x[27] SHIFT_A); /* Im C + Im D */
+
+  x[10] = ui2 + vr2; /* Re B' = Im C - Im D  + Re A - Re B */
+  x[11] = ur2 - vi2; /* Im B'= -Re C + Re D + Im A - Im B */
+
+  vi3 = (x[14] SHIFT_A) + (x[30] SHIFT_A); /* Re C + Re D */
+  ui3 = (x[15] SHIFT_A) + (x[31] SHIFT_A); /* Im C + Im D */
+
+  x[14] = vr2 - ui2; /* Re D' = -Im C + Im D + Re A - Re B */
+  x[15] = vi2 + ur2; /* Im D'= Re C - Re D + Im A - Im B */
+
+  x[16] = vr3 + (vi SHIFT_B); /* Re A' = ReA + ReB +ReC + ReD */
+  x[17] = ur3 + (ui SHIFT_B); /* Im A' = sum of imag values */
+  x[20] = vr3 - (vi SHIFT_B); /* Re C' = -(ReC+ReD) + (ReA+ReB) */
+  x[21] = ur3 - (ui SHIFT_B); /* Im C' = -Im C -Im D +Im A +Im B */
+  vr3 -= x[18];               /* Re A - Re B */
+  ur3 -= x[19];               /* Im A - Im B */
+  vi = (vi SHIFT_B)-x[26];    /* Re C - Re D */
+  ui = (ui SHIFT_B)-x[27];    /* Im C - Im D */
+  x[18] = ui + vr3;           /* Re B' = Im C - Im D  + Re A - Re B */
+  x[19] = ur3 - vi;           /* Im B'= -Re C + Re D + Im A - Im B */
+
+  x[24] = vr4 + (vi3 SHIFT_B); /* Re A' = ReA + ReB +ReC + ReD */
+  x[28] = vr4 - (vi3 SHIFT_B); /* Re C' = -(ReC+ReD) + (ReA+ReB) */
+  x[25] = ur4 + (ui3 SHIFT_B); /* Im A' = sum of imag values */
+  x[29] = ur4 - (ui3 SHIFT_B); /* Im C' = -Im C -Im D +Im A +Im B */
+  vr4 -= x[22];                /* Re A - Re B */
+  ur4 -= x[23];                /* Im A - Im B */
+
+  x[22] = vr3 - ui; /* Re D' = -Im C + Im D + Re A - Re B */
+  x[23] = vi + ur3; /* Im D'= Re C - Re D + Im A - Im B */
+
+  vi3 = (vi3 SHIFT_B)-x[30]; /* Re C - Re D */
+  ui3 = (ui3 SHIFT_B)-x[31]; /* Im C - Im D */
+  x[26] = ui3 + vr4;         /* Re B' = Im C - Im D  + Re A - Re B */
+  x[30] = vr4 - ui3;         /* Re D' = -Im C + Im D + Re A - Re B */
+  x[27] = ur4 - vi3;         /* Im B'= -Re C + Re D + Im A - Im B */
+  x[31] = vi3 + ur4;         /* Im D'= Re C - Re D + Im A - Im B */
+
+  // xt1 =  0
+  // xt2 =  8
+  vr = x[8];
+  vi = x[9];
+  ur = x[0] >> 1;
+  ui = x[1] >> 1;
+  x[0] = ur + (vr >> 1);
+  x[1] = ui + (vi >> 1);
+  x[8] = ur - (vr >> 1);
+  x[9] = ui - (vi >> 1);
+
+  // xt1 =  4
+  // xt2 = 12
+  vr = x[13];
+  vi = x[12];
+  ur = x[4] >> 1;
+  ui = x[5] >> 1;
+  x[4] = ur + (vr >> 1);
+  x[5] = ui - (vi >> 1);
+  x[12] = ur - (vr >> 1);
+  x[13] = ui + (vi >> 1);
+
+  // xt1 = 16
+  // xt2 = 24
+  vr = x[24];
+  vi = x[25];
+  ur = x[16] >> 1;
+  ui = x[17] >> 1;
+  x[16] = ur + (vr >> 1);
+  x[17] = ui + (vi >> 1);
+  x[24] = ur - (vr >> 1);
+  x[25] = ui - (vi >> 1);
+
+  // xt1 = 20
+  // xt2 = 28
+  vr = x[29];
+  vi = x[28];
+  ur = x[20] >> 1;
+  ui = x[21] >> 1;
+  x[20] = ur + (vr >> 1);
+  x[21] = ui - (vi >> 1);
+  x[28] = ur - (vr >> 1);
+  x[29] = ui + (vi >> 1);
+
+  // xt1 =  2
+  // xt2 = 10
+  SUMDIFF_PIFOURTH_VEC(vi, vr, x[10], x[11])
+  // vr = fMultDiv2((x[11] + x[10]),W_PiFOURTH);
+  // vi = fMultDiv2((x[11] - x[10]),W_PiFOURTH);
+  ur = x[2];
+  ui = x[3];
+  x[2] = (ur >> 1) + vr;
+  x[3] = (ui >> 1) + vi;
+  x[10] = (ur >> 1) - vr;
+  x[11] = (ui >> 1) - vi;
+
+  // xt1 =  6
+  // xt2 = 14
+  SUMDIFF_PIFOURTH_VEC(vr, vi, x[14], x[15])
+  ur = x[6];
+  ui = x[7];
+  x[6] = (ur >> 1) + vr;
+  x[7] = (ui >> 1) - vi;
+  x[14] = (ur >> 1) - vr;
+  x[15] = (ui >> 1) + vi;
+
+  // xt1 = 18
+  // xt2 = 26
+  SUMDIFF_PIFOURTH_VEC(vi, vr, x[26], x[27])
+  ur = x[18];
+  ui = x[19];
+  x[18] = (ur >> 1) + vr;
+  x[19] = (ui >> 1) + vi;
+  x[26] = (ur >> 1) - vr;
+  x[27] = (ui >> 1) - vi;
+
+  // xt1 = 22
+  // xt2 = 30
+  SUMDIFF_PIFOURTH_VEC(vr, vi, x[30], x[31])
+  ur = x[22];
+  ui = x[23];
+  x[22] = (ur >> 1) + vr;
+  x[23] = (ui >> 1) - vi;
+  x[30] = (ur >> 1) - vr;
+  x[31] = (ui >> 1) + vi;
+
+  // xt1 =  0
+  // xt2 = 16
+  vr = x[16];
+  vi = x[17];
+  ur = x[0] >> 1;
+  ui = x[1] >> 1;
+  x[0] = ur + (vr >> 1);
+  x[1] = ui + (vi >> 1);
+  x[16] = ur - (vr >> 1);
+  x[17] = ui - (vi >> 1);
+
+  // xt1 =  8
+  // xt2 = 24
+  vi = x[24];
+  vr = x[25];
+  ur = x[8] >> 1;
+  ui = x[9] >> 1;
+  x[8] = ur + (vr >> 1);
+  x[9] = ui - (vi >> 1);
+  x[24] = ur - (vr >> 1);
+  x[25] = ui + (vi >> 1);
+
+  // xt1 =  2
+  // xt2 = 18
+  cplxMultDiv2(&vi, &vr, x[19], x[18], fft16_w16[0]);
+  ur = x[2];
+  ui = x[3];
+  x[2] = (ur >> 1) + vr;
+  x[3] = (ui >> 1) + vi;
+  x[18] = (ur >> 1) - vr;
+  x[19] = (ui >> 1) - vi;
+
+  // xt1 = 10
+  // xt2 = 26
+  cplxMultDiv2(&vr, &vi, x[27], x[26], fft16_w16[0]);
+  ur = x[10];
+  ui = x[11];
+  x[10] = (ur >> 1) + vr;
+  x[11] = (ui >> 1) - vi;
+  x[26] = (ur >> 1) - vr;
+  x[27] = (ui >> 1) + vi;
+
+  // xt1 =  4
+  // xt2 = 20
+  SUMDIFF_PIFOURTH_VEC(vi, vr, x[20], x[21])
+  ur = x[4];
+  ui = x[5];
+  x[4] = (ur >> 1) + vr;
+  x[5] = (ui >> 1) + vi;
+  x[20] = (ur >> 1) - vr;
+  x[21] = (ui >> 1) - vi;
+
+  // xt1 = 12
+  // xt2 = 28
+  SUMDIFF_PIFOURTH_VEC(vr, vi, x[28], x[29])
+  ur = x[12];
+  ui = x[13];
+  x[12] = (ur >> 1) + vr;
+  x[13] = (ui >> 1) - vi;
+  x[28] = (ur >> 1) - vr;
+  x[29] = (ui >> 1) + vi;
+
+  // xt1 =  6
+  // xt2 = 22
+  cplxMultDiv2(&vi, &vr, x[23], x[22], fft16_w16[1]);
+  ur = x[6];
+  ui = x[7];
+  x[6] = (ur >> 1) + vr;
+  x[7] = (ui >> 1) + vi;
+  x[22] = (ur >> 1) - vr;
+  x[23] = (ui >> 1) - vi;
+
+  // xt1 = 14
+  // xt2 = 30
+  cplxMultDiv2(&vr, &vi, x[31], x[30], fft16_w16[1]);
+  ur = x[14];
+  ui = x[15];
+  x[14] = (ur >> 1) + vr;
+  x[15] = (ui >> 1) - vi;
+  x[30] = (ur >> 1) - vr;
+  x[31] = (ui >> 1) + vi;
+}
+
+/*
+  fft240 as done by fftN2_func() with dim1 = 16 and dim2 = 15: the lanes of
+  VEC compute neighbouring columns in both stages and the result is transposed
+  on the way to aDst. rot holds the rotation vector in the lane order, see
+  fft240_initRot().
+*/
+static void fft240_vec(FIXP_DBL *pInput, FIXP_DBL *aDst,
+                       const FIXP_DBL (*rot)[2 * 16]) {
+  const int lanes = (int)(sizeof(VEC) / sizeof(FIXP_DBL));
+  VEC x[2 * 16];
+  int i, j, e;
+
+  /* 15 ffts of length 16, lane k of the group at i works on column i + k */
+  for (i = 0; i < 15; i += lanes) {
+    const int n = fMin(lanes, 15 - i);
+
+    for (j = 0; j < 16; j++) {
+      const FIXP_DBL *pSrc = &pInput[2 * (j * 15 + i)];
+
+      if ((j == 15) && (n < lanes)) {
+        /* the unused lane must not read past the end of pInput */
+        FIXP_DBL tmp[2 * 8];
+        for (e = 0; e < 2 * lanes; e++) {
+          tmp[e] = (e < 2 * n) ? pSrc[e] : (FIXP_DBL)0;
+        }
+        vLoadCplx(tmp, &x[2 * j], &x[2 * j + 1]);
+      } else {
+        vLoadCplx(pSrc, &x[2 * j], &x[2 * j + 1]);
+      }
+    }
+
+    fft_16_vec(x);
+
+    /* fft_apply_rot_vector(): element 0 and column 0 are scaled only */
+    x[0] = x[0] >> 2;
+    x[1] = x[1] >> 2;
+    for (e = 1; e < 16; e++) {
+      VEC re, im, vre, vim;
+
+      re = x[2 * e] >> 1;
+      im = x[2 * e + 1] >> 1;
+      vLoadCplx(&rot[e - 1][2 * i], &vre, &vim);
+      cplxMultDiv2(&im, &re, im, re, vre, vim);
+      if (i == 0) {
+        re = vInsertLane0(re, x[2 * e] >> 2);
+        im = vInsertLane0(im, x[2 * e + 1] >> 2);
+      }
+      x[2 * e] = re;
+      x[2 * e + 1] = im;
+    }
+
+    for (e = 0; e < 16; e += 4) {
+      vStoreCplxTransposed(&aDst[2 * (i * 16 + e)], 2 * 16, &x[2 * e], n);
+    }
+  }
+
+  /* 16 ffts of length 15, lane k of the group at i works on column i + k */
+  for (i = 0; i < 16; i += lanes) {
+    for (j = 0; j < 15; j++) {
+      vLoadCplx(&aDst[2 * (j * 16 + i)], &x[2 * j], &x[2 * j + 1]);
+    }
+
+    fft15_vec(x);
+
+    for (j = 0; j < 15; j++) {
+      vStoreCplx(&pInput[2 * (j * 16 + i)], x[2 * j], x[2 * j + 1]);
+    }
+  }
+}
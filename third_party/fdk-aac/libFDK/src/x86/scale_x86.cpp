@@ -0,0 +1,225 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/******************* Library for basic calculation routines ********************
+
+   Author(s):
+
+   Description: Scaling operations for x86 with SSE2
+
+*******************************************************************************/
+
+/* prevent multiple inclusion with re-definitions */
+#ifndef __INCLUDE_SCALE_X86__
+#define __INCLUDE_SCALE_X86__
+
+#include "x86/simd_x86.h"
+
+#if defined(FDK_X86_SSE2)
+
+/* mask ? a : b, lane wise */
+static FDK_FORCEINLINE __m128i scale_x86_select(__m128i mask, __m128i a,
+                                                __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/* fAddSaturate(value, 0x8000) and FX_DBL2FX_SGL(), still as 32 bit */
+static FDK_FORCEINLINE __m128i scale_x86_roundSGL(__m128i value) {
+  const __m128i maxSum = _mm_set1_epi32(MAXVAL_DBL >> 1);
+  __m128i sum = _mm_add_epi32(_mm_srai_epi32(value, 1), _mm_set1_epi32(0x4000));
+  sum = scale_x86_select(_mm_cmpgt_epi32(sum, maxSum), maxSum, sum);
+  return _mm_srai_epi32(sum, 15);
+}
+
+#if !defined(FUNCTION_scaleValuesWithFactor_DBL)
+#define FUNCTION_scaleValuesWithFactor_DBL
+SCALE_INLINE
+void scaleValuesWithFactor(FIXP_DBL *vector, FIXP_DBL factor, INT len,
+                           INT scalefactor) {
+  const __m128i vfactor = _mm_set1_epi32(factor);
+  INT i = 0;
+
+  /* Compensate fMultDiv2 */
+  scalefactor++;
+
+  if (scalefactor > 0) {
+    scalefactor = fixmin_I(scalefactor, (INT)DFRACT_BITS - 1);
+    const __m128i shift = _mm_cvtsi32_si128(scalefactor);
+    for (; i + 4 <= len; i += 4) {
+      __m128i v = _mm_loadu_si128((__m128i *)&vector[i]);
+      v = _mm_sll_epi32(FDK_mm_mulhi_epi32(v, vfactor), shift);
+      _mm_storeu_si128((__m128i *)&vector[i], v);
+    }
+    for (; i < len; i++) {
+      vector[i] = fMultDiv2(vector[i], factor) << scalefactor;
+    }
+  } else {
+    INT negScalefactor = fixmin_I(-scalefactor, (INT)DFRACT_BITS - 1);
+    const __m128i shift = _mm_cvtsi32_si128(negScalefactor);
+    for (; i + 4 <= len; i += 4) {
+      __m128i v = _mm_loadu_si128((__m128i *)&vector[i]);
+      v = _mm_sra_epi32(FDK_mm_mulhi_epi32(v, vfactor), shift);
+      _mm_storeu_si128((__m128i *)&vector[i], v);
+    }
+    for (; i < len; i++) {
+      vector[i] = fMultDiv2(vector[i], factor) >> negScalefactor;
+    }
+  }
+}
+#endif /* FUNCTION_scaleValuesWithFactor_DBL */
+
+#if !defined(FUNCTION_scaleValuesSaturate_SGL_DBL)
+#define FUNCTION_scaleValuesSaturate_SGL_DBL
+/*
+  Same result as the generic version: scaleValueSaturate() clips to
+  [MINVAL_DBL + 1, MAXVAL_DBL] or clears the values which are shifted out, then
+  0x8000 is added with saturation before taking the upper 16 bits.
+*/
+SCALE_INLINE
+void scaleValuesSaturate(FIXP_SGL *dst,   /*!< Output */
+                         FIXP_DBL *src,   /*!< Input   */
+                         INT len,         /*!< Length */
+                         INT scalefactor) /*!< Scalefactor */
+{
+  INT i = 0, j;
+
+  scalefactor = fixmax_I(fixmin_I(scalefactor, (INT)DFRACT_BITS - 1),
+                         (INT) - (DFRACT_BITS - 1));
+
+  if (scalefactor >= 0) {
+    const __m128i shift = _mm_cvtsi32_si128(scalefactor);
+    /* values above hi saturate to MAXVAL_DBL, values up to lo to
+     * MINVAL_DBL + 1 */
+    const __m128i hi = _mm_set1_epi32(MAXVAL_DBL >> scalefactor);
+    const __m128i lo = _mm_set1_epi32((MINVAL_DBL >> scalefactor) + 1);
+    const __m128i maxVal = _mm_set1_epi32(MAXVAL_DBL);
+    const __m128i minVal = _mm_set1_epi32(MINVAL_DBL + 1);
+
+    for (; i + 8 <= len; i += 8) {
+      __m128i out[2];
+      for (j = 0; j < 2; j++) {
+        __m128i v = _mm_loadu_si128((__m128i *)&src[i + 4 * j]);
+        __m128i r = _mm_sll_epi32(v, shift);
+        r = scale_x86_select(_mm_cmpgt_epi32(v, hi), maxVal, r);
+        r = scale_x86_select(_mm_cmpgt_epi32(lo, v), minVal, r);
+        out[j] = scale_x86_roundSGL(r);
+      }
+      _mm_storeu_si128((__m128i *)&dst[i], _mm_packs_epi32(out[0], out[1]));
+    }
+  } else {
+    const __m128i shift = _mm_cvtsi32_si128(-scalefactor);
+
+    for (; i + 8 <= len; i += 8) {
+      __m128i out[2];
+      for (j = 0; j < 2; j++) {
+        __m128i v = _mm_loadu_si128((__m128i *)&src[i + 4 * j]);
+        __m128i r = _mm_sra_epi32(v, shift);
+        /* small negative values are cleared instead of giving -1 */
+        r = _mm_sub_epi32(r, _mm_cmpeq_epi32(r, _mm_set1_epi32(-1)));
+        out[j] = scale_x86_roundSGL(r);
+      }
+      _mm_storeu_si128((__m128i *)&dst[i], _mm_packs_epi32(out[0], out[1]));
+    }
+  }
+
+  for (; i < len; i++) {
+    dst[i] = FX_DBL2FX_SGL(fAddSaturate(scaleValueSaturate(src[i], scalefactor),
+                                        (FIXP_DBL)0x8000));
+  }
+}
+#endif /* FUNCTION_scaleValuesSaturate_SGL_DBL */
+
+#endif /* FDK_X86_SSE2 */
+
+#endif /* __INCLUDE_SCALE_X86__ */
@@ -0,0 +1,213 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/*********************** MPEG surround decoder library *************************
+
+   Author(s):
+
+   Description: SAC decoder stub for the AAC-ELD decoder-only library
+
+*******************************************************************************/
+
+/*!
+  \file
+  \brief  MPEG Surround decoder stub
+
+  Replaces libSACdec in the fdk-aac-eld library. mpegSurroundDecoder_Open()
+  succeeds with a NULL handle and every MPEG Surround configuration is reported
+  as unsupported, so the core decoder switches MPS off and outputs the downmix.
+  The other functions behave like the real library does for a NULL handle.
+*/
+
+#include "sac_dec_lib.h"
+
+SAC_INSTANCE_AVAIL
+mpegSurroundDecoder_IsFullMpegSurroundDecoderInstanceAvailable(
+    CMpegSurroundDecoder *pMpegSurroundDecoder) {
+  return SAC_INSTANCE_NOT_FULL_AVAILABLE;
+}
+
+SACDEC_ERROR mpegSurroundDecoder_Open(
+    CMpegSurroundDecoder **pMpegSurroundDecoder, int stereoConfigIndex,
+    HANDLE_FDK_QMF_DOMAIN pQmfDomain) {
+  *pMpegSurroundDecoder = NULL;
+
+  return MPS_OK;
+}
+
+SACDEC_ERROR mpegSurroundDecoder_Init(
+    CMpegSurroundDecoder *pMpegSurroundDecoder) {
+  return MPS_INVALID_HANDLE;
+}
+
+SACDEC_ERROR mpegSurroundDecoder_Config(
+    CMpegSurroundDecoder *pMpegSurroundDecoder, HANDLE_FDK_BITSTREAM hBs,
+    AUDIO_OBJECT_TYPE coreCodec, INT samplingRate, INT stereoConfigIndex,
+    INT coreSbrFrameLengthIndex, INT configBytes, const UCHAR configMode,
+    UCHAR *configChanged) {
+  if (configBytes <= 0) {
+    /* The length of the config is unknown, it cannot be skipped. */
+    return MPS_PARSE_ERROR;
+  }
+
+  /* Skip the SpatialSpecificConfig so that parsing can go on behind it. */
+  FDKpushFor(hBs, configBytes * 8);
+
+  return MPS_UNSUPPORTED_CONFIG;
+}
+
+SACDEC_ERROR
+mpegSurroundDecoder_ConfigureQmfDomain(
+    CMpegSurroundDecoder *pMpegSurroundDecoder,
+    SAC_INPUT_CONFIG sac_dec_interface, UINT coreSamplingRate,
+    AUDIO_OBJECT_TYPE coreCodec) {
+  return MPS_INVALID_HANDLE;
+}
+
+int mpegSurroundDecoder_ParseNoHeader(
+    CMpegSurroundDecoder *pMpegSurroundDecoder, HANDLE_FDK_BITSTREAM hBs,
+    int *pMpsDataBits, int fGlobalIndependencyFlag) {
+  return MPS_INVALID_HANDLE;
+}
+
+int mpegSurroundDecoder_Parse(CMpegSurroundDecoder *pMpegSurroundDecoder,
+                              HANDLE_FDK_BITSTREAM hBs, int *pMpsDataBits,
+                              AUDIO_OBJECT_TYPE coreCodec, int sampleRate,
+                              int frameSize, int fGlobalIndependencyFlag) {
+  return MPS_INVALID_HANDLE;
+}
+
+int mpegSurroundDecoder_Apply(CMpegSurroundDecoder *pMpegSurroundDecoder,
+                              INT_PCM *input, PCM_MPS *pTimeData,
+                              const int timeDataSize, int timeDataFrameSize,
+                              int *nChannels, int *frameSize, int sampleRate,
+                              AUDIO_OBJECT_TYPE coreCodec,
+                              AUDIO_CHANNEL_TYPE channelType[],
+                              UCHAR channelIndices[],
+                              const FDK_channelMapDescr *const mapDescr) {
+  return MPS_INVALID_HANDLE;
+}
+
+void mpegSurroundDecoder_Close(CMpegSurroundDecoder *pMpegSurroundDecoder) {}
+
+SACDEC_ERROR mpegSurroundDecoder_FreeMem(
+    CMpegSurroundDecoder *pMpegSurroundDecoder) {
+  return MPS_OK;
+}
+
+SACDEC_ERROR mpegSurroundDecoder_SetParam(
+    CMpegSurroundDecoder *pMpegSurroundDecoder, const SACDEC_PARAM param,
+    const INT value) {
+  return MPS_INVALID_HANDLE;
+}
+
+/* MPS is not registered, the capabilities of the decoder do not include it */
+int mpegSurroundDecoder_GetLibInfo(LIB_INFO *libInfo) {
+  if (libInfo == NULL) {
+    return -1;
+  }
+
+  return 0;
+}
+
+UINT mpegSurroundDecoder_GetDelay(const CMpegSurroundDecoder *self) {
+  return 0;
+}
+
+SACDEC_ERROR mpegSurroundDecoder_IsPseudoLR(
+    CMpegSurroundDecoder *pMpegSurroundDecoder, int *bsPseudoLr) {
+  *bsPseudoLr = 0;
+
+  return MPS_INVALID_HANDLE;
+}
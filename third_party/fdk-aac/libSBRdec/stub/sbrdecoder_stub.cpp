@@ -0,0 +1,198 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/**************************** SBR decoder library ******************************
+
+   Author(s):
+
+   Description: SBR decoder stub for the AAC-ELD decoder-only library
+
+*******************************************************************************/
+
+/*!
+  \file
+  \brief  SBR decoder stub
+
+  Replaces libSBRdec in the fdk-aac-eld library. No SBR instance is ever
+  created: sbrDecoder_Open() succeeds with a NULL handle and every other
+  function behaves like the real library does for a NULL handle, so the core
+  decoder treats SBR as not available. Streams that signal SBR are rejected
+  during configuration.
+*/
+
+#include "sbrdecoder.h"
+
+SBR_ERROR sbrDecoder_Open(HANDLE_SBRDECODER *pSelf,
+                          HANDLE_FDK_QMF_DOMAIN pQmfDomain) {
+  if ((pSelf == NULL) || (pQmfDomain == NULL)) {
+    return SBRDEC_INVALID_ARGUMENT;
+  }
+
+  *pSelf = NULL;
+
+  return SBRDEC_OK;
+}
+
+SBR_ERROR sbrDecoder_InitElement(
+    HANDLE_SBRDECODER self, const int sampleRateIn, const int sampleRateOut,
+    const int samplesPerFrame, const AUDIO_OBJECT_TYPE coreCodec,
+    const MP4_ELEMENT_ID elementID, const int elementIndex,
+    const UCHAR harmonicSBR, const UCHAR stereoConfigIndex,
+    const UCHAR configMode, UCHAR *configChanged, const INT downscaleFactor) {
+  return SBRDEC_INVALID_ARGUMENT;
+}
+
+SBR_ERROR sbrDecoder_FreeMem(HANDLE_SBRDECODER *self) { return SBRDEC_OK; }
+
+INT sbrDecoder_Header(HANDLE_SBRDECODER self, HANDLE_FDK_BITSTREAM hBs,
+                      const INT sampleRateIn, const INT sampleRateOut,
+                      const INT samplesPerFrame,
+                      const AUDIO_OBJECT_TYPE coreCodec,
+                      const MP4_ELEMENT_ID elementID, const INT elementIndex,
+                      const UCHAR harmonicSBR, const UCHAR stereoConfigIndex,
+                      const UCHAR configMode, UCHAR *configChanged,
+                      const INT downscaleFactor) {
+  return SBRDEC_UNSUPPORTED_CONFIG;
+}
+
+SBR_ERROR sbrDecoder_SetParam(HANDLE_SBRDECODER self, const SBRDEC_PARAM param,
+                              const INT value) {
+  return SBRDEC_NOT_INITIALIZED;
+}
+
+SBR_ERROR sbrDecoder_drcFeedChannel(HANDLE_SBRDECODER self, INT ch,
+                                    UINT numBands, FIXP_DBL *pNextFact_mag,
+                                    INT nextFact_exp,
+                                    SHORT drcInterpolationScheme,
+                                    UCHAR winSequence, USHORT *pBandTop) {
+  return SBRDEC_NOT_INITIALIZED;
+}
+
+void sbrDecoder_drcDisable(HANDLE_SBRDECODER self, INT ch) {}
+
+SBR_ERROR sbrDecoder_Parse(HANDLE_SBRDECODER self, HANDLE_FDK_BITSTREAM hBs,
+                           UCHAR *pDrmBsBuffer, USHORT drmBsBufferSize,
+                           int *count, int bsPayLen, int crcFlag,
+                           MP4_ELEMENT_ID prev_element, int element_index,
+                           UINT acFlags, UINT acElFlags[]) {
+  return SBRDEC_NOT_INITIALIZED;
+}
+
+SBR_ERROR sbrDecoder_Apply(HANDLE_SBRDECODER self, INT_PCM *input,
+                           INT_PCM *timeData, const int timeDataSize,
+                           int *numChannels, int *sampleRate,
+                           const FDK_channelMapDescr *const mapDescr,
+                           const int mapIdx, const int coreDecodedOk,
+                           UCHAR *psDecoded) {
+  return SBRDEC_INVALID_ARGUMENT;
+}
+
+SBR_ERROR sbrDecoder_Close(HANDLE_SBRDECODER *pSelf) {
+  if (pSelf != NULL) {
+    *pSelf = NULL;
+  }
+
+  return SBRDEC_OK;
+}
+
+/* SBR is not registered, the capabilities of the decoder do not include it */
+INT sbrDecoder_GetLibInfo(LIB_INFO *info) {
+  if (info == NULL) {
+    return -1;
+  }
+
+  return 0;
+}
+
+UINT sbrDecoder_GetDelay(const HANDLE_SBRDECODER self) { return 0; }
@@ -116,8 +116,13 @@ typedef unsigned long long uint64_t;
 #endif
 
 /* Library calling convention spec. __cdecl and friends might be added here as
- * required. */
+ * required. The API stays visible when the library is built with
+ * -fvisibility=hidden. */
+#if defined(__GNUC__) && !defined(_WIN32)
+#define LINKSPEC_H __attribute__((visibility("default")))
+#else
 #define LINKSPEC_H
+#endif
 #define LINKSPEC_CPP
 
 /* for doxygen the following docu parts must be separated */
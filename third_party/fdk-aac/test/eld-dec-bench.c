@@ -0,0 +1,264 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/**************************** AAC decoder library ******************************
+
+   Author(s):
+
+   Description: AAC-ELD decoder benchmark
+
+*******************************************************************************/
+
+/*
+  Loads a decoder shared library with dlopen() and reports the time it takes
+  to load it and the time per decoded frame for an AAC-ELD fixture (see
+  eld-fixture.h). The fdk-aac-eld-bench target runs it against fdk-aac and
+  fdk-aac-eld. Load time is the median of several dlopen(RTLD_NOW) calls,
+  each one in a fresh child process since dlclose() does not necessarily
+  unload a library. Decode time is taken from the fastest of several passes
+  over the fixture, the slowest single frame is reported as well.
+
+  usage: eld-dec-bench libfdk-aac.so in.bin [passes]
+*/
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aacdecoder_lib.h"
+#include "eld-fixture.h"
+
+#define PCM_BUF_SIZE (8 * 2048)
+#define LOAD_ROUNDS 21
+
+typedef HANDLE_AACDECODER (*OPEN_FN)(TRANSPORT_TYPE, UINT);
+typedef AAC_DECODER_ERROR (*CONFIG_FN)(HANDLE_AACDECODER, UCHAR **,
+                                       const UINT *);
+typedef AAC_DECODER_ERROR (*FILL_FN)(HANDLE_AACDECODER, UCHAR **, const UINT *,
+                                     UINT *);
+typedef AAC_DECODER_ERROR (*DECODE_FN)(HANDLE_AACDECODER, INT_PCM *, const INT,
+                                       const UINT);
+typedef void (*CLOSE_FN)(HANDLE_AACDECODER);
+
+static double nowUs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Time of one dlopen() of path in a child process, negative on failure */
+static double loadUs(const char *path) {
+  double t = -1.0;
+  int fd[2];
+  pid_t pid;
+
+  if (pipe(fd)) return -1.0;
+  pid = fork();
+  if (pid == 0) {
+    double start = nowUs();
+    void *lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    t = nowUs() - start;
+    if (lib == NULL) t = -1.0;
+    if (write(fd[1], &t, sizeof(t)) != sizeof(t)) _exit(1);
+    _exit(0);
+  }
+  close(fd[1]);
+  if ((pid < 0) || (read(fd[0], &t, sizeof(t)) != sizeof(t))) t = -1.0;
+  close(fd[0]);
+  if (pid > 0) waitpid(pid, NULL, 0);
+  return t;
+}
+
+static int cmpDouble(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+  ELD_FIXTURE fx;
+  double load[LOAD_ROUNDS];
+  double best = 0.0, worstFrame = 0.0;
+  void *lib = NULL;
+  OPEN_FN pOpen;
+  CONFIG_FN pConfig;
+  FILL_FN pFill;
+  DECODE_FN pDecode;
+  CLOSE_FN pClose;
+  INT_PCM pcm[PCM_BUF_SIZE];
+  int passes, frames = 0, i;
+
+  if ((argc < 3) || (argc > 4)) {
+    fprintf(stderr, "usage: %s libfdk-aac.so in.bin [passes]\n", argv[0]);
+    return 2;
+  }
+  passes = (argc > 3) ? atoi(argv[3]) : 20;
+  if (passes < 1) passes = 1;
+  if (eldFixture_Open(&fx, argv[2])) {
+    fprintf(stderr, "%s: cannot read fixture\n", argv[2]);
+    return 2;
+  }
+
+  /* before the library is mapped into this process */
+  for (i = 0; i < LOAD_ROUNDS; i++) {
+    load[i] = loadUs(argv[1]);
+    if (load[i] < 0.0) {
+      fprintf(stderr, "%s: cannot be loaded\n", argv[1]);
+      return 2;
+    }
+  }
+  qsort(load, LOAD_ROUNDS, sizeof(load[0]), cmpDouble);
+
+  lib = dlopen(argv[1], RTLD_NOW | RTLD_LOCAL);
+  if (lib == NULL) {
+    fprintf(stderr, "%s\n", dlerror());
+    return 2;
+  }
+
+  pOpen = (OPEN_FN)dlsym(lib, "aacDecoder_Open");
+  pConfig = (CONFIG_FN)dlsym(lib, "aacDecoder_ConfigRaw");
+  pFill = (FILL_FN)dlsym(lib, "aacDecoder_Fill");
+  pDecode = (DECODE_FN)dlsym(lib, "aacDecoder_DecodeFrame");
+  pClose = (CLOSE_FN)dlsym(lib, "aacDecoder_Close");
+  if (!pOpen || !pConfig || !pFill || !pDecode || !pClose) {
+    fprintf(stderr, "%s: decoder API not found\n", argv[1]);
+    return 2;
+  }
+
+  for (i = 0; i < passes; i++) {
+    HANDLE_AACDECODER dec = pOpen(TT_MP4_RAW, 1);
+    unsigned char *au;
+    unsigned int len;
+    UCHAR *conf;
+    UINT confLen;
+    double start, total = 0.0;
+
+    fx.pos = 0;
+    conf = eldFixture_Next(&fx, &confLen);
+    if ((dec == NULL) || (conf == NULL) ||
+        (pConfig(dec, &conf, &confLen) != AAC_DEC_OK)) {
+      fprintf(stderr, "%s: unsupported configuration\n", argv[2]);
+      return 2;
+    }
+    frames = 0;
+    while ((au = eldFixture_Next(&fx, &len)) != NULL) {
+      UCHAR *buf = au;
+      UINT size = len, valid = len;
+      double t;
+
+      start = nowUs();
+      pFill(dec, &buf, &size, &valid);
+      if (pDecode(dec, pcm, PCM_BUF_SIZE, 0) != AAC_DEC_OK) {
+        fprintf(stderr, "%s: frame %d: decoding failed\n", argv[2], frames);
+        return 1;
+      }
+      t = nowUs() - start;
+      total += t;
+      if (t > worstFrame) worstFrame = t;
+      frames++;
+    }
+    pClose(dec);
+    if ((i == 0) || (total < best)) best = total;
+  }
+
+  printf("%s: load %.1f us, decode %.2f us/frame (slowest frame %.1f us, "
+         "%d frames)\n",
+         argv[1], load[LOAD_ROUNDS / 2], best / frames, worstFrame, frames);
+
+  dlclose(lib);
+  eldFixture_Close(&fx);
+  return 0;
+}
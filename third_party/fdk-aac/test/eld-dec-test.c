@@ -0,0 +1,200 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/**************************** AAC decoder library ******************************
+
+   Author(s):
+
+   Description: AAC-ELD decoder bit exactness test
+
+*******************************************************************************/
+
+/*
+  Decodes an AAC-ELD fixture (see eld-fixture.h) and writes the PCM output.
+  Given a reference PCM file the output is compared sample by sample, the
+  fdk-aac-eld-check target uses this to verify that the SSE2 and AVX2 builds
+  produce exactly the output of the generic C build.
+
+  usage: eld-dec-test in.bin out.pcm [ref.pcm]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aacdecoder_lib.h"
+#include "eld-fixture.h"
+
+#define PCM_BUF_SIZE (8 * 2048)
+
+int main(int argc, char **argv) {
+  ELD_FIXTURE fx;
+  HANDLE_AACDECODER dec;
+  INT_PCM pcm[PCM_BUF_SIZE];
+  INT_PCM ref[PCM_BUF_SIZE];
+  UCHAR *conf;
+  UINT confLen;
+  unsigned char *au;
+  unsigned int auLen;
+  FILE *out, *in = NULL;
+  int frames = 0, ret = 0;
+
+  if ((argc < 3) || (argc > 4)) {
+    fprintf(stderr, "usage: %s in.bin out.pcm [ref.pcm]\n", argv[0]);
+    return 2;
+  }
+  if (eldFixture_Open(&fx, argv[1])) {
+    fprintf(stderr, "%s: cannot read fixture\n", argv[1]);
+    return 2;
+  }
+  conf = eldFixture_Next(&fx, &confLen);
+  dec = aacDecoder_Open(TT_MP4_RAW, 1);
+  if ((conf == NULL) || (dec == NULL) ||
+      (aacDecoder_ConfigRaw(dec, &conf, &confLen) != AAC_DEC_OK)) {
+    fprintf(stderr, "%s: unsupported configuration\n", argv[1]);
+    return 2;
+  }
+  out = fopen(argv[2], "wb");
+  if ((out == NULL) || ((argc == 4) && ((in = fopen(argv[3], "rb")) == NULL))) {
+    fprintf(stderr, "cannot open output or reference file\n");
+    return 2;
+  }
+
+  while ((au = eldFixture_Next(&fx, &auLen)) != NULL) {
+    UCHAR *buf = au;
+    UINT size = auLen, valid = auLen;
+    CStreamInfo *info;
+    int samples;
+
+    aacDecoder_Fill(dec, &buf, &size, &valid);
+    if (aacDecoder_DecodeFrame(dec, pcm, PCM_BUF_SIZE, 0) != AAC_DEC_OK) {
+      fprintf(stderr, "%s: frame %d: decoding failed\n", argv[1], frames);
+      ret = 1;
+      break;
+    }
+    info = aacDecoder_GetStreamInfo(dec);
+    samples = info->frameSize * info->numChannels;
+    fwrite(pcm, sizeof(INT_PCM), samples, out);
+    if (in != NULL) {
+      if (fread(ref, sizeof(INT_PCM), samples, in) != (size_t)samples) {
+        fprintf(stderr, "%s: frame %d: reference is too short\n", argv[1],
+                frames);
+        ret = 1;
+        break;
+      }
+      if (memcmp(pcm, ref, samples * sizeof(INT_PCM))) {
+        int i = 0;
+        while (pcm[i] == ref[i]) i++;
+        fprintf(stderr, "%s: frame %d sample %d: %d, expected %d\n", argv[1],
+                frames, i, pcm[i], ref[i]);
+        ret = 1;
+        break;
+      }
+    }
+    frames++;
+  }
+  if ((ret == 0) && (in != NULL) && (fread(ref, 1, 1, in) != 0)) {
+    fprintf(stderr, "%s: reference is longer than the output\n", argv[1]);
+    ret = 1;
+  }
+  if (ret == 0) {
+    printf("%s: %d frames%s\n", argv[1], frames, in ? ", bit exact" : "");
+  }
+
+  if (in != NULL) fclose(in);
+  fclose(out);
+  aacDecoder_Close(dec);
+  eldFixture_Close(&fx);
+  return ret;
+}
@@ -39,10 +39,7 @@
 extern "C" void
 audio_process(void *cls, void *opaque, pcm_data_struct *data)
 {
-    audio_session_t *session = (audio_session_t *)opaque;
-    for (int i = 0; i < data->data_len; i++) {
-        data->data[i] = data->data[i] * session->volume;
-    }   
+    // Volume is already applied to the samples inside the library
 }
 
 extern "C" void